@@ -0,0 +1,760 @@
+// The bulk map of MAP_cuda.cu on the CPU, built on hashing.
+//
+// The map is the same array of map_size cmap slots, filled and cleared the
+// way the kernels do it, so after the same calls the array is the same
+// bytes as d_map. What the kernels find by comparing every query against
+// every slot (batch_size * map_size threads) is found here through two
+// open-addressing indexes over the slots:
+//
+//   pairs   slot numbers hashed by (key, value), one entry per filled slot
+//   keys    per key, the first slot of a chain through next/prev linking
+//           every filled slot of the key, and the chain's length
+//
+// so a search or delete costs the slots it matches, not the whole table.
+// Index entries are slot numbers; SLOT_EMPTY ends a probe sequence and
+// SLOT_TOMB is a removed entry, walked past and reused. Both indexes have
+// at least twice map_size entries and are rebuilt from the array once
+// tombstones pass a quarter of either.
+//
+// Two results of the CUDA version depend on the order of its atomicInc
+// calls: the free slots listed by kernel_index_to_fill and the answers of
+// fill_search_kernel_key. MAP_cuda.cu sorts both (free slots ascending,
+// answers by key then value), and this file produces the same orders, so
+// the map array, the find flags, the counts and the answers can be
+// compared byte for byte.
+//
+// Searches run in parallel over the batch; inserts and deletes change the
+// indexes and run serially, in O(batch) for a batch rather than
+// O(batch * map_size).
+//
+//   g++ -O3 -fopenmp MAP_cpu.cpp -o map_cpu
+//   ./map_cpu [dump_file [map_size insert_batch_size]]
+//                      the insert/search/delete run of MAP_cuda.cu's main,
+//                      printing the same lines; with dump_file the final
+//                      map array is written there, as MAP_cuda.cu does
+//   ./map_cpu --check  random batches through this engine and through a
+//                      serial copy of the kernels, comparing every output
+
+#include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<stdint.h>
+#include<algorithm>
+#include<sys/time.h>
+#include<omp.h>
+
+#define SLOT_EMPTY -1
+#define SLOT_TOMB -2
+
+using namespace std;
+
+struct cmap{
+    int key;
+    int value;
+    int fill;
+};
+
+
+struct element_pair{
+    int key;
+    int value;
+    int find;
+};
+
+struct element{
+    int key;
+    int find;
+};
+
+struct cpuMap{
+    cmap *map;
+    int map_size;
+    int used;               // filled slots
+    int first_free;         // no free slot below it
+    unsigned mask;          // of pairs and keys
+    int *pairs;
+    int *keys;
+    int *key_count;         // chain length of keys[i]
+    int *next, *prev;       // chains of the slots of one key, -1 ends
+    unsigned pair_tombs, key_tombs;
+};
+
+static inline unsigned mix64(uint64_t x){
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (unsigned)x;
+}
+
+static inline unsigned hash_key(int key){
+    return mix64((uint32_t)key);
+}
+
+static inline unsigned hash_pair(int key, int value){
+    return mix64(((uint64_t)(uint32_t)key << 32) | (uint32_t)value);
+}
+
+//the position of key's chain in keys, or -1
+static inline int find_key(const cpuMap *m, int key){
+    for(unsigned i = hash_key(key) & m->mask ;; i = (i + 1) & m->mask){
+        int slot = m->keys[i];
+        if(slot == SLOT_EMPTY)
+            return -1;
+        if(slot >= 0 && m->map[slot].key == key)
+            return (int)i;
+    }
+}
+
+static inline bool pair_held(const cpuMap *m, int key, int value){
+    for(unsigned i = hash_pair(key, value) & m->mask ;; i = (i + 1) & m->mask){
+        int slot = m->pairs[i];
+        if(slot == SLOT_EMPTY)
+            return false;
+        if(slot >= 0 && m->map[slot].key == key && m->map[slot].value == value)
+            return true;
+    }
+}
+
+//the first empty or tombstone entry from start, taking the tombstone off the count
+static inline unsigned free_entry(int *table, unsigned start, unsigned mask, unsigned *tombs){
+    unsigned i = start & mask;
+    while(table[i] >= 0)
+        i = (i + 1) & mask;
+    if(table[i] == SLOT_TOMB)
+        (*tombs)--;
+    return i;
+}
+
+//enters a just filled slot in both indexes
+static void link_slot(cpuMap *m, int slot){
+    int key = m->map[slot].key;
+    int at = find_key(m, key);
+    m->prev[slot] = -1;
+    if(at >= 0){
+        int head = m->keys[at];
+        m->next[slot] = head;
+        m->prev[head] = slot;
+        m->keys[at] = slot;
+        m->key_count[at]++;
+    }else{
+        unsigned i = free_entry(m->keys, hash_key(key), m->mask, &m->key_tombs);
+        m->next[slot] = -1;
+        m->keys[i] = slot;
+        m->key_count[i] = 1;
+    }
+    unsigned i = free_entry(m->pairs, hash_pair(key, m->map[slot].value), m->mask, &m->pair_tombs);
+    m->pairs[i] = slot;
+}
+
+//takes slot out of its key's chain, which sits at keys[at]
+static void unlink_chain(cpuMap *m, int slot, int at){
+    if(m->prev[slot] >= 0)
+        m->next[m->prev[slot]] = m->next[slot];
+    if(m->next[slot] >= 0)
+        m->prev[m->next[slot]] = m->prev[slot];
+    m->key_count[at]--;
+    if(m->keys[at] == slot){
+        if(m->next[slot] >= 0){
+            m->keys[at] = m->next[slot];
+        }else{
+            m->keys[at] = SLOT_TOMB;
+            m->key_tombs++;
+        }
+    }
+}
+
+static void unlink_pair(cpuMap *m, int slot){
+    for(unsigned i = hash_pair(m->map[slot].key, m->map[slot].value) & m->mask ;; i = (i + 1) & m->mask)
+        if(m->pairs[i] == slot){
+            m->pairs[i] = SLOT_TOMB;
+            m->pair_tombs++;
+            return;
+        }
+}
+
+static inline void clear_slot(cpuMap *m, int slot){
+    m->map[slot].key = 0;
+    m->map[slot].value = 0;
+    m->map[slot].fill = 0;
+    m->used--;
+    if(slot < m->first_free)
+        m->first_free = slot;
+}
+
+static void rebuild_index(cpuMap *m){
+    size_t entries = (size_t)m->mask + 1;
+    for(size_t i=0 ; i<entries ; i++){
+        m->pairs[i] = SLOT_EMPTY;
+        m->keys[i] = SLOT_EMPTY;
+    }
+    m->pair_tombs = m->key_tombs = 0;
+    for(int slot=0 ; slot<m->map_size ; slot++)
+        if(m->map[slot].fill == 1)
+            link_slot(m, slot);
+}
+
+static void settle_index(cpuMap *m){
+    unsigned quarter = (m->mask + 1) / 4;
+    if(m->pair_tombs > quarter || m->key_tombs > quarter)
+        rebuild_index(m);
+}
+
+//an empty map of map_size slots, like the cudaMemset d_map
+cpuMap *cpu_map_create(int map_size){
+    cpuMap *m = (cpuMap*)malloc(sizeof(cpuMap));
+    size_t entries = 16;
+    while(entries < 2 * (size_t)map_size)
+        entries *= 2;
+    m->map = (cmap*)calloc(map_size, sizeof(cmap));
+    m->map_size = map_size;
+    m->used = 0;
+    m->first_free = 0;
+    m->mask = (unsigned)(entries - 1);
+    m->pairs = (int*)malloc(entries * sizeof(int));
+    m->keys = (int*)malloc(entries * sizeof(int));
+    m->key_count = (int*)malloc(entries * sizeof(int));
+    m->next = (int*)malloc(map_size * sizeof(int));
+    m->prev = (int*)malloc(map_size * sizeof(int));
+    rebuild_index(m);
+    return m;
+}
+
+void cpu_map_free(cpuMap *m){
+    free(m->map);
+    free(m->pairs);
+    free(m->keys);
+    free(m->key_count);
+    free(m->next);
+    free(m->prev);
+    free(m);
+}
+
+//kernel_index_to_fill: the first most free slots in ascending order, returning how many
+int cpu_index_to_fill(cpuMap *m, int *index_to_fill_in_hash_table, int most){
+    int count = 0, slot;
+    for(slot = m->first_free ; slot < m->map_size && count < most ; slot++)
+        if(m->map[slot].fill == 0)
+            index_to_fill_in_hash_table[count++] = slot;
+    m->first_free = count > 0 ? index_to_fill_in_hash_table[0] : slot;
+    return count;
+}
+
+//kernel_to_insert: input tid goes to index_to_fill_in_hash_table[tid] unless it was found
+void cpu_to_insert(cpuMap *m, element_pair *input, int *index_to_fill_in_hash_table, int insert_batch_size){
+    for(int tid=0 ; tid<insert_batch_size ; tid++){
+        if(input[tid].find == 0){
+            int slot = index_to_fill_in_hash_table[tid];
+            m->map[slot].key = input[tid].key;
+            m->map[slot].value = input[tid].value;
+            m->map[slot].fill = 1;
+            m->used++;
+            link_slot(m, slot);
+        }
+    }
+}
+
+//search_kernel_pair: sets find for every pair held in a filled slot, leaving the others as they are
+void cpu_search_pair(element_pair *search_input_pair, cpuMap *m, int search_batch_size){
+    #pragma omp parallel for schedule(static)
+    for(int i=0 ; i<search_batch_size ; i++)
+        if(pair_held(m, search_input_pair[i].key, search_input_pair[i].value))
+            search_input_pair[i].find = 1;
+}
+
+//the insert of MAP_cuda.cu's main: search_kernel_pair, kernel_index_to_fill,
+//kernel_to_insert; index_to_fill_in_hash_table holds insert_batch_size slots.
+//Pairs already in the map are not inserted again, pairs repeated in the batch
+//are. Returns -1, with the map unchanged, if too few slots are free.
+int cpu_insert(cpuMap *m, element_pair *input, int *index_to_fill_in_hash_table, int insert_batch_size){
+    if(insert_batch_size > m->map_size - m->used)
+        return -1;
+    cpu_search_pair(input, m, insert_batch_size);
+    cpu_index_to_fill(m, index_to_fill_in_hash_table, insert_batch_size);
+    cpu_to_insert(m, input, index_to_fill_in_hash_table, insert_batch_size);
+    settle_index(m);
+    return 0;
+}
+
+//search_kernel_key: the number of (query, filled slot) pairs with the same key
+int cpu_search_key(element *search_input_key, cpuMap *m, int search_batch_size){
+    int count = 0;
+    #pragma omp parallel for schedule(static) reduction(+:count)
+    for(int i=0 ; i<search_batch_size ; i++){
+        int at = find_key(m, search_input_key[i].key);
+        if(at >= 0)
+            count += m->key_count[at];
+    }
+    return count;
+}
+
+//fill_search_kernel_key: every match counted by cpu_search_key as (key, value),
+//sorted by key then value; a key asked r times has each value r times over
+void cpu_fill_search_key(element *search_input_key, cpuMap *m, int search_batch_size, element_pair *search_input_key_ans){
+    int *asked = (int*)malloc((search_batch_size + 1) * sizeof(int));
+    for(int i=0 ; i<search_batch_size ; i++)
+        asked[i] = search_input_key[i].key;
+    sort(asked, asked + search_batch_size);
+
+    //distinct keys with their repeats and the start of their answers
+    int *distinct = (int*)malloc((search_batch_size + 1) * sizeof(int));
+    int *repeats = (int*)malloc((search_batch_size + 1) * sizeof(int));
+    long *start = (long*)malloc((search_batch_size + 1) * sizeof(long));
+    int keyCount = 0;
+    for(int i=0 ; i<search_batch_size ; i++){
+        if(i > 0 && asked[i] == asked[i-1]){
+            repeats[keyCount-1]++;
+        }else{
+            distinct[keyCount] = asked[i];
+            repeats[keyCount++] = 1;
+        }
+    }
+    start[0] = 0;
+    for(int k=0 ; k<keyCount ; k++){
+        int at = find_key(m, distinct[k]);
+        start[k+1] = start[k] + (at >= 0 ? (long)m->key_count[at] * repeats[k] : 0);
+    }
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int k=0 ; k<keyCount ; k++){
+        int at = find_key(m, distinct[k]);
+        if(at < 0)
+            continue;
+        element_pair *out = search_input_key_ans + start[k];
+        int values = 0;
+        for(int slot = m->keys[at] ; slot >= 0 ; slot = m->next[slot])
+            out[values++].value = m->map[slot].value;
+        sort(out, out + values, [](const element_pair &a, const element_pair &b){ return a.value < b.value; });
+        //spread from the back, so no value is overwritten before it is copied
+        for(long j = values - 1 ; j >= 0 ; j--){
+            int value = out[j].value;
+            for(int r = repeats[k] - 1 ; r >= 0 ; r--){
+                out[j * repeats[k] + r].key = distinct[k];
+                out[j * repeats[k] + r].value = value;
+                out[j * repeats[k] + r].find = 0;
+            }
+        }
+    }
+    free(asked);
+    free(distinct);
+    free(repeats);
+    free(start);
+}
+
+//delete_kernel_pair: clears every slot holding one of the pairs
+void cpu_delete_pair(element_pair *delete_input_pair, cpuMap *m, int delete_batch_size){
+    for(int i=0 ; i<delete_batch_size ; i++){
+        int key = delete_input_pair[i].key, value = delete_input_pair[i].value;
+        for(unsigned e = hash_pair(key, value) & m->mask ; m->pairs[e] != SLOT_EMPTY ; e = (e + 1) & m->mask){
+            int slot = m->pairs[e];
+            if(slot < 0 || m->map[slot].key != key || m->map[slot].value != value)
+                continue;
+            m->pairs[e] = SLOT_TOMB;
+            m->pair_tombs++;
+            unlink_chain(m, slot, find_key(m, key));
+            clear_slot(m, slot);
+        }
+    }
+    settle_index(m);
+}
+
+//delete_kernel: clears every slot holding one of the keys
+void cpu_delete_key(element *delete_input, cpuMap *m, int delete_batch_size){
+    for(int i=0 ; i<delete_batch_size ; i++){
+        int at = find_key(m, delete_input[i].key);
+        if(at < 0)
+            continue;
+        for(int slot = m->keys[at], next ; slot >= 0 ; slot = next){
+            next = m->next[slot];
+            unlink_pair(m, slot);
+            clear_slot(m, slot);
+        }
+        m->keys[at] = SLOT_TOMB;
+        m->key_tombs++;
+    }
+    settle_index(m);
+}
+
+
+// The kernels of MAP_cuda.cu run serially over (query, slot), with the two
+// sorts MAP_cuda.cu applies; --check compares the engine against them.
+
+static void ref_insert(cmap *map, int map_size, element_pair *input, int insert_batch_size, int *index_to_fill){
+    for(int i=0 ; i<insert_batch_size ; i++)
+        for(int slot=0 ; slot<map_size ; slot++)
+            if(input[i].key == map[slot].key && input[i].value == map[slot].value && map[slot].fill == 1)
+                input[i].find = 1;
+    int counter = 0;
+    for(int slot=0 ; slot<map_size ; slot++)
+        if(map[slot].fill == 0)
+            index_to_fill[counter++] = slot;
+    for(int i=0 ; i<insert_batch_size ; i++)
+        if(input[i].find == 0){
+            map[index_to_fill[i]].key = input[i].key;
+            map[index_to_fill[i]].value = input[i].value;
+            map[index_to_fill[i]].fill = 1;
+        }
+}
+
+static void ref_search_pair(cmap *map, int map_size, element_pair *input, int search_batch_size){
+    for(int slot=0 ; slot<map_size ; slot++)
+        for(int i=0 ; i<search_batch_size ; i++)
+            if(input[i].key == map[slot].key && input[i].value == map[slot].value && map[slot].fill == 1)
+                input[i].find = 1;
+}
+
+static int ref_search_key(cmap *map, int map_size, element *input, int search_batch_size, element_pair *ans){
+    int count = 0;
+    for(int slot=0 ; slot<map_size ; slot++)
+        for(int i=0 ; i<search_batch_size ; i++)
+            if(input[i].key == map[slot].key && map[slot].fill == 1){
+                if(ans != NULL){
+                    ans[count].key = map[slot].key;
+                    ans[count].value = map[slot].value;
+                    ans[count].find = 0;
+                }
+                count++;
+            }
+    if(ans != NULL)
+        sort(ans, ans + count, [](const element_pair &a, const element_pair &b){
+            return a.key < b.key || (a.key == b.key && a.value < b.value);
+        });
+    return count;
+}
+
+static void ref_delete_pair(cmap *map, int map_size, element_pair *input, int delete_batch_size){
+    for(int slot=0 ; slot<map_size ; slot++)
+        for(int i=0 ; i<delete_batch_size ; i++)
+            if(input[i].key == map[slot].key && input[i].value == map[slot].value){
+                map[slot].key = 0;
+                map[slot].value = 0;
+                map[slot].fill = 0;
+            }
+}
+
+static void ref_delete_key(cmap *map, int map_size, element *input, int delete_batch_size){
+    for(int slot=0 ; slot<map_size ; slot++)
+        for(int i=0 ; i<delete_batch_size ; i++)
+            if(input[i].key == map[slot].key){
+                map[slot].key = 0;
+                map[slot].value = 0;
+                map[slot].fill = 0;
+            }
+}
+
+static double seconds_since(struct timeval *t1){
+    struct timeval t2;
+    gettimeofday(&t2, NULL);
+    return (t2.tv_sec - t1->tv_sec) + (t2.tv_usec - t1->tv_usec) / 1e6;
+}
+
+//random batches of every operation over few keys and values, so pairs repeat,
+//deletes hit many slots, the map fills up and the indexes get rebuilt; keys
+//include 0, the key of a cleared slot
+static int check_against_kernels(){
+    const int map_size = 1024, rounds = 1000, most = 256, keyRange = 48, valueRange = 200;
+    cpuMap *m = cpu_map_create(map_size);
+    cmap *ref = (cmap*)calloc(map_size, sizeof(cmap));
+    element_pair *a = (element_pair*)malloc(most * sizeof(element_pair));
+    element_pair *b = (element_pair*)malloc(most * sizeof(element_pair));
+    element *keys = (element*)malloc(most * sizeof(element));
+    int *index_a = (int*)malloc(map_size * sizeof(int));
+    int *index_b = (int*)malloc(map_size * sizeof(int));
+    element_pair *ans_a = NULL, *ans_b = NULL;
+    double engine = 0, kernels = 0;
+    struct timeval t1;
+    int bad = 0;
+    srand(12345);
+
+    for(int round=0 ; round<rounds && bad==0 ; round++){
+        int op = rand() % 5, n = 1 + rand() % most;
+        for(int i=0 ; i<n ; i++){
+            a[i].key = keys[i].key = rand() % keyRange;
+            a[i].value = rand() % valueRange;
+            a[i].find = keys[i].find = 0;
+        }
+        memcpy(b, a, n * sizeof(element_pair));
+
+        if(op == 0){
+            int refUsed = 0;
+            for(int slot=0 ; slot<map_size ; slot++)
+                refUsed += ref[slot].fill;
+            gettimeofday(&t1, NULL);
+            int status = cpu_insert(m, a, index_a, n);
+            engine += seconds_since(&t1);
+            if(n <= map_size - refUsed){
+                gettimeofday(&t1, NULL);
+                ref_insert(ref, map_size, b, n, index_b);
+                kernels += seconds_since(&t1);
+            }
+            if(status != (n <= map_size - refUsed ? 0 : -1))
+                bad++;
+        }else if(op == 1){
+            gettimeofday(&t1, NULL);
+            cpu_search_pair(a, m, n);
+            engine += seconds_since(&t1);
+            gettimeofday(&t1, NULL);
+            ref_search_pair(ref, map_size, b, n);
+            kernels += seconds_since(&t1);
+        }else if(op == 2){
+            gettimeofday(&t1, NULL);
+            int count_a = cpu_search_key(keys, m, n);
+            ans_a = (element_pair*)realloc(ans_a, (count_a + 1) * sizeof(element_pair));
+            cpu_fill_search_key(keys, m, n, ans_a);
+            engine += seconds_since(&t1);
+            gettimeofday(&t1, NULL);
+            int count_b = ref_search_key(ref, map_size, keys, n, NULL);
+            ans_b = (element_pair*)realloc(ans_b, (count_b + 1) * sizeof(element_pair));
+            ref_search_key(ref, map_size, keys, n, ans_b);
+            kernels += seconds_since(&t1);
+            if(count_a != count_b || memcmp(ans_a, ans_b, count_a * sizeof(element_pair)) != 0)
+                bad++;
+        }else if(op == 3){
+            n = 1 + n / 16;
+            gettimeofday(&t1, NULL);
+            cpu_delete_pair(a, m, n);
+            engine += seconds_since(&t1);
+            gettimeofday(&t1, NULL);
+            ref_delete_pair(ref, map_size, b, n);
+            kernels += seconds_since(&t1);
+        }else{
+            n = 1 + n / 256;
+            gettimeofday(&t1, NULL);
+            cpu_delete_key(keys, m, n);
+            engine += seconds_since(&t1);
+            gettimeofday(&t1, NULL);
+            ref_delete_key(ref, map_size, keys, n);
+            kernels += seconds_since(&t1);
+        }
+
+        if(memcmp(a, b, n * sizeof(element_pair)) != 0 || memcmp(m->map, ref, map_size * sizeof(cmap)) != 0)
+            bad++;
+        if(bad)
+            printf("round %d (operation %d, batch %d): outputs differ\n", round, op, n);
+    }
+
+    printf("%d rounds, %d filled slots at the end: %s\n", rounds, m->used, bad ? "FAILED" : "same bytes as the kernels");
+    printf("engine %.3f ms, kernels run serially %.3f ms\n", engine * 1000, kernels * 1000);
+    cpu_map_free(m);
+    free(ref);
+    free(a);
+    free(b);
+    free(keys);
+    free(index_a);
+    free(index_b);
+    free(ans_a);
+    free(ans_b);
+    return bad ? 1 : 0;
+}
+
+
+int main(int argc, char *argv[]){
+
+    if(argc > 1 && strcmp(argv[1], "--check") == 0)
+        return check_against_kernels();
+
+    const char *dump_file = argc > 1 ? argv[1] : NULL;
+    int map_size = argc > 2 ? atoi(argv[2]) : 100000002;
+    int first_batch_size = argc > 3 ? atoi(argv[3]) : 100000000;
+    int map_element_counter = 0;
+
+    cpuMap *m = cpu_map_create(map_size);
+
+    struct timeval t1;
+
+    int insert=1, search=0, delet=0,search_with_pair=0, search_with_key=1, insert_again = 0;
+
+    if(insert == 1){
+
+        int insert_batch_size = first_batch_size;
+
+        element_pair *h_input = (element_pair*)malloc(insert_batch_size * sizeof(element_pair));
+
+        for(int i=0 ; i<insert_batch_size ; i++){
+            h_input[i].key = 1;
+            h_input[i].value = i+1;
+            h_input[i].find = 0;
+        }
+
+        gettimeofday(&t1, NULL);
+
+        map_element_counter += insert_batch_size;
+
+        if(map_element_counter < map_size){
+
+            int *index_to_fill_in_hash_table = (int*)malloc(insert_batch_size * sizeof(int));
+            cpu_insert(m, h_input, index_to_fill_in_hash_table, insert_batch_size);
+
+            printf("Time taken (ms): %.3f\n", 1000 * seconds_since(&t1));
+
+            cout<<"Total Value1 = "<<m->used<<endl;
+            cout<<endl;
+            free(index_to_fill_in_hash_table);
+        }
+        free(h_input);
+    }
+
+    if(insert_again == 1){
+
+        int insert_batch_size = 5;
+
+        element_pair *h_input = (element_pair*)malloc(insert_batch_size * sizeof(element_pair));
+
+        for(int i=0 ; i<insert_batch_size ; i++){
+            h_input[i].key = i;
+            h_input[i].value = i;
+            h_input[i].find = 0;
+        }
+
+        gettimeofday(&t1, NULL);
+
+        int *index_to_fill_in_hash_table = (int*)malloc(insert_batch_size * sizeof(int));
+        cpu_insert(m, h_input, index_to_fill_in_hash_table, insert_batch_size);
+
+        printf("Time taken (ms): %.3f\n", 1000 * seconds_since(&t1));
+
+        cout<<"Total Value1 = "<<m->used<<endl;
+        cout<<endl;
+        free(index_to_fill_in_hash_table);
+        free(h_input);
+    }
+
+     // Search Code Data
+    if(search==1){
+
+        if(search_with_pair){
+
+            int search_batch_size = 10000;
+
+            element_pair *h_search_input_pair = (element_pair*)calloc(search_batch_size, sizeof(element_pair));
+
+            for(int i=0 ; i<search_batch_size ; i++){
+                h_search_input_pair[i].key = i;
+                h_search_input_pair[i].value = i+1;
+            }
+
+            gettimeofday(&t1, NULL);
+
+            cpu_search_pair(h_search_input_pair, m, search_batch_size);
+
+            printf("Time taken search pair(ms): %.3f\n", 1000 * seconds_since(&t1));
+
+            int flag = 1;
+
+            cout<<"\n\n\nFound value : \n";
+            for(int i=0 ; i<search_batch_size ; i++){
+                if(h_search_input_pair[i].find == 1 && flag){
+                  cout<<"key = "<<h_search_input_pair[i].key<<" value = "<<h_search_input_pair[i].value<<" ";
+                  flag=0;
+                }
+            }
+
+            cout<<endl;
+            free(h_search_input_pair);
+        }
+
+      if(search_with_key){
+
+            int search_batch_size = 3;
+
+            element *h_search_input_key = (element*)calloc(search_batch_size, sizeof(element));
+
+            for(int i=0 ; i<search_batch_size ; i++){
+                h_search_input_key[i].key = 1;
+            }
+
+            gettimeofday(&t1, NULL);
+
+            int h_count = cpu_search_key(h_search_input_key, m, search_batch_size);
+
+            cout<<"\nFound Entry with Keys = "<<h_count<<endl;
+
+            element_pair *h_search_input_key_ans = (element_pair*)calloc(h_count + 1, sizeof(element_pair));
+
+            cpu_fill_search_key(h_search_input_key, m, search_batch_size, h_search_input_key_ans);
+
+            printf("Time taken search keys(ms): %.3f\n", 1000 * seconds_since(&t1));
+
+            cout<<"\n\n\nFound value with keys : \n";
+            if(h_count > 0)
+                cout<<"key = "<<h_search_input_key_ans[0].key<<" value = "<<h_search_input_key_ans[0].value<<" ";
+
+            cout<<endl;
+            free(h_search_input_key);
+            free(h_search_input_key_ans);
+      }
+
+    }
+    // Search Code ended
+
+    // Delete Code
+    if(delet == 1){
+
+        //Delete Element with Key value pair
+        int delete_with_pair = 0;
+        if(delete_with_pair){
+
+            int delete_batch_size = 3;
+
+            element_pair *h_delete_input_pair = (element_pair*)calloc(delete_batch_size, sizeof(element_pair));
+
+            for(int i=0 ; i<delete_batch_size ; i++){
+                h_delete_input_pair[i].key = 1;
+                h_delete_input_pair[i].value = i+1;
+            }
+
+            gettimeofday(&t1, NULL);
+
+            cpu_delete_pair(h_delete_input_pair, m, delete_batch_size);
+
+            printf("Time taken Delate pair (ms): %.3f\n", 1000 * seconds_since(&t1));
+
+            cout<<"\n\n After Delettion:\n\n";
+            cout<<endl;
+            for(int i=0 ; i<map_size ; i++){
+                if(m->map[i].fill==1)
+                  cout<<"key = "<<m->map[i].key<<" "<<m->map[i].value<<"\n";
+            }
+            free(h_delete_input_pair);
+        }else
+        {
+
+            int delete_batch_size = 1;
+
+            element *h_delete_input = (element*)calloc(delete_batch_size, sizeof(element));
+
+            for(int i=0 ; i<delete_batch_size ; i++){
+                h_delete_input[i].key = 1;
+            }
+
+            gettimeofday(&t1, NULL);
+
+            cpu_delete_key(h_delete_input, m, delete_batch_size);
+
+            printf("Time taken Delate key (ms): %.3f\n", 1000 * seconds_since(&t1));
+
+            cout<<"\n\n After Delettion:\n\n";
+            cout<<endl;
+            for(int i=0 ; i<map_size ; i++){
+                if(m->map[i].fill==1)
+                  cout<<"key = "<<m->map[i].key<<" "<<m->map[i].value<<"\n";
+            }
+            free(h_delete_input);
+        }
+    }
+    // Delete Code Ended
+
+    if(dump_file != NULL){
+        FILE *f = fopen(dump_file, "wb");
+        if(f == NULL || fwrite(m->map, sizeof(cmap), map_size, f) != (size_t)map_size){
+            perror(dump_file);
+            return 1;
+        }
+        fclose(f);
+    }
+
+    cpu_map_free(m);
+    return 0;
+}
@@ -1,10 +1,17 @@
 //%%cu
 //#include<bits/stdc++.h>
 #include<iostream>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<climits>
 #include<sys/time.h>
 #include<cuda.h>
+#include<thrust/sort.h>
+#include<thrust/execution_policy.h>
 
-#define maxSize 10000000
+// atomicInc wraps at this; a map has at most INT_MAX slots
+#define maxSize INT_MAX
 #define block_size 1024
 
 using namespace std;
@@ -27,6 +34,27 @@ struct element{
     int find;
 };
 
+// Free slots and key search answers come out in atomicInc order; both are
+// sorted so runs are reproducible and match MAP_cpu.cpp byte for byte.
+struct pair_less{
+    __host__ __device__ bool operator()(const element_pair &a, const element_pair &b) const{
+        return a.key < b.key || (a.key == b.key && a.value < b.value);
+    }
+};
+
+
+// blocks to cover threads. The query x slot kernels pass batch * map_size,
+// which overflows int past 2^31 threads and loses blocks to float rounding
+// well before; past the grid limit there is no launch that covers it.
+int blocks_for(long long threads){
+
+    long long blocks = (threads + block_size - 1) / block_size;
+    if(blocks > INT_MAX){
+        fprintf(stderr, "%lld threads do not fit one grid\n", threads);
+        exit(1);
+    }
+    return (int)blocks;
+}
 
 __global__ void kernel_index_to_fill(cmap *d_map, int *d_index_to_fill_in_hash_table, int *counter, int map_size){
     
@@ -43,6 +71,14 @@ __global__ void kernel_index_to_fill(cmap *d_map, int *d_index_to_fill_in_hash_t
     
 }
 
+// the counter free slots found by kernel_index_to_fill, in ascending order
+void sort_index_to_fill(int *d_index_to_fill_in_hash_table, int *counter){
+
+    int h_counter;
+    cudaMemcpy(&h_counter, counter, sizeof(int), cudaMemcpyDeviceToHost);
+    thrust::sort(thrust::device, d_index_to_fill_in_hash_table, d_index_to_fill_in_hash_table + h_counter);
+}
+
 __global__ void kernel_to_insert(cmap *d_map, element_pair *d_input, int *d_index_to_fill_in_hash_table, int insert_batch_size){
 
 
@@ -59,9 +95,9 @@ __global__ void kernel_to_insert(cmap *d_map, element_pair *d_input, int *d_inde
 __global__ void search_kernel_pair(element_pair *d_search_input_pair, cmap *d_map, int a_size, int search_batch_size){
 
 
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
+    long long tid = (long long)blockDim.x * blockIdx.x + threadIdx.x;
 
-    if(tid < search_batch_size * a_size){
+    if(tid < (long long)search_batch_size * a_size){
 
         int index_of_element = tid % search_batch_size;
         int index_of_location = tid / search_batch_size;
@@ -79,14 +115,14 @@ __global__ void search_kernel_pair(element_pair *d_search_input_pair, cmap *d_ma
 
 __global__ void search_kernel_key(element *d_search_input_key, cmap *d_map, int a_size, int search_batch_size, int *d_count){
 
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
+    long long tid = (long long)blockDim.x * blockIdx.x + threadIdx.x;
 
-    if(tid < search_batch_size * a_size){
+    if(tid < (long long)search_batch_size * a_size){
 
         int index_of_element = tid % search_batch_size;
         int index_of_location = tid / search_batch_size;
 
-        if(d_search_input_key[index_of_element].key == d_map[index_of_location].key){
+        if(d_search_input_key[index_of_element].key == d_map[index_of_location].key && d_map[index_of_location].fill == 1){
 
             int temp = atomicInc((unsigned int *)d_count, -1);
             //d_search_input_pair[index_of_element].find = 1;
@@ -98,14 +134,14 @@ __global__ void search_kernel_key(element *d_search_input_key, cmap *d_map, int
 
 __global__ void fill_search_kernel_key(element *d_search_input_key, cmap *d_map, int a_size, int search_batch_size, element_pair *d_search_input_key_ans, int *index){
 
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
+    long long tid = (long long)blockDim.x * blockIdx.x + threadIdx.x;
 
-    if(tid < search_batch_size * a_size){
+    if(tid < (long long)search_batch_size * a_size){
 
         int index_of_element = tid % search_batch_size;
         int index_of_location = tid / search_batch_size;
 
-        if(d_search_input_key[index_of_element].key == d_map[index_of_location].key){
+        if(d_search_input_key[index_of_element].key == d_map[index_of_location].key && d_map[index_of_location].fill == 1){
             int ind = atomicInc((unsigned int *)index, -1);
             d_search_input_key_ans[ind].key = d_map[index_of_location].key;
             d_search_input_key_ans[ind].value = d_map[index_of_location].value;
@@ -118,9 +154,9 @@ __global__ void fill_search_kernel_key(element *d_search_input_key, cmap *d_map,
 __global__ void delete_kernel_pair(element_pair *d_delete_input_pair, cmap *d_map, int a_size, int delete_batch_size){
 
 
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
+    long long tid = (long long)blockDim.x * blockIdx.x + threadIdx.x;
 
-    if(tid < delete_batch_size * a_size){
+    if(tid < (long long)delete_batch_size * a_size){
 
         int index_of_element = tid % delete_batch_size;
         int index_of_location = tid / delete_batch_size;
@@ -140,9 +176,9 @@ __global__ void delete_kernel_pair(element_pair *d_delete_input_pair, cmap *d_ma
 __global__ void delete_kernel(element *d_delete_input, cmap *d_map, int a_size, int delete_batch_size){
 
 
-    int tid = blockDim.x * blockIdx.x + threadIdx.x;
+    long long tid = (long long)blockDim.x * blockIdx.x + threadIdx.x;
 
-    if(tid < delete_batch_size * a_size){
+    if(tid < (long long)delete_batch_size * a_size){
 
         int index_of_element = tid % delete_batch_size;
         int index_of_location = tid / delete_batch_size;
@@ -160,9 +196,12 @@ __global__ void delete_kernel(element *d_delete_input, cmap *d_map, int a_size,
 
 
 
-int main(){
+// ./map [dump_file [map_size insert_batch_size]]: dump_file gets the final map
+int main(int argc, char *argv[]){
 
-    int map_size = 100000002;
+    const char *dump_file = argc > 1 ? argv[1] : NULL;
+    int map_size = argc > 2 ? atoi(argv[2]) : 100000002;
+    int first_batch_size = argc > 3 ? atoi(argv[3]) : 100000000;
     int map_element_counter = 0;
 
     cmap *d_map, *h_map;
@@ -181,7 +220,7 @@ int main(){
     
     if(insert == 1){       
         
-        int insert_batch_size = 100000000;
+        int insert_batch_size = first_batch_size;
 
         element_pair *d_input, *h_input;
         
@@ -204,7 +243,7 @@ int main(){
             cudaMalloc(&d_input, insert_batch_size*sizeof(element_pair));
             cudaMemcpy(d_input, h_input, insert_batch_size*sizeof(element_pair), cudaMemcpyHostToDevice);
 
-            int block = ceil((float)(map_size*insert_batch_size)/(float)block_size);
+            int block = blocks_for((long long)map_size * insert_batch_size);
 
             search_kernel_pair<<<block, block_size>>>(d_input, d_map, map_size, insert_batch_size);
 
@@ -218,13 +257,15 @@ int main(){
             cudaMalloc(&counter, sizeof(int));
             cudaMemset(counter, 0, sizeof(int));
 
-            block = ceil((float)(map_size)/(float)block_size);
+            block = blocks_for(map_size);
 
             kernel_index_to_fill<<<block, block_size>>>(d_map, d_index_to_fill_in_hash_table, counter, map_size);
             
             cudaDeviceSynchronize();
 
-            block = ceil((float)(insert_batch_size)/(float)block_size);
+            sort_index_to_fill(d_index_to_fill_in_hash_table, counter);
+
+            block = blocks_for(insert_batch_size);
 
             kernel_to_insert<<<block, block_size>>>(d_map, d_input, d_index_to_fill_in_hash_table, insert_batch_size);
 
@@ -278,7 +319,7 @@ int main(){
         
 
 
-        int block = ceil((float)(map_size*insert_batch_size)/(float)block_size);
+        int block = blocks_for((long long)map_size * insert_batch_size);
 
         search_kernel_pair<<<block, block_size>>>(d_input, d_map, map_size, insert_batch_size);
 
@@ -291,13 +332,15 @@ int main(){
         cudaMalloc(&counter, sizeof(int));
         cudaMemset(counter, 0, sizeof(int));
 
-        block = ceil((float)(map_size)/(float)block_size);
+        block = blocks_for(map_size);
 
         kernel_index_to_fill<<<block, block_size>>>(d_map, d_index_to_fill_in_hash_table, counter, map_size);
         
         cudaDeviceSynchronize();
 
-        block = ceil((float)(insert_batch_size)/(float)block_size);
+        sort_index_to_fill(d_index_to_fill_in_hash_table, counter);
+
+        block = blocks_for(insert_batch_size);
 
         kernel_to_insert<<<block, block_size>>>(d_map, d_input, d_index_to_fill_in_hash_table, insert_batch_size);
 
@@ -359,7 +402,7 @@ int main(){
             cudaMemcpy(d_search_input_pair, h_search_input_pair, search_batch_size*sizeof(element_pair), cudaMemcpyHostToDevice);
 
                                       //existing array Size * batch_size
-            int sblock = ceil((float)(map_size*search_batch_size)/(float)block_size);
+            int sblock = blocks_for((long long)map_size * search_batch_size);
 
             search_kernel_pair<<<sblock, block_size>>>(d_search_input_pair, d_map, map_size, search_batch_size);
 
@@ -421,7 +464,7 @@ int main(){
 
 
                                       //existing array Size * batch_size
-            int sblock = ceil((float)(map_size*search_batch_size)/(float)block_size);
+            int sblock = blocks_for((long long)map_size * search_batch_size);
 
             search_kernel_key<<<sblock, block_size>>>(d_search_input_key, d_map, map_size, search_batch_size, d_count);
 
@@ -438,10 +481,11 @@ int main(){
 
 
                                       //existing array Size * batch_size
-            sblock = ceil((float)(map_size*search_batch_size)/(float)block_size);
+            sblock = blocks_for((long long)map_size * search_batch_size);
 
             fill_search_kernel_key<<<sblock, block_size>>>(d_search_input_key, d_map, map_size, search_batch_size, d_search_input_key_ans, d_index);
 
+            thrust::sort(thrust::device, d_search_input_key_ans, d_search_input_key_ans + h_count, pair_less());
 
 
             cudaMemcpy(h_search_input_key_ans, d_search_input_key_ans, h_count*sizeof(element_pair), cudaMemcpyDeviceToHost);
@@ -500,7 +544,7 @@ int main(){
 
 
                                       //existing array Size * batch_size
-            int sblock = ceil((float)(map_size*delete_batch_size)/(float)block_size);
+            int sblock = blocks_for((long long)map_size * delete_batch_size);
 
             delete_kernel_pair<<<sblock, block_size>>>(d_delete_input_pair, d_map, map_size, delete_batch_size);
 
@@ -539,7 +583,7 @@ int main(){
             cudaMemcpy(d_delete_input, h_delete_input, delete_batch_size*sizeof(element), cudaMemcpyHostToDevice);
 
                                       //existing array Size * batch_size
-            int sblock = ceil((float)(map_size*delete_batch_size)/(float)block_size);
+            int sblock = blocks_for((long long)map_size * delete_batch_size);
 
             delete_kernel<<<sblock, block_size>>>(d_delete_input, d_map, map_size, delete_batch_size);
 
@@ -563,7 +607,15 @@ int main(){
     }
     // Delete Code Ended
 
-
+    if(dump_file != NULL){
+        cudaMemcpy(h_map, d_map, map_size * sizeof(cmap), cudaMemcpyDeviceToHost);
+        FILE *f = fopen(dump_file, "wb");
+        if(f == NULL || fwrite(h_map, sizeof(cmap), map_size, f) != (size_t)map_size){
+            perror(dump_file);
+            return 1;
+        }
+        fclose(f);
+    }
 
 
     return 0;
@@ -1,252 +1,1633 @@
-// False sharing
+// Concurrent multimap of (key, value) pairs for OpenMP.
+//
+// The table is laid out like a Swiss table: an array of control bytes,
+// one per slot, and separate arrays of keys and values, probed in groups
+// of MAP_GROUP (16) slots whose control bytes share one 16-byte load.
+// A live slot's control byte is 7 bits of the key's hash; the other states
+// have the top bit set, so they never match a hash fragment:
+//
+//   CTRL_EMPTY        never used, ends a probe sequence
+//   CTRL_TOMB         deleted pair, walked past and reused by inserts
+//   CTRL_BUSY         claimed by an insert still writing key and value
+//   CTRL_MOVED        copied to the next table
+//   CTRL_MOVED_EMPTY  copied while empty, still ends a probe sequence
+//
+// One SSE2 compare of a group's control bytes gives the slots whose
+// fragment matches and the free ones, and only the matching slots' keys
+// are read. Probing goes group by group from the hash and stops at the
+// first group with an empty slot. Every change of state is a
+// compare-and-swap on the control byte, so no locks are needed and any
+// int is a valid key or value.
+//
+// The map grows online. When live pairs and tombstones pass 7/8 of the
+// slots (or an insert finds no free slot), or tombstones alone pass a
+// quarter of them, one thread maps a table with room for twice the live
+// pairs and hangs it off the current one; tombstones are not copied, so
+// under steady deletes the table is rehashed at the same size instead of
+// doubling. From then on every insert and delete copies one chunk of
+// MAP_CHUNK slots before its own work, so the copy is shared by the
+// threads of the batch; the thread that copies the last chunk makes the
+// new table current. A pair is written to the new table before its old
+// slot is marked moved, so a search that meets a moved slot finds the
+// pair further down the chain, and an insert that sees a growth under way
+// copies its own probe sequence before going on in the new table, so a
+// pair never ends up in both. An insert is never dropped: a full table
+// only means waiting for the next one to be mapped. Every insert, search
+// and delete runs inside an epoch guard, which the batch functions take
+// once per thread around their loops, and a replaced table is retired
+// to the epoch domain all maps share (epochShared, the C form of
+// src/runtime/epochReclaim.hpp), which frees it once no thread is still in
+// it.
+//
+// Operations of one kind run concurrently (a batch of inserts, of searches,
+// of deletes); the batch functions do not overlap batches of different
+// kinds, though mapInsert, mapSearchPair and mapDeletePair may be called
+// side by side, as --suite does. Each batch
+// function first finishes any growth still under way, so key searches and
+// deletes only ever see one table. Searches by key alone go through the
+// map's key runs (mapKeepKeyRuns), which hold each key's values in one
+// run and are kept current by every insert and delete.
+//
+// The per-slot omp_lock_t map this replaces is kept below as the baseline
+// for the scaling benchmark:
+//
+//   gcc -O3 -fopenmp MAP_openMP.c -o map -lm
+//   ./map              the insert/search/delete walkthrough
+//   ./map --bench      insert, search and delete time against the locked
+//                      map for 1, 2, 4, ... threads, with the table sized
+//                      up front, grown from MAP_CHUNK slots, and through
+//                      the region-sorted batchInsert/batchFind/batchErase
+//   ./map --stress     concurrent inserts and deletes through many
+//                      growths, checking that no pair is lost
+//   ./map --churn      a sliding window of inserts and deletes, printing
+//                      table size, tombstones and probe lengths over time
+//   ./map --suite      uniform, Zipfian, sequential and colliding keys
+//                      under read/insert/delete mixes, load factors and
+//                      thread counts: Mops/s, probe length percentiles
+//                      and bytes per entry as CSV (options: suiteMain)
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<math.h>
 #include<omp.h>
+#include<pthread.h>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
 #define size 100000
 
+#define CTRL_EMPTY 0x80
+#define CTRL_MOVED_EMPTY 0xFC
+#define CTRL_MOVED 0xFD
+#define CTRL_TOMB 0xFE
+#define CTRL_BUSY 0xFF
+
+#define MAP_GROUP 16
+#define MAP_CHUNK 1024
+
+
+/* Epoch-based reclamation, the C form of src/runtime/epochReclaim.hpp and
+   the same scheme: one domain (epochShared) that every map retires its
+   replaced tables to. A thread inside epochEnter/epochExit announces the
+   global epoch in its own record; the epoch moves on once every thread
+   inside has seen it, and what was retired two epochs back is freed by
+   the thread that moved it. Retired memory waits on one of three
+   lock-free lists, by epoch modulo 3. Every 64th retire and every 1024th
+   exit try to advance; epochCollect advances as far as the readers allow,
+   and with no thread inside frees everything retired. Threads claim a
+   record on first use and give it back when they exit; a thread finding
+   all EPOCH_MAX_THREADS taken aborts. */
+
+#define EPOCH_MAX_THREADS 1024
+#define EPOCH_QUIESCENT 0		//announced outside any guard; epochs start at 2
+
+struct epochRecord{
+	_Alignas(64) uint64_t announced;	//epoch seen on entry, or EPOCH_QUIESCENT
+	int owned;
+	int nesting;
+	unsigned exits;
+};
 
-//Structure of the Map Table
-struct table{
-	int key;
-	int value;
-	int fill;
-	int delet;
+struct epochNode{
+	void *p;
+	void (*release)(void*);
+	uint64_t epoch;			//of the retiring thread
+	struct epochNode *next;
 };
 
+static struct{
+	uint64_t epoch;
+	struct epochNode *limbo[3];
+	int records;			//high water of claimed records
+	unsigned retires;
+	struct epochRecord table[EPOCH_MAX_THREADS];
+} epochShared = { .epoch = 2 };
+
+static _Thread_local struct epochRecord *epochMine;
+static pthread_key_t epochExitKey;
+static pthread_once_t epochExitOnce = PTHREAD_ONCE_INIT;
+
+//gives the record back when its thread exits
+static void epochRecordRelease(void *record){
+	struct epochRecord *r = (struct epochRecord*)record;
+	__atomic_store_n(&r->announced, EPOCH_QUIESCENT, __ATOMIC_RELEASE);
+	__atomic_store_n(&r->owned, 0, __ATOMIC_RELEASE);
+}
 
-//Structure of the Element 
-struct element{
-	int key;
-	int value;
+static void epochExitKeyCreate(void){
+	pthread_key_create(&epochExitKey, epochRecordRelease);
+}
+
+static struct epochRecord *epochRecordClaim(void){
+
+	pthread_once(&epochExitOnce, epochExitKeyCreate);
+	for(int i=0 ; i<EPOCH_MAX_THREADS ; i++){
+		int free = 0;
+		if(__atomic_load_n(&epochShared.table[i].owned, __ATOMIC_RELAXED) == 0
+				&& __atomic_compare_exchange_n(&epochShared.table[i].owned, &free, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)){
+			int high = __atomic_load_n(&epochShared.records, __ATOMIC_ACQUIRE);
+			while(high < i + 1 && !__atomic_compare_exchange_n(&epochShared.records, &high, i + 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				;
+			epochMine = &epochShared.table[i];
+			pthread_setspecific(epochExitKey, epochMine);
+			return epochMine;
+		}
+	}
+	fprintf(stderr, "epochShared: more than %d threads at once\n", EPOCH_MAX_THREADS);
+	abort();
+
+}
+
+static inline struct epochRecord *epochRecordMine(void){
+	return epochMine != NULL ? epochMine : epochRecordClaim();
+}
+
+static void epochPush(struct epochNode **list, struct epochNode *first, struct epochNode *last){
+	last->next = __atomic_load_n(list, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(list, &last->next, first, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+}
+
+//frees the nodes of list retired in safe or before, putting the rest back
+static void epochRelease(struct epochNode **list, uint64_t safe){
+
+	struct epochNode *n = __atomic_exchange_n(list, NULL, __ATOMIC_ACQ_REL);
+	struct epochNode *keep = NULL, *keepLast = NULL;
+	while(n != NULL){
+		struct epochNode *next = n->next;
+		if(n->epoch <= safe){
+			n->release(n->p);
+			free(n);
+		}
+		else{
+			n->next = keep;
+			keep = n;
+			if(keepLast == NULL)
+				keepLast = n;
+		}
+		n = next;
+	}
+	if(keep != NULL)
+		epochPush(list, keep, keepLast);
+
+}
+
+//moves the epoch on by one if every thread inside has seen it, freeing what was retired two epochs back
+static int epochTryAdvance(void){
+
+	uint64_t e = __atomic_load_n(&epochShared.epoch, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int high = __atomic_load_n(&epochShared.records, __ATOMIC_ACQUIRE);
+	for(int i=0 ; i<high ; i++){
+		uint64_t a = __atomic_load_n(&epochShared.table[i].announced, __ATOMIC_ACQUIRE);
+		if(a != EPOCH_QUIESCENT && a != e)
+			return 0;
+	}
+	if(!__atomic_compare_exchange_n(&epochShared.epoch, &e, e + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return 0;
+	epochRelease(&epochShared.limbo[(e + 1) % 3], e - 2);
+	return 1;
+
+}
+
+//announces the epoch on entering the outermost guard
+static void epochAnnounce(struct epochRecord *r){
+
+	uint64_t e = __atomic_load_n(&epochShared.epoch, __ATOMIC_RELAXED);
+	__atomic_store_n(&r->announced, e, __ATOMIC_RELAXED);
+	//the announcement must be visible before any load of a table
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	//an advance in between would leave us announced behind: catch up
+	uint64_t now = __atomic_load_n(&epochShared.epoch, __ATOMIC_RELAXED);
+	if(now != e){
+		__atomic_store_n(&r->announced, now, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+
+}
+
+static void epochLeave(struct epochRecord *r){
+	__atomic_store_n(&r->announced, EPOCH_QUIESCENT, __ATOMIC_RELEASE);
+	if((++r->exits & 1023) == 0)
+		epochTryAdvance();
+}
+
+//the scope of any access to a map's tables; nests
+static inline void epochEnter(void){
+	struct epochRecord *r = epochRecordMine();
+	if(r->nesting++ == 0)
+		epochAnnounce(r);
+}
+
+static inline void epochExit(void){
+	struct epochRecord *r = epochMine;
+	if(--r->nesting == 0)
+		epochLeave(r);
+}
+
+//frees p with release(p) once no thread can still be reading it
+static void epochRetire(void *p, void (*release)(void*)){
+
+	epochEnter();
+	struct epochNode *n = (struct epochNode*)malloc(sizeof(struct epochNode));
+	n->p = p;
+	n->release = release;
+	n->epoch = __atomic_load_n(&epochRecordMine()->announced, __ATOMIC_RELAXED);
+	epochPush(&epochShared.limbo[n->epoch % 3], n, n);
+	epochExit();
+	if((__atomic_fetch_add(&epochShared.retires, 1, __ATOMIC_RELAXED) & 63) == 63)
+		epochTryAdvance();
+
+}
+
+//advances as far as the readers allow; with no thread inside, frees everything retired
+static void epochCollect(void){
+	for(int i=0 ; i<3 && epochTryAdvance() ; i++)
+		;
+}
+
+//retired memory not freed yet
+static int epochPending(void){
+	int pending = 0;
+	for(int i=0 ; i<3 ; i++)
+		for(struct epochNode *n = __atomic_load_n(&epochShared.limbo[i], __ATOMIC_ACQUIRE) ; n != NULL ; n = n->next)
+			pending++;
+	return pending;
+}
+
+
+//Structure of the lock-free Map Table
+struct mapTable{
+	uint8_t *ctrl;			//one control byte per slot, groups 16-byte aligned
+	int *keys;
+	int *values;
+	unsigned groupMask;		//groups - 1, groups a power of two
+	unsigned used;			//slots ever filled: live pairs and tombstones
+	unsigned tombs;			//tombstones: deletes less the ones reused by inserts
+	int growing;			//set by the thread that maps the next table
+	struct mapTable *next;		//the table being copied into, or NULL
+	unsigned cursor;		//next chunk to copy
+	unsigned copied;		//chunks copied
 };
 
+struct lfMap{
+	struct mapTable *current;
+	struct keyRuns *runs;		//values grouped by key, or NULL (mapKeepKeyRuns)
+};
 
-//Defining Lock for each index of Map Table 
-omp_lock_t lock[size];
+//kept current by the map once attached, see keyRunsBuild
+struct keyRuns;
+static void keyRunsAdd(struct keyRuns *runs, int key, int value);
+static void keyRunsRemove(struct keyRuns *runs, int key, int value);
+static void keyRunsDrop(struct keyRuns *runs, int key);
+static void keyRunsReserve(struct keyRuns *runs, int n);
+void keyRunsFree(struct keyRuns *runs);
+
+
+//one bit per slot of a group, from a single load of its control bytes
+struct groupMasks{
+	unsigned match;		//fragment equal to the key's
+	unsigned empty;
+	unsigned tomb;
+	unsigned busy;
+	unsigned moved;		//moved, whether it was empty or not
+	unsigned ends;		//empty now or when it was moved
+};
 
+static inline struct groupMasks scanGroup(const uint8_t *ctrl, uint8_t fragment){
+
+	struct groupMasks m;
+#ifdef __SSE2__
+	__m128i group = _mm_load_si128((const __m128i*)ctrl);
+	m.match = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)fragment)));
+	m.empty = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_EMPTY)));
+	m.tomb = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_TOMB)));
+	m.busy = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_BUSY)));
+	unsigned movedEmpty = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_MOVED_EMPTY)));
+	m.moved = movedEmpty | _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_MOVED)));
+	m.ends = m.empty | movedEmpty;
+#else
+	m.match = m.empty = m.tomb = m.busy = m.moved = m.ends = 0;
+	for(int i=0 ; i<MAP_GROUP ; i++){
+		uint8_t c = __atomic_load_n(&ctrl[i], __ATOMIC_RELAXED);
+		m.match |= (unsigned)(c == fragment) << i;
+		m.empty |= (unsigned)(c == CTRL_EMPTY) << i;
+		m.tomb |= (unsigned)(c == CTRL_TOMB) << i;
+		m.busy |= (unsigned)(c == CTRL_BUSY) << i;
+		m.moved |= (unsigned)(c == CTRL_MOVED || c == CTRL_MOVED_EMPTY) << i;
+		m.ends |= (unsigned)(c == CTRL_EMPTY || c == CTRL_MOVED_EMPTY) << i;
+	}
+#endif
+	return m;
 
-//Hash Function(Should not be linear)
-int doubleDashingFunction(int num, int i){
+}
 
-	int f1 = (num);
-	// int f2 = (num%5);
-	return (f1+(i*i))%size;
+//live slots of a group: the control bytes without the top bit
+static inline int groupLive(const uint8_t *ctrl){
+#ifdef __SSE2__
+	return MAP_GROUP - __builtin_popcount(_mm_movemask_epi8(_mm_load_si128((const __m128i*)ctrl)));
+#else
+	int live = 0;
+	for(int i=0 ; i<MAP_GROUP ; i++)
+		live += __atomic_load_n(&ctrl[i], __ATOMIC_RELAXED) < 0x80;
+	return live;
+#endif
+}
 
+//slot at is slot at % MAP_GROUP of group at / MAP_GROUP
+static inline uint8_t *groupCtrl(struct mapTable *table, unsigned group){
+	return table->ctrl + group*MAP_GROUP;
 }
 
-void insertFun(int insertSize, int (*insertEl)[2], int *workDone, int *searchDone, struct table *mapTable){
+static inline uint8_t *ctrlAt(struct mapTable *table, unsigned at){
+	return &table->ctrl[at];
+}
 
-	#pragma omp for
-	for(int i=0 ; i<insertSize ; i++){
+static inline int *keyAt(struct mapTable *table, unsigned at){
+	return &table->keys[at];
+}
 
-		//taking key and value from input
-		int key, value, hashedVal;
-		key = insertEl[i][0];
-		value = insertEl[i][1];	
+static inline int *valueAt(struct mapTable *table, unsigned at){
+	return &table->values[at];
+}
 
-		//counter helps in probing
-		int counter = 0;
+//the group scan is only a hint: a slot's byte is read again before its key is trusted
+static inline uint8_t loadCtrl(struct mapTable *table, unsigned at){
+	return __atomic_load_n(ctrlAt(table, at), __ATOMIC_ACQUIRE);
+}
 
-		//Run the loop untill the insertion is not marked
-		while(!workDone[i] && !searchDone[i]){
+static inline int casCtrl(struct mapTable *table, unsigned at, uint8_t *expected, uint8_t desired){
+	return __atomic_compare_exchange_n(ctrlAt(table, at), expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
 
-			// printf("tid = %d and key = %d\n", omp_get_thread_num(), key);
-			hashedVal = doubleDashingFunction(key, counter);
-			// printf(" hashedVal = %d \n", hashedVal);
+static inline struct mapTable *nextTable(struct mapTable *table){
+	return __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+}
 
-			//Check the condition if the respective postion is occupied or not
-			if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){
+static inline unsigned tableSlots(struct mapTable *table){
+	return (table->groupMask + 1) * MAP_GROUP;
+}
 
-				//lock the respective index of Map Table where we have to insert
-				omp_set_lock(&lock[hashedVal]);
 
-				//Again checking so that other thread should not fill at same location
-				if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){						
+//Hash Function: consecutive keys must not land in consecutive slots
+static inline unsigned hashKey(int key){
 
-					mapTable[hashedVal].key = key;
-					mapTable[hashedVal].value = value;
+	uint32_t h = (uint32_t)key;
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	h *= 0x846ca68b;
+	h ^= h >> 16;
+	return h;
 
-					if(mapTable[hashedVal].fill==0)
-						mapTable[hashedVal].fill=1;
-					else
-						mapTable[hashedVal].delet=0;
+}
 
-					workDone[i] = 1;
+//the low 7 bits go to the control byte, the rest pick the first group
+static inline uint8_t hashFragment(unsigned h){
+	return h & 0x7F;
+}
 
-					//Unset the lock
-					omp_unset_lock(&lock[hashedVal]);		
+static inline unsigned homeGroup(struct mapTable *table, unsigned h){
+	return (h >> 7) & table->groupMask;
+}
 
-				}
-				else{
 
-					counter++;
-					//After one round of traversal of whole Map Table, break out loop
-					if(counter>30){
-						//Unset the lock
-						omp_unset_lock(&lock[hashedVal]);	//I don't think it is required here					
-						break;	
-					}
+static struct mapTable *tableCreate(unsigned groups){
+
+	size_t slots = (size_t)groups*MAP_GROUP;
+	struct mapTable *table = (struct mapTable*)calloc(1, sizeof(struct mapTable));
+	table->ctrl = (uint8_t*)aligned_alloc(64, slots);
+	table->keys = (int*)aligned_alloc(64, slots*sizeof(int));
+	table->values = (int*)aligned_alloc(64, slots*sizeof(int));
+	table->groupMask = groups - 1;
+
+	#pragma omp parallel for if(!omp_in_parallel())
+	for(unsigned group=0 ; group<groups ; group++)
+		memset(groupCtrl(table, group), CTRL_EMPTY, MAP_GROUP);
+
+	return table;
+
+}
+
+static void tableFree(struct mapTable *table){
+	free(table->ctrl);
+	free(table->keys);
+	free(table->values);
+	free(table);
+}
+
+static void tableRelease(void *table){
+	tableFree((struct mapTable*)table);
+}
+
+struct lfMap *mapCreate(int capacity){
+
+	unsigned groups = 16;
+	while(groups*MAP_GROUP < (unsigned)capacity)
+		groups <<= 1;
+
+	struct lfMap *map = (struct lfMap*)malloc(sizeof(struct lfMap));
+	map->current = tableCreate(groups);
+	map->runs = NULL;
+	return map;
+
+}
+
+//maps the table to move into, once per table; others go on meanwhile. It is
+//sized for the live pairs and extra more at half load, so a table filled up
+//with tombstones is rehashed at its own size (or smaller) instead of doubled
+static void startGrowth(struct mapTable *table, unsigned extra){
+
+	if(nextTable(table) != NULL || __atomic_exchange_n(&table->growing, 1, __ATOMIC_ACQ_REL))
+		return;
+	unsigned used = __atomic_load_n(&table->used, __ATOMIC_RELAXED);
+	unsigned tombs = __atomic_load_n(&table->tombs, __ATOMIC_RELAXED);
+	unsigned live = (used > tombs ? used - tombs : 0) + extra;
+	unsigned groups = 16;
+	while(groups*MAP_GROUP < 2*live)
+		groups <<= 1;
+	struct mapTable *next = tableCreate(groups);
+	__atomic_store_n(&table->next, next, __ATOMIC_RELEASE);
 
+}
+
+//deletes left n more tombstones: past a quarter of the slots the table is rehashed
+static inline void addTombs(struct mapTable *table, unsigned n){
+	if(__atomic_add_fetch(&table->tombs, n, __ATOMIC_RELAXED) > tableSlots(table) / 4)
+		startGrowth(table, 0);
+}
+
+static int tableInsert(struct lfMap *map, struct mapTable *table, int key, int value);
+static int tableDelete(struct mapTable *table, int key, int value);
+
+static inline unsigned chunkCount(struct mapTable *table){
+	return (tableSlots(table) + MAP_CHUNK - 1) / MAP_CHUNK;
+}
+
+//copies one slot: the pair goes into next before the slot is marked moved;
+//returns whether the slot was empty, which still ends probe sequences
+static int moveSlot(struct lfMap *map, struct mapTable *table, struct mapTable *next, unsigned at){
+
+	while(1){
+
+		uint8_t c = loadCtrl(table, at);
+		if(c == CTRL_MOVED || c == CTRL_MOVED_EMPTY)
+			return c == CTRL_MOVED_EMPTY;
+		//an insert is still writing the slot
+		if(c == CTRL_BUSY)
+			continue;
+		int key = 0, value = 0;
+		if(c < 0x80){
+			key = *keyAt(table, at);
+			value = *valueAt(table, at);
+			tableInsert(map, next, key, value);
+		}
+		uint8_t seen = c;
+		if(casCtrl(table, at, &seen, c == CTRL_EMPTY ? CTRL_MOVED_EMPTY : CTRL_MOVED))
+			return c == CTRL_EMPTY;
+		//deleted while being copied: take the copy back out too (another mover leaves it be)
+		if(c < 0x80 && seen == CTRL_TOMB)
+			tableDelete(next, key, value);
+
+	}
+
+}
+
+//makes the first table that is still being copied current, retiring the ones before it
+static void advanceCurrent(struct lfMap *map){
+
+	struct mapTable *table;
+	while((table = __atomic_load_n(&map->current, __ATOMIC_ACQUIRE))->next != NULL
+			&& __atomic_load_n(&table->copied, __ATOMIC_ACQUIRE) == chunkCount(table)){
+		struct mapTable *expected = table;
+		if(__atomic_compare_exchange_n(&map->current, &expected, table->next, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			epochRetire(table, tableRelease);
+	}
+
+}
+
+//copies one chunk of table into its next table, if any is left
+static void helpGrowth(struct lfMap *map, struct mapTable *table){
+
+	struct mapTable *next = nextTable(table);
+	unsigned chunk = __atomic_fetch_add(&table->cursor, 1, __ATOMIC_ACQ_REL);
+	if(chunk >= chunkCount(table))
+		return;
+
+	for(unsigned at=chunk*MAP_CHUNK ; at<(chunk+1)*MAP_CHUNK && at<tableSlots(table) ; at++)
+		moveSlot(map, table, next, at);
+
+	if(__atomic_add_fetch(&table->copied, 1, __ATOMIC_ACQ_REL) == chunkCount(table))
+		advanceCurrent(map);
+
+}
+
+static int tableSearch(struct mapTable *table, int key, int value){
+
+	unsigned h = hashKey(key);
+	uint8_t fragment = hashFragment(h);
+	for(; table != NULL ; table = nextTable(table)){
+		unsigned group = homeGroup(table, h);
+		for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+			struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+			for(unsigned bits=m.match ; bits ; bits&=bits-1){
+				unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+				if(loadCtrl(table, at) == fragment && *keyAt(table, at) == key && *valueAt(table, at) == value)
+					return 1;
+			}
+			if(m.ends)
+				break;
+		}
+	}
+	return 0;
+
+}
+
+//1 if inserted, 0 if the pair was already there
+static int tableInsert(struct lfMap *map, struct mapTable *table, int key, int value){
+
+	unsigned h = hashKey(key);
+	uint8_t fragment = hashFragment(h);
+
+	while(1){
+
+		struct mapTable *next = nextTable(table);
+		if(next != NULL){
+			//copy the pair's probe sequence first: once its end is marked moved no
+			//thread can still add the pair here, so it is only ever inserted in next
+			helpGrowth(map, table);
+			unsigned group = homeGroup(table, h);
+			for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+				int ends = 0;
+				for(unsigned at=group*MAP_GROUP ; at<(group+1)*MAP_GROUP ; at++)
+					ends |= moveSlot(map, table, next, at);
+				if(ends)
+					break;
+			}
+			table = next;
+			continue;
+		}
+
+		//find the pair or the end of the probe sequence, remembering the first free slot
+		unsigned group = homeGroup(table, h);
+		unsigned freeAt = 0;
+		uint8_t freeCtrl = 0;
+		int haveFree = 0, moved = 0, busy = 0, found = 0;
+
+		for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+
+			struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+			for(unsigned bits=m.match ; bits ; bits&=bits-1){
+				unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+				if(loadCtrl(table, at) == fragment && *keyAt(table, at) == key && *valueAt(table, at) == value)
+					found = 1;
+			}
+			if(found)
+				return 0;
+			//a claimed slot may be this very pair: wait until it is written
+			if(m.busy){
+				busy = 1;
+				break;
+			}
+			if(m.moved){
+				moved = 1;
+				break;
+			}
+			unsigned free = m.empty | m.tomb;
+			if(!haveFree && free){
+				unsigned bit = __builtin_ctz(free);
+				freeAt = group*MAP_GROUP + bit;
+				freeCtrl = (m.empty >> bit) & 1 ? CTRL_EMPTY : CTRL_TOMB;
+				haveFree = 1;
+			}
+			if(m.empty)
+				break;
+
+		}
+
+		if(busy)
+			continue;
+
+		//growth started under us, or the table is full: go on in the next table
+		if(moved || !haveFree){
+			startGrowth(table, 0);
+			while(nextTable(table) == NULL)
+				;
+			continue;
+		}
+
+		//another thread took the slot first: probe again, it may have inserted this pair
+		uint8_t seen = freeCtrl;
+		if(!casCtrl(table, freeAt, &seen, CTRL_BUSY))
+			continue;
+		*keyAt(table, freeAt) = key;
+		*valueAt(table, freeAt) = value;
+		__atomic_store_n(ctrlAt(table, freeAt), fragment, __ATOMIC_RELEASE);
+
+		if(freeCtrl == CTRL_EMPTY){
+			unsigned used = __atomic_add_fetch(&table->used, 1, __ATOMIC_RELAXED);
+			if(used > tableSlots(table) / 8 * 7)
+				startGrowth(table, 0);
+		}
+		else
+			__atomic_sub_fetch(&table->tombs, 1, __ATOMIC_RELAXED);
+		return 1;
+
+	}
+
+}
+
+//removes the pair from the table and every table it is being copied into
+static int tableDelete(struct mapTable *table, int key, int value){
+
+	unsigned h = hashKey(key);
+	uint8_t fragment = hashFragment(h);
+	int deleted = 0;
+
+	for(; table != NULL ; table = nextTable(table)){
+		unsigned group = homeGroup(table, h);
+		int done = 0;
+		for(unsigned probes=0 ; probes<=table->groupMask && !done ; probes++, group=(group+1) & table->groupMask){
+			struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+			for(unsigned bits=m.match ; bits && !done ; bits&=bits-1){
+				unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+				uint8_t seen = fragment;
+				//only one thread can turn this slot into a tombstone; a moved one is deleted further down the chain
+				if(loadCtrl(table, at) == fragment && *keyAt(table, at) == key && *valueAt(table, at) == value){
+					if(casCtrl(table, at, &seen, CTRL_TOMB)){
+						addTombs(table, 1);
+						deleted = 1;
+					}
+					done = 1;
 				}
+			}
+			if(m.ends)
+				break;
+		}
+	}
+	return deleted;
 
-			}else{
+}
 
-				counter++;
-				//After one round of traversal of whole Map Table, break out loop
-				if(counter>30){
-						break;	
+//these three are called inside an epoch guard, so a table replaced under
+//them stays readable; the batch functions take one per thread
+//1 if inserted, 0 if the pair was already there
+int mapInsert(struct lfMap *map, int key, int value){
+	int inserted = tableInsert(map, __atomic_load_n(&map->current, __ATOMIC_ACQUIRE), key, value);
+	if(inserted == 1 && map->runs != NULL)
+		keyRunsAdd(map->runs, key, value);
+	return inserted;
+}
+
+int mapSearchPair(struct lfMap *map, int key, int value){
+	return tableSearch(__atomic_load_n(&map->current, __ATOMIC_ACQUIRE), key, value);
+}
+
+//deletes share the copy of a rehash under way like inserts do
+int mapDeletePair(struct lfMap *map, int key, int value){
+	struct mapTable *table = __atomic_load_n(&map->current, __ATOMIC_ACQUIRE);
+	if(nextTable(table) != NULL)
+		helpGrowth(map, table);
+	int deleted = tableDelete(table, key, value);
+	if(deleted && map->runs != NULL)
+		keyRunsRemove(map->runs, key, value);
+	return deleted;
+}
+
+//between batches: finishes a growth under way with all threads and frees
+//the replaced tables no thread is still in
+void mapSettle(struct lfMap *map){
+
+	if(nextTable(map->current) != NULL){
+		#pragma omp parallel
+		{
+			epochEnter();
+			struct mapTable *table;
+			while(nextTable(table = __atomic_load_n(&map->current, __ATOMIC_ACQUIRE)) != NULL)
+				helpGrowth(map, table);
+			epochExit();
+		}
+	}
+
+	epochCollect();
+
+}
+
+void mapDestroy(struct lfMap *map){
+	mapSettle(map);
+	if(map->runs != NULL)
+		keyRunsFree(map->runs);
+	tableFree(map->current);
+	free(map);
+}
+
+//slots of the table once any growth under way is finished
+int mapCapacity(struct lfMap *map){
+	mapSettle(map);
+	return tableSlots(map->current);
+}
+
+
+/* Batch operations, as used by main */
+
+void insertFun(int insertSize, int (*insertEl)[2], int *workDone, int *searchDone, struct lfMap *map){
+
+	mapSettle(map);
+	if(map->runs != NULL)
+		keyRunsReserve(map->runs, insertSize);
+
+	#pragma omp parallel
+	{
+		epochEnter();
+		#pragma omp for
+		for(int i=0 ; i<insertSize ; i++){
+
+			if(workDone[i] || searchDone[i])
+				continue;
+
+			int inserted = mapInsert(map, insertEl[i][0], insertEl[i][1]);
+			if(inserted == 1)
+				workDone[i] = 1;
+			else if(inserted == 0)
+				searchDone[i] = 1;
+
+		}
+		epochExit();
+	}
+
+}
+
+void searchPairFun(int searchSize, int (*searchEl)[2], int *searchDone, struct lfMap *map){
+
+	mapSettle(map);
+
+	#pragma omp parallel
+	{
+		epochEnter();
+		#pragma omp for
+		for (int i = 0; i < searchSize; ++i)
+			searchDone[i] = mapSearchPair(map, searchEl[i][0], searchEl[i][1]);
+		epochExit();
+	}
+
+}
+
+void deletePairFun(int deletBatchSize, int (*deletBatchEl)[2], int *checkDel, struct lfMap *map){
+
+	mapSettle(map);
+
+	#pragma omp parallel
+	{
+		epochEnter();
+		#pragma omp for
+		for(int i=0 ; i<deletBatchSize ; i++)
+			checkDel[i] = mapDeletePair(map, deletBatchEl[i][0], deletBatchEl[i][1]);
+		epochExit();
+	}
+
+}
+
+void deletKeyFun(int deletBatchSize, int *deletBatchEl, int *checkDel, struct lfMap *map){
+
+	mapSettle(map);
+	struct mapTable *table = map->current;
+	int deleted = 0;
+
+	#pragma omp parallel for reduction(+ : deleted)
+	for(int i=0 ; i<deletBatchSize ; i++){
+
+		int key = deletBatchEl[i];
+		unsigned h = hashKey(key);
+		uint8_t fragment = hashFragment(h);
+		unsigned group = homeGroup(table, h);
+		checkDel[i] = 0;
+		for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+			struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+			for(unsigned bits=m.match ; bits ; bits&=bits-1){
+				unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+				uint8_t seen = fragment;
+				if(*keyAt(table, at) == key && casCtrl(table, at, &seen, CTRL_TOMB))
+					checkDel[i]++;
+			}
+			if(m.ends)
+				break;
+		}
+		deleted += checkDel[i];
+		if(checkDel[i] && map->runs != NULL)
+			keyRunsDrop(map->runs, key);
+
+	}
+
+	//the rehash this may start is done by the next batch
+	addTombs(table, deleted);
+
+}
+
+int mapCount(struct lfMap *map){
+
+	mapSettle(map);
+	struct mapTable *table = map->current;
+
+	int total = 0;
+	#pragma omp parallel for reduction(+ : total)
+	for(unsigned group=0 ; group<=table->groupMask ; group++)
+		total += groupLive(groupCtrl(table, group));
+	return total;
+
+}
+
+
+/* Sorted batches: a counting sort groups the pairs by the region of the
+   table their probe starts in (1 << MAP_REGION_SHIFT groups, 4096 slots), and
+   each region's pairs are done by one thread in a row, so a batch of
+   millions walks the table region by region instead of jumping across it.
+   Inserts and erases also own their slots this way: even regions run
+   first, then odd ones, so a probe running on into the next region never
+   meets another thread and needs no compare-and-swap. The rare probe that
+   runs past the next region too is left over and done with the atomic
+   path after the two phases. */
+
+#define MAP_REGION_SHIFT 8
+
+//a pair copied out in region order, with where its answer goes
+struct batchEntry{
+	int key;
+	int value;
+	unsigned hash;
+	int index;
+};
+
+struct batchOrder{
+	struct batchEntry *entries;	//the batch grouped by region
+	int *start;			//region r is entries[start[r] .. start[r+1])
+	int regions;
+};
+
+//counting sort of the batch by region, each thread counting and placing its own block
+static void batchSort(struct batchOrder *batch, struct mapTable *table, int n, int (*pairs)[2]){
+
+	unsigned groups = table->groupMask + 1;
+	int regions = groups >> MAP_REGION_SHIFT ? groups >> MAP_REGION_SHIFT : 1;
+	int threads = omp_get_max_threads();
+	int *counts = (int*)calloc((size_t)regions*threads, sizeof(int));
+
+	batch->entries = (struct batchEntry*)malloc((n ? n : 1)*sizeof(struct batchEntry));
+	batch->start = (int*)malloc((regions + 1)*sizeof(int));
+	batch->regions = regions;
+
+	#pragma omp parallel num_threads(threads)
+	{
+		int t = omp_get_thread_num(), team = omp_get_num_threads();
+		int lo = (int)((long)n*t/team), hi = (int)((long)n*(t+1)/team);
+		int *count = counts + (size_t)regions*t;
+		for(int i=lo ; i<hi ; i++)
+			count[homeGroup(table, hashKey(pairs[i][0])) >> MAP_REGION_SHIFT]++;
+		#pragma omp barrier
+		#pragma omp single
+		{
+			int at = 0;
+			for(int r=0 ; r<regions ; r++){
+				batch->start[r] = at;
+				for(int u=0 ; u<team ; u++){
+					int c = counts[(size_t)regions*u + r];
+					counts[(size_t)regions*u + r] = at;
+					at += c;
 				}
+			}
+			batch->start[regions] = at;
+		}
+		for(int i=lo ; i<hi ; i++){
+			unsigned h = hashKey(pairs[i][0]);
+			struct batchEntry *e = &batch->entries[count[homeGroup(table, h) >> MAP_REGION_SHIFT]++];
+			e->key = pairs[i][0];
+			e->value = pairs[i][1];
+			e->hash = h;
+			e->index = i;
+		}
+	}
+
+	free(counts);
+
+}
+
+static void batchFree(struct batchOrder *batch){
+	free(batch->entries);
+	free(batch->start);
+}
+
+//whether group is in region or the one after it, the slots its owner may touch
+static inline int batchOwns(struct mapTable *table, int regions, int region, unsigned group){
+	if(regions <= 2)
+		return 1;
+	return ((group - ((unsigned)region << MAP_REGION_SHIFT)) & table->groupMask) < (2u << MAP_REGION_SHIFT);
+}
+
+//grows the table up front so a batch of n inserts cannot start a growth
+static void mapReserve(struct lfMap *map, int n){
+	mapSettle(map);
+	while(map->current->used + (unsigned)n > tableSlots(map->current) / 8 * 7){
+		startGrowth(map->current, n);
+		mapSettle(map);
+	}
+}
+
+//the insert of tableInsert with plain stores: 1 inserted, 0 there already, -1 probe left the owned regions
+static int ownedInsert(struct mapTable *table, int regions, int region, unsigned h, int key, int value, unsigned *used, unsigned *reused){
+
+	uint8_t fragment = hashFragment(h);
+	unsigned group = homeGroup(table, h);
+	unsigned freeAt = 0;
+	int haveFree = 0, fresh = 0;
+
+	for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+		if(!batchOwns(table, regions, region, group))
+			return -1;
+		struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+		for(unsigned bits=m.match ; bits ; bits&=bits-1){
+			unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+			if(*keyAt(table, at) == key && *valueAt(table, at) == value)
+				return 0;
+		}
+		unsigned free = m.empty | m.tomb;
+		if(!haveFree && free){
+			unsigned bit = __builtin_ctz(free);
+			freeAt = group*MAP_GROUP + bit;
+			fresh = (m.empty >> bit) & 1;
+			haveFree = 1;
+		}
+		if(m.empty)
+			break;
+	}
+
+	if(!haveFree)
+		return -1;
+	*keyAt(table, freeAt) = key;
+	*valueAt(table, freeAt) = value;
+	*ctrlAt(table, freeAt) = fragment;
+	*used += fresh;
+	*reused += !fresh;
+	return 1;
+
+}
+
+//1 if the pair was turned into a tombstone, 0 if not there, -1 probe left the owned regions
+static int ownedErase(struct mapTable *table, int regions, int region, unsigned h, int key, int value){
+
+	uint8_t fragment = hashFragment(h);
+	unsigned group = homeGroup(table, h);
+
+	for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+		if(!batchOwns(table, regions, region, group))
+			return -1;
+		struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+		for(unsigned bits=m.match ; bits ; bits&=bits-1){
+			unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+			if(*keyAt(table, at) == key && *valueAt(table, at) == value){
+				*ctrlAt(table, at) = CTRL_TOMB;
+				return 1;
+			}
+		}
+		if(m.ends)
+			break;
+	}
+	return 0;
+
+}
 
+//inserted[i] is 1 if pair i went in, 0 if it was in the map or earlier in the batch
+void batchInsert(int insertSize, int (*insertEl)[2], int *inserted, struct lfMap *map){
+
+	mapReserve(map, insertSize);
+	if(map->runs != NULL)
+		keyRunsReserve(map->runs, insertSize);
+	struct mapTable *table = map->current;
+	struct batchOrder batch;
+	batchSort(&batch, table, insertSize, insertEl);
+	unsigned used = 0, reused = 0;
+
+	for(int phase=0 ; phase<2 ; phase++){
+		#pragma omp parallel for schedule(dynamic) reduction(+ : used, reused)
+		for(int region=phase ; region<batch.regions ; region+=2){
+			for(int j=batch.start[region] ; j<batch.start[region+1] ; j++){
+				struct batchEntry *e = &batch.entries[j];
+				inserted[e->index] = ownedInsert(table, batch.regions, region, e->hash, e->key, e->value, &used, &reused);
 			}
-			// printf("tid = %d and key = %d value = %d and work=%d and counter = %d\n", omp_get_thread_num(), key, value, workDone[i], counter);
 		}
+	}
+	table->used += used;
+	table->tombs -= reused;
+
+	//the leftovers below go through mapInsert, which adds their runs itself
+	if(map->runs != NULL){
+		#pragma omp parallel for schedule(dynamic, 1024)
+		for(int i=0 ; i<insertSize ; i++)
+			if(inserted[i] == 1)
+				keyRunsAdd(map->runs, insertEl[i][0], insertEl[i][1]);
+	}
 
+	#pragma omp parallel
+	{
+		epochEnter();
+		#pragma omp for schedule(dynamic, 64)
+		for(int i=0 ; i<insertSize ; i++)
+			if(inserted[i] < 0)
+				inserted[i] = mapInsert(map, insertEl[i][0], insertEl[i][1]);
+		epochExit();
 	}
 
+	batchFree(&batch);
+
 }
 
+void batchFind(int searchSize, int (*searchEl)[2], int *found, struct lfMap *map){
 
+	mapSettle(map);
+	struct mapTable *table = map->current;
+	struct batchOrder batch;
+	batchSort(&batch, table, searchSize, searchEl);
 
-void searchPairFun(int searchSize, int (*searchEl)[2], int *searchDone, struct table *mapTable){
+	#pragma omp parallel for schedule(dynamic)
+	for(int region=0 ; region<batch.regions ; region++){
+		for(int j=batch.start[region] ; j<batch.start[region+1] ; j++){
+			struct batchEntry *e = &batch.entries[j];
+			found[e->index] = tableSearch(table, e->key, e->value);
+		}
+	}
 
-	//Start of Directive to run all iteration in parallel 
-	#pragma omp parallel for
-	for (int i = 0; i < searchSize; ++i)
+	batchFree(&batch);
+
+}
+
+//erased[i] is 1 if pair i was deleted by this batch
+void batchErase(int deletBatchSize, int (*deletBatchEl)[2], int *erased, struct lfMap *map){
+
+	mapSettle(map);
+	struct mapTable *table = map->current;
+	struct batchOrder batch;
+	batchSort(&batch, table, deletBatchSize, deletBatchEl);
+
+	int tombs = 0;
+	for(int phase=0 ; phase<2 ; phase++){
+		#pragma omp parallel for schedule(dynamic) reduction(+ : tombs)
+		for(int region=phase ; region<batch.regions ; region+=2){
+			for(int j=batch.start[region] ; j<batch.start[region+1] ; j++){
+				struct batchEntry *e = &batch.entries[j];
+				erased[e->index] = ownedErase(table, batch.regions, region, e->hash, e->key, e->value);
+				tombs += erased[e->index] == 1;
+			}
+		}
+	}
+	addTombs(table, tombs);
+
+	if(map->runs != NULL){
+		#pragma omp parallel for schedule(dynamic, 1024)
+		for(int i=0 ; i<deletBatchSize ; i++)
+			if(erased[i] == 1)
+				keyRunsRemove(map->runs, deletBatchEl[i][0], deletBatchEl[i][1]);
+	}
+
+	#pragma omp parallel
 	{
-		int key, value, hashedVal;
+		epochEnter();
+		#pragma omp for schedule(dynamic, 64)
+		for(int i=0 ; i<deletBatchSize ; i++)
+			if(erased[i] < 0)
+				erased[i] = mapDeletePair(map, deletBatchEl[i][0], deletBatchEl[i][1]);
+		epochExit();
+	}
 
-		key = searchEl[i][0];
-		value = searchEl[i][1];
+	batchFree(&batch);
 
+}
 
-		int counter = 0;
 
-		while(!searchDone[i]){
+/* Key runs: the map's values grouped by key. All values of a key sit in
+   one run of values[], and the key's slot in a small open addressed table
+   of its own gives the run, so a key search is one probe returning a span,
+   with no counting pass and no mark per map slot.
+
+   keyRunsBuild groups a map's pairs once; mapKeepKeyRuns attaches the
+   result to the map, which from then on keeps it current: a pair that
+   mapInsert or batchInsert adds is appended to its key's run, a deleted
+   one is swapped out of it, each under a lock byte of the run, so threads
+   only wait for each other on the same key. A run that fills up moves to
+   twice its room at the end of values[]. Every insert batch first calls
+   keyRunsReserve, which makes room for the batch's new keys and moved
+   runs (compacting values[] when needed), so nothing is reallocated while
+   threads append. Key searches, like every other kind, do not overlap a
+   batch of inserts or deletes. */
+
+#define RUN_EMPTY 0
+#define RUN_BUSY 1
+#define RUN_READY 2
+#define RUN_REGION_SHIFT 10
+#define RUN_MIN_ROOM 4
+
+struct keyRun{
+	int key;
+	int start;	//first value in keyRuns.values
+	int count;
+	int room;	//values the run has space for from start
+};
 
-			hashedVal = doubleDashingFunction(key, counter);
-			if(!mapTable[hashedVal].fill)
-				break;
-			else{
-				if(mapTable[hashedVal].key == key && mapTable[hashedVal].value == value){
-					searchDone[i]=1;
-				}else{
+struct keyRuns{
+	struct keyRun *runs;
+	uint8_t *state;
+	uint8_t *lock;
+	unsigned mask;		//slots - 1
+	int *values;
+	int poolSize;		//values[] length
+	int poolUsed;		//values[0 .. poolUsed) is given to runs
+	int pairs;
+	int keys;		//slots taken, runs emptied by deletes included
+};
 
-					counter++;
-					//After one round of traversal of whole Map Table, break out loop
-					if(counter>30)
-						break;
+//the slot of key's run, claimed for it if add is set; -1 if key has none
+static int runSlot(struct keyRuns *runs, int key, int add){
+
+	unsigned at = hashKey(key) & runs->mask;
+	while(1){
+		uint8_t s = __atomic_load_n(&runs->state[at], __ATOMIC_ACQUIRE);
+		if(s == RUN_EMPTY){
+			if(!add)
+				return -1;
+			uint8_t expected = RUN_EMPTY;
+			if(!__atomic_compare_exchange_n(&runs->state[at], &expected, RUN_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				continue;
+			runs->runs[at].key = key;
+			__atomic_store_n(&runs->state[at], RUN_READY, __ATOMIC_RELEASE);
+			if(__atomic_add_fetch(&runs->keys, 1, __ATOMIC_RELAXED) > (int)(runs->mask / 8 * 7)){
+				fprintf(stderr, "keyRuns: more new keys than keyRunsReserve made room for\n");
+				abort();
+			}
+			return at;
+		}
+		//another thread is writing the key of this slot
+		if(s == RUN_BUSY)
+			continue;
+		if(runs->runs[at].key == key)
+			return at;
+		at = (at + 1) & runs->mask;
+	}
+
+}
+
+static struct keyRuns *runTableCreate(unsigned slots){
+
+	struct keyRuns *runs = (struct keyRuns*)calloc(1, sizeof(struct keyRuns));
+	runs->runs = (struct keyRun*)calloc(slots, sizeof(struct keyRun));
+	runs->state = (uint8_t*)calloc(slots, sizeof(uint8_t));
+	runs->lock = (uint8_t*)calloc(slots, sizeof(uint8_t));
+	runs->mask = slots - 1;
+	return runs;
+
+}
+
+//groups the live pairs by key. A counting sort first splits them by the
+//region of the run table their key starts probing in, and each region is
+//then done by one thread: claim the keys' runs and count their values,
+//give each run its place in the region's part of values[], fill it
+struct keyRuns *keyRunsBuild(struct lfMap *map){
+
+	mapSettle(map);
+	int live = mapCount(map);
+	struct mapTable *table = map->current;
+	unsigned slots = 16;
+	while(slots < 2*(unsigned)live)
+		slots <<= 1;
+
+	struct keyRuns *runs = runTableCreate(slots);
+	runs->values = (int*)malloc((live ? live : 1)*sizeof(int));
+	runs->poolSize = runs->poolUsed = runs->pairs = live;
+
+	int regions = slots >> RUN_REGION_SHIFT ? slots >> RUN_REGION_SHIFT : 1;
+	int threads = omp_get_max_threads();
+	int *counts = (int*)calloc((size_t)regions*threads, sizeof(int));
+	int *start = (int*)malloc((regions + 1)*sizeof(int));
+	struct batchEntry *entries = (struct batchEntry*)malloc((live ? live : 1)*sizeof(struct batchEntry));	//index: the slot of the run
+
+	#pragma omp parallel num_threads(threads)
+	{
+		int t = omp_get_thread_num(), team = omp_get_num_threads();
+		unsigned lo = (unsigned)((uint64_t)tableSlots(table)*t/team), hi = (unsigned)((uint64_t)tableSlots(table)*(t+1)/team);
+		int *count = counts + (size_t)regions*t;
+		for(unsigned at=lo ; at<hi ; at++)
+			if(*ctrlAt(table, at) < 0x80)
+				count[(hashKey(*keyAt(table, at)) & runs->mask) >> RUN_REGION_SHIFT]++;
+		#pragma omp barrier
+		#pragma omp single
+		{
+			int at = 0;
+			for(int r=0 ; r<regions ; r++){
+				start[r] = at;
+				for(int u=0 ; u<team ; u++){
+					int c = counts[(size_t)regions*u + r];
+					counts[(size_t)regions*u + r] = at;
+					at += c;
 				}
+			}
+			start[regions] = at;
+		}
+		for(unsigned at=lo ; at<hi ; at++)
+			if(*ctrlAt(table, at) < 0x80){
+				unsigned h = hashKey(*keyAt(table, at));
+				struct batchEntry *e = &entries[count[(h & runs->mask) >> RUN_REGION_SHIFT]++];
+				e->key = *keyAt(table, at);
+				e->value = *valueAt(table, at);
+				e->hash = h;
+			}
+	}
 
+	//a key's run is only touched by the thread of its region; the slot is
+	//claimed with a compare-and-swap since a probe may run into the next region
+	#pragma omp parallel for schedule(dynamic)
+	for(int region=0 ; region<regions ; region++){
+		for(int j=start[region] ; j<start[region+1] ; j++){
+			entries[j].index = runSlot(runs, entries[j].key, 1);
+			runs->runs[entries[j].index].count++;
+		}
+		//a run's count is negative once it has its place; start counts down while it fills
+		int cursor = start[region];
+		for(int j=start[region] ; j<start[region+1] ; j++){
+			struct keyRun *run = &runs->runs[entries[j].index];
+			if(run->count > 0){
+				run->start = cursor + run->count;
+				cursor += run->count;
+				run->count = -run->count;
 			}
+			runs->values[--run->start] = entries[j].value;
+		}
+		for(int j=start[region] ; j<start[region+1] ; j++){
+			struct keyRun *run = &runs->runs[entries[j].index];
+			if(run->count < 0)
+				run->room = run->count = -run->count;
 		}
-		
 	}
-	//End of Directive to run all iteration in parallel 	
+
+	free(counts);
+	free(start);
+	free(entries);
+	return runs;
 
 }
 
-void searchKeyFun(int searchSize, int *ansCounter, int *searchEl, int *searchDone, struct table *mapTable, int *checkSearch){
+//from now on the map keeps its key runs current
+void mapKeepKeyRuns(struct lfMap *map){
+	if(map->runs == NULL)
+		map->runs = keyRunsBuild(map);
+}
 
-	//Start of Directive to run all iteration in parallel 
-	#pragma omp parallel for
+/* Between batches, room for a batch of n inserts. The run table is
+   rehashed, dropping emptied runs, if n more keys could take it past half
+   full. values[] needs room for the runs that move: one move per existing
+   run of at most twice its count, then at most RUN_MIN_ROOM + 4 values per
+   append, since a run moves again only after it has filled the second half
+   of its room. Otherwise it is compacted, each run keeping room for its
+   count, into an array twice what is needed. */
+static void keyRunsReserve(struct keyRuns *runs, int n){
+
+	if((runs->keys + (long)n) * 2 > (long)runs->mask + 1){
+		unsigned slots = 16;
+		while(slots < 2*(unsigned)(runs->pairs + n))
+			slots <<= 1;
+		struct keyRuns *next = runTableCreate(slots);
+		for(unsigned at=0 ; at<=runs->mask ; at++)
+			if(runs->state[at] == RUN_READY && runs->runs[at].count > 0)
+				next->runs[runSlot(next, runs->runs[at].key, 1)] = runs->runs[at];
+		free(runs->runs);
+		free(runs->state);
+		free(runs->lock);
+		runs->runs = next->runs;
+		runs->state = next->state;
+		runs->lock = next->lock;
+		runs->mask = next->mask;
+		runs->keys = next->keys;
+		free(next);
+	}
+
+	long need = 2L*runs->pairs + (long)(RUN_MIN_ROOM + 4)*n;
+	if(runs->poolSize - runs->poolUsed >= need)
+		return;
+
+	//each run's new start: a serial pass over the table, then a parallel copy
+	int *values = (int*)malloc(2*need*sizeof(int));
+	int *moveTo = (int*)malloc((runs->mask + 1)*sizeof(int));
+	int used = 0;
+	for(unsigned at=0 ; at<=runs->mask ; at++){
+		moveTo[at] = used;
+		if(runs->state[at] == RUN_READY)
+			used += runs->runs[at].count;
+	}
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for(unsigned at=0 ; at<=runs->mask ; at++){
+		struct keyRun *run = &runs->runs[at];
+		if(runs->state[at] != RUN_READY)
+			continue;
+		memcpy(values + moveTo[at], runs->values + run->start, run->count*sizeof(int));
+		run->start = moveTo[at];
+		run->room = run->count;
+	}
+	free(runs->values);
+	free(moveTo);
+	runs->values = values;
+	runs->poolSize = (int)(2*need);
+	runs->poolUsed = used;
+
+}
+
+static inline void runLock(struct keyRuns *runs, int at){
+	while(__atomic_exchange_n(&runs->lock[at], 1, __ATOMIC_ACQUIRE))
+		;
+}
+
+static inline void runUnlock(struct keyRuns *runs, int at){
+	__atomic_store_n(&runs->lock[at], 0, __ATOMIC_RELEASE);
+}
+
+//a pair the map just took in
+static void keyRunsAdd(struct keyRuns *runs, int key, int value){
+
+	int at = runSlot(runs, key, 1);
+	struct keyRun *run = &runs->runs[at];
+	runLock(runs, at);
+	if(run->count == run->room){
+		int room = run->room < RUN_MIN_ROOM ? RUN_MIN_ROOM : 2*run->room;
+		int start = __atomic_fetch_add(&runs->poolUsed, room, __ATOMIC_RELAXED);
+		if(start + room > runs->poolSize){
+			fprintf(stderr, "keyRuns: more values than keyRunsReserve made room for\n");
+			abort();
+		}
+		memcpy(runs->values + start, runs->values + run->start, run->count*sizeof(int));
+		run->start = start;
+		run->room = room;
+	}
+	runs->values[run->start + run->count++] = value;
+	runUnlock(runs, at);
+	__atomic_add_fetch(&runs->pairs, 1, __ATOMIC_RELAXED);
+
+}
+
+//a pair the map just deleted: the run's last value takes its place
+static void keyRunsRemove(struct keyRuns *runs, int key, int value){
+
+	int at = runSlot(runs, key, 0);
+	if(at < 0)
+		return;
+	struct keyRun *run = &runs->runs[at];
+	runLock(runs, at);
+	for(int j=0 ; j<run->count ; j++)
+		if(runs->values[run->start + j] == value){
+			runs->values[run->start + j] = runs->values[run->start + --run->count];
+			__atomic_sub_fetch(&runs->pairs, 1, __ATOMIC_RELAXED);
+			break;
+		}
+	runUnlock(runs, at);
+
+}
+
+//every pair of key was deleted
+static void keyRunsDrop(struct keyRuns *runs, int key){
+
+	int at = runSlot(runs, key, 0);
+	if(at < 0)
+		return;
+	runLock(runs, at);
+	__atomic_sub_fetch(&runs->pairs, runs->runs[at].count, __ATOMIC_RELAXED);
+	runs->runs[at].count = 0;
+	runUnlock(runs, at);
+
+}
+
+//the values of key, *count of them from the returned pointer
+const int *keyRunsFind(struct keyRuns *runs, int key, int *count){
+
+	int at = runSlot(runs, key, 0);
+	if(at < 0){
+		*count = 0;
+		return runs->values;
+	}
+	*count = runs->runs[at].count;
+	return runs->values + runs->runs[at].start;
+
+}
+
+void keyRunsFree(struct keyRuns *runs){
+	free(runs->runs);
+	free(runs->state);
+	free(runs->lock);
+	free(runs->values);
+	free(runs);
+}
+
+//one probe per key: the pairs of searchEl[i] have the values runs->values[ansStart[i] .. ansStart[i]+ansCount[i]);
+//returns the pairs found, and in *distinct the pairs found counting each searched key once
+int searchKeyFun(int searchSize, int *searchEl, int *ansStart, int *ansCount, int *distinct, struct keyRuns *runs){
+
+	uint8_t *claimed = (uint8_t*)calloc(runs->mask + 1, sizeof(uint8_t));
+	int found = 0, once = 0;
+
+	#pragma omp parallel for reduction(+ : found, once)
 	for(int i=0 ; i<searchSize ; i++){
+		int at = runSlot(runs, searchEl[i], 0);
+		ansStart[i] = at < 0 ? 0 : runs->runs[at].start;
+		ansCount[i] = at < 0 ? 0 : runs->runs[at].count;
+		found += ansCount[i];
+		if(at >= 0 && __atomic_exchange_n(&claimed[at], 1, __ATOMIC_RELAXED) == 0)
+			once += ansCount[i];
+	}
 
-		int key = searchEl[i];
-		int hashedVal, counter=0;
+	free(claimed);
+	*distinct = once;
+	return found;
 
+}
 
-		while(1){
+//keys whose maintained run differs from the map's pairs (both as sets)
+static int keyRunsCheck(struct lfMap *map){
+
+	struct keyRuns *fresh = keyRunsBuild(map);
+	struct keyRuns *runs = map->runs;
+	int wrong = 0;
+
+	#pragma omp parallel for reduction(+ : wrong)
+	for(unsigned at=0 ; at<=fresh->mask ; at++){
+		if(fresh->state[at] != RUN_READY)
+			continue;
+		int key = fresh->runs[at].key, count;
+		const int *values = keyRunsFind(runs, key, &count);
+		int differs = count != fresh->runs[at].count;
+		for(int j=0 ; j<count && !differs ; j++){
+			int seen = 0;
+			for(int i=0 ; i<count ; i++)
+				seen |= fresh->values[fresh->runs[at].start + i] == values[j];
+			differs = !seen;
+		}
+		wrong += differs;
+	}
+	if(runs->pairs != fresh->pairs)
+		wrong++;
+
+	keyRunsFree(fresh);
+	return wrong;
+
+}
+
+
+/* The per-slot lock map, kept as the benchmark baseline */
+
+//Structure of the Map Table
+struct table{
+	int key;
+	int value;
+	int fill;
+	int delet;
+};
+
+
+//Defining Lock for each index of Map Table
+omp_lock_t lock[size];
+
+
+//Hash Function(Should not be linear)
+int doubleDashingFunction(int num, int i){
+
+	int f1 = (num);
+	// int f2 = (num%5);
+	return (f1+(i*i))%size;
+
+}
+
+//called from inside a parallel region
+void lockedInsertFun(int insertSize, int (*insertEl)[2], int *workDone, int *searchDone, struct table *mapTable){
+
+	#pragma omp for
+	for(int i=0 ; i<insertSize ; i++){
+
+		//taking key and value from input
+		int key, value, hashedVal;
+		key = insertEl[i][0];
+		value = insertEl[i][1];
+
+		//counter helps in probing
+		int counter = 0;
+
+		//Run the loop untill the insertion is not marked
+		while(!workDone[i] && !searchDone[i]){
 
 			hashedVal = doubleDashingFunction(key, counter);
 
-			if(mapTable[hashedVal].fill==0){
-				break;
-			}
-			else{
+			//Check the condition if the respective postion is occupied or not
+			if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){
 
-				if(mapTable[hashedVal].key == key){
+				//lock the respective index of Map Table where we have to insert
+				omp_set_lock(&lock[hashedVal]);
 
-					//printf("\nmatch key = %d\n", key);
-					checkSearch[hashedVal] = 1;
+				//Again checking so that other thread should not fill at same location
+				if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){
+
+					mapTable[hashedVal].key = key;
+					mapTable[hashedVal].value = value;
+
+					if(mapTable[hashedVal].fill==0)
+						mapTable[hashedVal].fill=1;
+					else
+						mapTable[hashedVal].delet=0;
+
+					workDone[i] = 1;
+
+					//Unset the lock
+					omp_unset_lock(&lock[hashedVal]);
 
-					//Directive to put atomic condition on ansCounter variable
-					#pragma omp atomic
-					(*ansCounter)++;
-					counter++;	
-					searchDone[i] = 1;
 				}
 				else{
+
+					//Unset the lock and probe on
+					omp_unset_lock(&lock[hashedVal]);
 					counter++;
 					//After one round of traversal of whole Map Table, break out loop
 					if(counter>30)
 						break;
+
 				}
-			}
-		}
-	}
-	//End of Directive to run all iteration in parallel 
 
+			}else{
+
+				counter++;
+				//After one round of traversal of whole Map Table, break out loop
+				if(counter>30){
+						break;
+				}
+
+			}
+		}
 
+	}
 
 }
 
-void searchKeyAnsInsert(int searchSize, int *insertIndex, int *searchEl, int *searchDone, int *checkSearch, struct table *mapTable, struct element *ans){
+void lockedSearchPairFun(int searchSize, int (*searchEl)[2], int *searchDone, struct table *mapTable){
 
-	//Start of Directive to run all iteration in parallel 
+	//Start of Directive to run all iteration in parallel
 	#pragma omp parallel for
-	for(int i=0 ; i<searchSize ; i++){
+	for (int i = 0; i < searchSize; ++i)
+	{
+		int key, value, hashedVal;
 
-		if(searchDone[i]){
+		key = searchEl[i][0];
+		value = searchEl[i][1];
 
-			int key = searchEl[i];
-			int counter = 0;
-			int hashedVal;
-			while(1){
 
-				hashedVal = doubleDashingFunction(key, counter);
-				if(hashedVal < 0){
-					counter++;
-					continue;
-				}
+		int counter = 0;
 
-				if(checkSearch[hashedVal]==1 || mapTable[hashedVal].fill == 0)
-					break;
+		while(!searchDone[i]){
 
-				if(mapTable[hashedVal].key == key){
-					
-					//lock the respective index of Map Table so that only 1 thread can fetch the value
-					omp_set_lock(&lock[hashedVal]);
-					if(checkSearch[hashedVal] == 0 ){
-						//printf("\nkey = %d and value = %d\n",mapTable[hashedVal].key, mapTable[hashedVal].value);
-						ans[(*insertIndex)].key = mapTable[hashedVal].key;
-						ans[(*insertIndex)].value = mapTable[hashedVal].value;
-						(*insertIndex)++;
-						checkSearch[hashedVal] = 1;
-					}
-					omp_unset_lock(&lock[hashedVal]);
-					counter++;							
+			hashedVal = doubleDashingFunction(key, counter);
+			if(!mapTable[hashedVal].fill)
+				break;
+			else{
+				if(mapTable[hashedVal].key == key && mapTable[hashedVal].value == value){
+					searchDone[i]=1;
+				}else{
 
-				}
-				else
-				{
 					counter++;
+					//After one round of traversal of whole Map Table, break out loop
+					if(counter>30)
+						break;
 				}
 
 			}
-
 		}
-	}
-	
-	//End of Directive to run all iteration in parallel 
 
+	}
+	//End of Directive to run all iteration in parallel
 
 }
 
-
-void deletePairFun(int deletBatchSize, int (*deletBatchEl)[2], int *checkDel, struct table *mapTable){
-	//Start of Directive to run all iteration in parallel 
-	#pragma omp parallel for 
+void lockedDeletePairFun(int deletBatchSize, int (*deletBatchEl)[2], struct table *mapTable){
+	//Start of Directive to run all iteration in parallel
+	#pragma omp parallel for
 	for(int i=0 ; i<deletBatchSize ; i++){
 
 		int key = deletBatchEl[i][0];
@@ -259,14 +1640,19 @@ void deletePairFun(int deletBatchSize, int (*deletBatchEl)[2], int *checkDel, st
 		while(1){
 
 			hashedVal = doubleDashingFunction(key, counter);
-			
+
 			if(mapTable[hashedVal].fill == 0)
 				break;
 
 			if(mapTable[hashedVal].key == key && mapTable[hashedVal].value == value){
-				mapTable[hashedVal].key = 0;
-				mapTable[hashedVal].value = 0;
-				mapTable[hashedVal].delet = 1;
+				//lock so that a concurrent delete of the same pair cannot interleave
+				omp_set_lock(&lock[hashedVal]);
+				if(mapTable[hashedVal].key == key && mapTable[hashedVal].value == value && mapTable[hashedVal].delet == 0){
+					mapTable[hashedVal].key = 0;
+					mapTable[hashedVal].value = 0;
+					mapTable[hashedVal].delet = 1;
+				}
+				omp_unset_lock(&lock[hashedVal]);
 				break;
 			}
 
@@ -278,280 +1664,817 @@ void deletePairFun(int deletBatchSize, int (*deletBatchEl)[2], int *checkDel, st
 		}
 
 	}
-	//End of Directive to run all iteration in parallel 
+	//End of Directive to run all iteration in parallel
+
+}
 
+int lockedCount(struct table *mapTable){
 
+	int total = 0;
+	for(int i=0 ; i<size ; i++)
+		if(mapTable[i].fill==1 && mapTable[i].delet==0)
+			total++;
+	return total;
 
 }
 
 
-void deletKeyFun(int deletBatchSize, int *deletBatchEl, int *checkDel, struct table *mapTable){
+/* Thread scaling: n pairs (spread keys, a few values per key) inserted,
+   searched and deleted by each map */
 
-	//Start of Directive to run all iteration in parallel 
-	#pragma omp parallel for 
-	for(int i=0 ; i<deletBatchSize ; i++){
+void benchmark(){
 
-		int key = deletBatchEl[i];				
-		int counter = 0;
-		int hashedVal;
+	int n = size / 2;
+	int (*pairs)[2] = malloc(n*sizeof(*pairs));
+	int *workDone = (int*)malloc(n*sizeof(int));
+	int *searchDone = (int*)malloc(n*sizeof(int));
+	int *checkDel = (int*)malloc(n*sizeof(int));
+	for(int i=0 ; i<n ; i++){
+		pairs[i][0] = (int)(((unsigned)i / 4) * 2654435761u % 1000000007u);
+		pairs[i][1] = i;
+	}
 
-		while(1){
+	struct table *mapTable = (struct table*)malloc(size*sizeof(struct table));
+	for(int i = 0; i < size; ++i)
+		omp_init_lock(&lock[i]);
 
-			hashedVal = doubleDashingFunction(key, counter);
+	printf("threads,map,insert_s,search_s,delete_s,stored,found\n");
+	int maxThreads = omp_get_max_threads();
+	for(int threads=1 ; ; threads*=2){
 
-			if(mapTable[hashedVal].fill == 0)
-				break;
+		if(threads > maxThreads)
+			threads = maxThreads;
+		omp_set_num_threads(threads);
+		double t0, t1, t2, t3;
+		int found;
 
-			if(mapTable[hashedVal].key == key && mapTable[hashedVal].delet != 1){
-				mapTable[hashedVal].key = 0;
-				mapTable[hashedVal].value = 0;
-				mapTable[hashedVal].delet = 1;						
-			}
+		//locked map
+		for(int i=0 ; i<size ; i++){
+			mapTable[i].key = -3;
+			mapTable[i].value = -3;
+			mapTable[i].fill = 0;
+			mapTable[i].delet = 0;
+		}
+		memset(workDone, 0, n*sizeof(int));
+		memset(searchDone, 0, n*sizeof(int));
+		t0 = omp_get_wtime();
+		lockedSearchPairFun(n, pairs, searchDone, mapTable);
+		#pragma omp parallel
+		lockedInsertFun(n, pairs, workDone, searchDone, mapTable);
+		t1 = omp_get_wtime();
+		int stored = lockedCount(mapTable);
+		memset(searchDone, 0, n*sizeof(int));
+		lockedSearchPairFun(n, pairs, searchDone, mapTable);
+		t2 = omp_get_wtime();
+		found = 0;
+		for(int i=0 ; i<n ; i++)
+			found += searchDone[i];
+		lockedDeletePairFun(n, pairs, mapTable);
+		t3 = omp_get_wtime();
+		printf("%d,locked,%g,%g,%g,%d,%d\n", threads, t1-t0, t2-t1, t3-t2, stored, found);
+
+		//lock-free map, sized for the batch and grown from MAP_CHUNK slots
+		for(int grown=0 ; grown<2 ; grown++){
+			struct lfMap *map = mapCreate(grown ? MAP_CHUNK : size);
+			memset(workDone, 0, n*sizeof(int));
+			memset(searchDone, 0, n*sizeof(int));
+			t0 = omp_get_wtime();
+			insertFun(n, pairs, workDone, searchDone, map);
+			t1 = omp_get_wtime();
+			stored = mapCount(map);
+			searchPairFun(n, pairs, searchDone, map);
+			t2 = omp_get_wtime();
+			found = 0;
+			for(int i=0 ; i<n ; i++)
+				found += searchDone[i];
+			deletePairFun(n, pairs, checkDel, map);
+			t3 = omp_get_wtime();
+			printf("%d,%s,%g,%g,%g,%d,%d\n", threads, grown ? "lock-free-grown" : "lock-free", t1-t0, t2-t1, t3-t2, stored, found);
+			mapDestroy(map);
+		}
 
-			counter++;
-			//After one round of traversal of whole Map Table, break out loop
-			if(counter>30)
-				break;
+		//lock-free map through the region-sorted batches, grown from MAP_CHUNK slots
+		{
+			struct lfMap *map = mapCreate(MAP_CHUNK);
+			t0 = omp_get_wtime();
+			batchInsert(n, pairs, workDone, map);
+			t1 = omp_get_wtime();
+			stored = mapCount(map);
+			batchFind(n, pairs, searchDone, map);
+			t2 = omp_get_wtime();
+			found = 0;
+			for(int i=0 ; i<n ; i++)
+				found += searchDone[i];
+			batchErase(n, pairs, checkDel, map);
+			t3 = omp_get_wtime();
+			printf("%d,lock-free-sorted,%g,%g,%g,%d,%d\n", threads, t1-t0, t2-t1, t3-t2, stored, found);
+			mapDestroy(map);
 		}
-	}
-	//End of Directive to run all iteration in parallel 
 
+		if(threads == maxThreads)
+			break;
 
-}
+	}
 
+	for(int i = 0; i < size; ++i)
+		omp_destroy_lock(&lock[i]);
+	free(mapTable);
+	free(pairs);
+	free(workDone);
+	free(searchDone);
+	free(checkDel);
 
+}
 
 
-int main(){
+//inserts and deletes through many growths from the smallest table, checking every pair after each round
+int stressTest(){
 
-	//Time variable
-	double t1,t2;
-	int num = omp_get_num_threads();
-        #pragma omp single
-        printf("No of Threads: = %d\n",num);
+	int n = 4*size;
+	int failures = 0;
+	int (*pairs)[2] = malloc(2*n*sizeof(*pairs));
+	int *workDone = (int*)malloc(2*n*sizeof(int));
+	int *searchDone = (int*)malloc(2*n*sizeof(int));
+	int *checkDel = (int*)malloc(2*n*sizeof(int));
 
+	//at least 8 threads, so a one-core machine still interleaves them
+	if(omp_get_max_threads() < 8)
+		omp_set_num_threads(8);
+	printf("stress: %d pairs, %d threads\n", n, omp_get_max_threads());
 
+	struct lfMap *map = mapCreate(1);
+	mapKeepKeyRuns(map);
 
-	//Initialization of locks using parallel threads
-	#pragma omp for
-	for(int i = 0; i < size; ++i){
-		omp_init_lock(&lock[i]);
+	//every pair twice in one batch: each must be inserted by exactly one of its copies
+	for(int i=0 ; i<2*n ; i++){
+		int p = (i % 2) ? n - 1 - i/2 : i/2;
+		pairs[i][0] = p / 3;
+		pairs[i][1] = p;
 	}
-	
-
-	//Handling the operation using condtional variable
-	int insert=1, insertA=1, search=0, del=0,searchPair=0, searchKey=0, deletKey=0, deletPair=0;
-
-
-	//Creating Map Table Dynamically
-	struct table *mapTable;
-	mapTable = (struct table*)malloc(size*sizeof(struct table));
-
-	for(int i=0 ; i<size ; i++){
-		mapTable[i].key = -3;
-		mapTable[i].value = -3;
-		mapTable[i].fill = 0;
-		mapTable[i].delet = 0;
+	memset(workDone, 0, 2*n*sizeof(int));
+	memset(searchDone, 0, 2*n*sizeof(int));
+	insertFun(2*n, pairs, workDone, searchDone, map);
+	int inserted = 0;
+	for(int i=0 ; i<2*n ; i++){
+		inserted += workDone[i];
+		if(workDone[i] + searchDone[i] != 1)
+			failures++;
+	}
+	if(inserted != n || mapCount(map) != n)
+		failures++;
+	printf("insert with duplicates: %d inserted, %d stored, %d slots\n", inserted, mapCount(map), mapCapacity(map));
+
+	//each key's values as one run: key k has the values 3k, 3k+1 and 3k+2 below n
+	struct keyRuns *runs = map->runs;
+	int keys = (n + 2) / 3, runFailures = 0;
+	#pragma omp parallel for reduction(+ : runFailures)
+	for(int k=0 ; k<=keys ; k++){
+		int count, seen = 0;
+		const int *values = keyRunsFind(runs, k, &count);
+		for(int j=0 ; j<count ; j++)
+			if(values[j] / 3 == k)
+				seen |= 1 << (values[j] % 3);
+		int expected = k < keys ? (n - 3*k < 3 ? n - 3*k : 3) : 0;
+		if(count != expected || seen != (1 << expected) - 1)
+			runFailures++;
+	}
+	if(runFailures || runs->keys != keys || runs->pairs != n)
+		failures++;
+	printf("key runs: %d keys, %d pairs, %d wrong\n", runs->keys, runs->pairs, runFailures);
+
+	//delete every third pair
+	int deletSize = 0;
+	for(int p=0 ; p<n ; p+=3){
+		pairs[deletSize][0] = p / 3;
+		pairs[deletSize][1] = p;
+		deletSize++;
+	}
+	deletePairFun(deletSize, pairs, checkDel, map);
+	for(int i=0 ; i<deletSize ; i++)
+		if(checkDel[i] != 1)
+			failures++;
+	if(mapCount(map) != n - deletSize)
+		failures++;
+	int runsWrong = keyRunsCheck(map);
+	if(runsWrong)
+		failures++;
+	printf("delete: %d deleted, %d stored, %d key runs wrong\n", deletSize, mapCount(map), runsWrong);
+
+	//put the deleted pairs back with as many new ones, growing over the tombstones
+	for(int i=0 ; i<deletSize ; i++){
+		pairs[deletSize + i][0] = (n + i) / 3;
+		pairs[deletSize + i][1] = n + i;
+	}
+	memset(workDone, 0, 2*deletSize*sizeof(int));
+	memset(searchDone, 0, 2*deletSize*sizeof(int));
+	insertFun(2*deletSize, pairs, workDone, searchDone, map);
+	for(int i=0 ; i<2*deletSize ; i++)
+		if(workDone[i] != 1)
+			failures++;
+	int total = n + deletSize;
+	if(mapCount(map) != total)
+		failures++;
+	runsWrong = keyRunsCheck(map);
+	if(runsWrong)
+		failures++;
+	printf("reinsert: %d stored, %d slots, %d key runs wrong\n", mapCount(map), mapCapacity(map), runsWrong);
+
+	//every pair must be found, and nothing that was never inserted
+	for(int p=0 ; p<total ; p++){
+		pairs[p][0] = p / 3;
+		pairs[p][1] = p;
+	}
+	searchPairFun(total, pairs, searchDone, map);
+	int found = 0;
+	for(int p=0 ; p<total ; p++)
+		found += searchDone[p];
+	for(int p=0 ; p<total ; p++)
+		pairs[p][1] = -1 - p;
+	searchPairFun(total, pairs, searchDone, map);
+	int phantom = 0;
+	for(int p=0 ; p<total ; p++)
+		phantom += searchDone[p];
+	if(found != total || phantom != 0)
+		failures++;
+	printf("search: %d of %d found, %d phantom\n", found, total, phantom);
+	mapDestroy(map);
+
+	//the same checks through the sorted batches, from the smallest table
+	map = mapCreate(1);
+	mapKeepKeyRuns(map);
+	for(int i=0 ; i<2*n ; i++){
+		int p = (i % 2) ? n - 1 - i/2 : i/2;
+		pairs[i][0] = p / 3;
+		pairs[i][1] = p;
 	}
+	batchInsert(2*n, pairs, workDone, map);
+	inserted = 0;
+	for(int i=0 ; i<2*n ; i++)
+		inserted += workDone[i];
+	if(inserted != n || mapCount(map) != n)
+		failures++;
+	batchErase(2*n, pairs, checkDel, map);
+	int erased = 0;
+	for(int i=0 ; i<2*n ; i++)
+		erased += checkDel[i];
+	if(erased != n || mapCount(map) != 0)
+		failures++;
+	batchInsert(n, pairs, workDone, map);
+	batchFind(2*n, pairs, searchDone, map);
+	found = 0;
+	for(int i=0 ; i<2*n ; i++)
+		found += searchDone[i];
+	if(found != 2*n)
+		failures++;
+	runsWrong = keyRunsCheck(map);
+	if(runsWrong)
+		failures++;
+	printf("sorted batches: %d inserted, %d erased, %d of %d found, %d key runs wrong\n", inserted, erased, found, 2*n, runsWrong);
+
+	//every key below n/6 deleted outright, its run emptied with it
+	int *keysGone = (int*)malloc((n/6 + 1)*sizeof(int));
+	for(int k=0 ; k<n/6 ; k++)
+		keysGone[k] = k;
+	deletKeyFun(n/6, keysGone, checkDel, map);
+	runsWrong = keyRunsCheck(map);
+	if(runsWrong || mapCount(map) != n - 3*(n/6))
+		failures++;
+	printf("delete by key: %d stored, %d key runs wrong\n", mapCount(map), runsWrong);
+	free(keysGone);
+	mapDestroy(map);
+
+	//searches against growth: half the threads insert, the other half search
+	//for the pairs each inserting thread has published so far, which must be
+	//found whichever table they are in, and for pairs never inserted. A guard
+	//per call lets the epoch move on, so tables are freed during the phase
+	map = mapCreate(1);
+	int threads = omp_get_max_threads(), writers = threads / 2;
+	int *published = (int*)calloc(writers, sizeof(int));
+	int writing = writers;
+	long lookups = 0, misses = 0, phantoms = 0;
+	#pragma omp parallel num_threads(threads) reduction(+ : lookups, misses, phantoms)
+	{
+		int t = omp_get_thread_num();
+		if(t < writers){
+			for(int j=0 ; j*writers + t < n ; j++){
+				int p = j*writers + t;
+				epochEnter();
+				mapInsert(map, p / 3, p);
+				epochExit();
+				__atomic_store_n(&published[t], j + 1, __ATOMIC_RELEASE);
+			}
+			__atomic_sub_fetch(&writing, 1, __ATOMIC_ACQ_REL);
+		}
+		else{
+			unsigned x = 7919u * t;
+			while(__atomic_load_n(&writing, __ATOMIC_ACQUIRE) > 0){
+				x = x * 1103515245 + 12345;
+				int w = (x >> 8) % writers;
+				int done = __atomic_load_n(&published[w], __ATOMIC_ACQUIRE);
+				if(done == 0)
+					continue;
+				x = x * 1103515245 + 12345;
+				int p = (int)((x >> 8) % done) * writers + w;
+				epochEnter();
+				misses += !mapSearchPair(map, p / 3, p);
+				phantoms += mapSearchPair(map, p / 3, -1 - p);
+				epochExit();
+				lookups++;
+			}
+		}
+	}
+	int slots = mapCapacity(map);
+	int pending = epochPending();
+	if(misses || phantoms || mapCount(map) != n || pending)
+		failures++;
+	printf("search during growth: %ld searches up to %d slots, %ld missed, %ld phantom, %d retired tables left\n", lookups, slots, misses, phantoms, pending);
+	free(published);
+
+	mapDestroy(map);
+	free(pairs);
+	free(workDone);
+	free(searchDone);
+	free(checkDel);
+
+	printf("stress: %s\n", failures ? "FAILED" : "ok");
+	return failures;
 
+}
 
-	//Insertion in Map Data Structure to test insertion before next insertion
-	if(insert){		
+//groups visited by a search for the pair, in a settled table
+static int probeLength(struct mapTable *table, int key, int value){
+
+	unsigned h = hashKey(key);
+	uint8_t fragment = hashFragment(h);
+	unsigned group = homeGroup(table, h);
+	for(unsigned probes=0 ; probes<=table->groupMask ; probes++, group=(group+1) & table->groupMask){
+		struct groupMasks m = scanGroup(groupCtrl(table, group), fragment);
+		for(unsigned bits=m.match ; bits ; bits&=bits-1){
+			unsigned at = group*MAP_GROUP + __builtin_ctz(bits);
+			if(*keyAt(table, at) == key && *valueAt(table, at) == value)
+				return probes + 1;
+		}
+		if(m.ends)
+			return probes + 1;
+	}
+	return table->groupMask + 1;
 
-		//Insertion Batch Size
-		int insertSize = 10000;
-		int insertEl[insertSize][2];
+}
 
+/* Long running churn: a window of pairs slides through the key space,
+   every round deleting its oldest batch and inserting a new one, so the
+   live count stays put while tombstones are left behind. Each reported
+   round gives the table size, the tombstones and the groups probed by
+   searches for every live pair and for as many missing ones. */
+
+void churnBenchmark(){
+
+	int window = 4*size, batch = size/2, rounds = 400;
+	int (*pairs)[2] = malloc(batch*sizeof(*pairs));
+	int *workDone = (int*)malloc(batch*sizeof(int));
+	int *searchDone = (int*)malloc(batch*sizeof(int));
+	int *checkDel = (int*)malloc(batch*sizeof(int));
+	struct lfMap *map = mapCreate(MAP_CHUNK);
+
+	printf("round,slots,live,tombs,mean_probe,max_probe,mean_miss_probe,insert_s,delete_s\n");
+	for(int round=0 ; round<rounds ; round++){
+
+		//pair p has key p/4 and value p; the window is [first, first + window)
+		int first = (round + 1)*batch - window;
+		double t0 = omp_get_wtime();
+		for(int i=0 ; i<batch ; i++){
+			int p = round*batch + i;
+			pairs[i][0] = p / 4;
+			pairs[i][1] = p;
+		}
+		memset(workDone, 0, batch*sizeof(int));
+		memset(searchDone, 0, batch*sizeof(int));
+		insertFun(batch, pairs, workDone, searchDone, map);
+		double t1 = omp_get_wtime();
+		if(first > 0){
+			for(int i=0 ; i<batch ; i++){
+				int p = first - batch + i;
+				pairs[i][0] = p / 4;
+				pairs[i][1] = p;
+			}
+			deletePairFun(batch, pairs, checkDel, map);
+		}
+		double t2 = omp_get_wtime();
+
+		if(round % 20 != 19)
+			continue;
+		mapSettle(map);
+		struct mapTable *table = map->current;
+		int live = mapCount(map), tombs = 0;
+		#pragma omp parallel for reduction(+ : tombs)
+		for(unsigned group=0 ; group<=table->groupMask ; group++)
+			tombs += __builtin_popcount(scanGroup(groupCtrl(table, group), 0).tomb);
+		long total = 0, missed = 0;
+		int longest = 0;
+		int lo = first > 0 ? first : 0, hi = (round + 1)*batch;
+		#pragma omp parallel for reduction(+ : total, missed) reduction(max : longest)
+		for(int p=lo ; p<hi ; p++){
+			int probes = probeLength(table, p / 4, p);
+			total += probes;
+			if(probes > longest)
+				longest = probes;
+			missed += probeLength(table, p / 4, -1 - p);
+		}
+		printf("%d,%d,%d,%d,%.3f,%d,%.3f,%g,%g\n", round + 1, tableSlots(table), live, tombs, (double)total / (hi - lo), longest,
+				(double)missed / (hi - lo), t1-t0, t2-t1);
 
-		t1 = omp_get_wtime();
+	}
 
-		//for Marking the index of Insertion Batch Element
-		int *workDone;
-		workDone = (int*)malloc(insertSize*sizeof(int));
+	mapDestroy(map);
+	free(pairs);
+	free(workDone);
+	free(searchDone);
+	free(checkDel);
 
-		int *searchDone;
-		searchDone = (int*)malloc(insertSize*sizeof(int));
+}
 
+/* Benchmark suite: key distributions, operation mixes, load factors and
+   thread counts, one CSV row per combination.
+
+   Keys are ranks in a universe of twice the prefilled pairs. The lower
+   half is inserted first, so reads and deletes hit about half the time
+   under uniform keys and mostly hit under Zipfian ones:
+
+     uniform     ranks drawn uniformly, spread over the int range
+     zipf        Zipfian ranks (theta 0.99, YCSB style), hot ranks spread
+                 over the int range the same way
+     sequential  every thread walks consecutive ranks, keys are the ranks
+     collide     uniform ranks over keys whose hash puts them in one home
+                 group out of COLLIDE_SPAN, so probe sequences pile up
+
+   Each thread runs its share of the operations, picking read, insert or
+   delete by the mix; the kinds run concurrently, which the map allows
+   (a pair inserted twice at once while a delete frees a slot before it
+   may end up in the table twice, which does not matter here). After the
+   run the probe lengths of a sample of lookups from the same distribution
+   are recorded; bytes per entry is the table over the live pairs. */
+
+#define COLLIDE_SPAN 64
+#define PROBE_BINS 64
+#define PROBE_SAMPLE (1 << 16)
+
+enum keyDist{ DIST_UNIFORM, DIST_ZIPF, DIST_SEQUENTIAL, DIST_COLLIDE, DISTS };
+static const char *distNames[DISTS] = { "uniform", "zipf", "sequential", "collide" };
+
+struct keyGen{
+	int dist;
+	unsigned universe;
+	const int *collideKeys;
+	double zetan, eta;	//zipf constants for the universe
+	uint64_t state;		//splitmix64
+	unsigned next;		//sequential rank
+};
 
-		/*Start of Dummy Input*/
-		insertEl[0][0] = 59;
-		insertEl[0][1] = 6;
-		workDone[0] = 0;
-		searchDone[0] = 0;
+static inline uint64_t nextRandom(struct keyGen *g){
+	uint64_t z = (g->state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
 
-		insertEl[1][0] = 59;
-		insertEl[1][1] = 8;
-		workDone[1] = 0;
-		searchDone[1] = 0;
+static inline double nextUnit(struct keyGen *g){
+	return (nextRandom(g) >> 11) * (1.0 / 9007199254740992.0);
+}
 
-		insertEl[2][0] = 59;
-		insertEl[2][1] = 9;
-		workDone[2] = 0;
-		searchDone[2] = 0;
+#define ZIPF_THETA 0.99
 
-		for(int i=0 ; i<insertSize ; i++){
-			insertEl[i][0] = i;
-			insertEl[i][1] = i+7	;
-			workDone[i] = 0;	//This is important
-			searchDone[i] = 0;
-		}
-		/*End of Dummy Input*/
+static double zeta(unsigned n){
+	double sum = 0;
+	#pragma omp parallel for reduction(+ : sum)
+	for(unsigned i=1 ; i<=n ; i++)
+		sum += 1 / pow(i, ZIPF_THETA);
+	return sum;
+}
 
+static void keyGenInit(struct keyGen *g, int dist, unsigned universe, const int *collideKeys, double zetan, int thread, int threads){
+	g->dist = dist;
+	g->universe = universe;
+	g->collideKeys = collideKeys;
+	g->zetan = zetan;
+	g->eta = (1 - pow(2.0 / universe, 1 - ZIPF_THETA)) / (1 - (1 + pow(0.5, ZIPF_THETA)) / zetan);
+	g->state = 0x5eed0000u + thread;
+	g->next = (unsigned)((uint64_t)universe * thread / threads);
+}
 
-		// First need to search that all {key, value} pair present or not
-		
-		
+static inline unsigned nextRank(struct keyGen *g){
+	if(g->dist == DIST_SEQUENTIAL){
+		unsigned rank = g->next;
+		g->next = g->next + 1 == g->universe ? 0 : g->next + 1;
+		return rank;
+	}
+	if(g->dist == DIST_ZIPF){
+		double u = nextUnit(g), uz = u * g->zetan;
+		if(uz < 1)
+			return 0;
+		if(uz < 1 + pow(0.5, ZIPF_THETA))
+			return 1;
+		unsigned rank = (unsigned)(g->universe * pow(g->eta*u - g->eta + 1, 1 / (1 - ZIPF_THETA)));
+		return rank < g->universe ? rank : g->universe - 1;
+	}
+	return (unsigned)(nextRandom(g) % g->universe);
+}
 
-		//Start of Directive to run all iteration in parallel 
-			#pragma omp parallel for
-			for (int i = 0; i < insertSize; ++i)
-			{
-				int key, value, hashedVal;
+//the key of a rank: spread over the ints by an odd multiplier, which is a bijection
+static inline int rankKey(struct keyGen *g, unsigned rank){
+	if(g->dist == DIST_SEQUENTIAL)
+		return (int)rank;
+	if(g->dist == DIST_COLLIDE)
+		return g->collideKeys[rank];
+	return (int)(rank * 2654435761u);
+}
 
-				key = insertEl[i][0];
-				value = insertEl[i][1];
+//n keys whose home group is a multiple of COLLIDE_SPAN in any table of COLLIDE_SPAN groups or more
+static int *collidingKeys(unsigned n){
+	int *keys = (int*)malloc(n*sizeof(int));
+	unsigned found = 0;
+	for(unsigned candidate=0 ; found<n ; candidate++)
+		if(((hashKey((int)candidate) >> 7) & (COLLIDE_SPAN - 1)) == 0)
+			keys[found++] = (int)candidate;
+	return keys;
+}
 
+struct opMix{
+	int read, insert;	//percent; the rest deletes
+	char name[40];
+};
 
-				int counter = 0;
+static int parseMixes(const char *text, struct opMix *mixes, int most){
+	int count = 0;
+	while(*text && count < most){
+		int r, i, d, used;
+		if(sscanf(text, "%d/%d/%d%n", &r, &i, &d, &used) != 3 || r < 0 || i < 0 || d < 0 || r + i + d != 100)
+			return -1;
+		mixes[count].read = r;
+		mixes[count].insert = i;
+		snprintf(mixes[count].name, sizeof(mixes[count].name), "%d/%d/%d", r, i, d);
+		count++;
+		text += used;
+		if(*text == ',')
+			text++;
+	}
+	return count;
+}
 
-				while(!searchDone[i]){
+static int parseList(const char *text, double *values, int most){
+	int count = 0;
+	char *end;
+	while(*text && count < most){
+		values[count++] = strtod(text, &end);
+		if(end == text)
+			return -1;
+		text = *end == ',' ? end + 1 : end;
+	}
+	return count;
+}
 
-					hashedVal = doubleDashingFunction(key, counter);
-					if(!mapTable[hashedVal].fill)
-						break;
-					else{
-						if(mapTable[hashedVal].key == key && mapTable[hashedVal].value == value){
-							searchDone[i]=1;
-						}else{
-
-							counter++;
-							//After one round of traversal of whole Map Table, break out loop
-							if(counter>30)
-								break;
+static void runSuite(int capacity, long ops, int distMask, struct opMix *mixes, int mixCount, double *loads, int loadCount, int *threadCounts, int threadCount){
+
+	//the slots mapCreate rounds the capacity up to, which the loads are of
+	struct lfMap *sizing = mapCreate(capacity);
+	int slots = mapCapacity(sizing);
+	mapDestroy(sizing);
+
+	unsigned maxUniverse = 0;
+	for(int l=0 ; l<loadCount ; l++)
+		if(2 * (unsigned)(loads[l] * slots) > maxUniverse)
+			maxUniverse = 2 * (unsigned)(loads[l] * slots);
+	int *collideKeys = (distMask >> DIST_COLLIDE) & 1 ? collidingKeys(maxUniverse) : NULL;
+	int (*pairs)[2] = malloc(maxUniverse / 2 * sizeof(*pairs));
+	int *workDone = (int*)malloc(maxUniverse / 2 * sizeof(int));
+	int *searchDone = (int*)malloc(maxUniverse / 2 * sizeof(int));
+
+	printf("dist,mix,load,threads,ops,seconds,mops,probe_mean,probe_p50,probe_p90,probe_p99,probe_max,final_load,bytes_per_entry\n");
+	for(int dist=0 ; dist<DISTS ; dist++){
+		if(!((distMask >> dist) & 1))
+			continue;
+		for(int l=0 ; l<loadCount ; l++){
+
+			unsigned prefill = (unsigned)(loads[l] * slots), universe = 2 * prefill;
+			double zetan = dist == DIST_ZIPF ? zeta(universe) : 0;
+
+			for(int m=0 ; m<mixCount ; m++){
+				for(int t=0 ; t<threadCount ; t++){
+
+					int threads = threadCounts[t];
+					omp_set_num_threads(threads);
+
+					//prefill the lower half of the universe
+					struct lfMap *map = mapCreate(capacity);
+					struct keyGen fill;
+					keyGenInit(&fill, dist, universe, collideKeys, zetan, 0, 1);
+					for(unsigned r=0 ; r<prefill ; r++){
+						pairs[r][0] = rankKey(&fill, r);
+						pairs[r][1] = (int)r;
+						workDone[r] = searchDone[r] = 0;
+					}
+					insertFun(prefill, pairs, workDone, searchDone, map);
+
+					double start = omp_get_wtime();
+					#pragma omp parallel
+					{
+						int id = omp_get_thread_num(), team = omp_get_num_threads();
+						struct keyGen g;
+						keyGenInit(&g, dist, universe, collideKeys, zetan, id, team);
+						long lo = ops * id / team, hi = ops * (id + 1) / team;
+						epochEnter();
+						for(long i=lo ; i<hi ; i++){
+							unsigned rank = nextRank(&g);
+							int key = rankKey(&g, rank), pick = (int)(nextRandom(&g) % 100);
+							if(pick < mixes[m].read)
+								mapSearchPair(map, key, (int)rank);
+							else if(pick < mixes[m].read + mixes[m].insert)
+								mapInsert(map, key, (int)rank);
+							else
+								mapDeletePair(map, key, (int)rank);
 						}
-
+						epochExit();
+					}
+					double seconds = omp_get_wtime() - start;
+
+					//probe lengths of lookups drawn like the run's, in the table the run left
+					mapSettle(map);
+					struct mapTable *table = map->current;
+					long histogram[PROBE_BINS + 1] = { 0 };
+					long total = 0;
+					int longest = 0;
+					struct keyGen sample;
+					keyGenInit(&sample, dist, universe, collideKeys, zetan, threads, threads + 1);
+					for(int s=0 ; s<PROBE_SAMPLE ; s++){
+						unsigned rank = nextRank(&sample);
+						int probes = probeLength(table, rankKey(&sample, rank), (int)rank);
+						histogram[probes < PROBE_BINS ? probes : PROBE_BINS]++;
+						total += probes;
+						if(probes > longest)
+							longest = probes;
+					}
+					int percentile[3] = { 0, 0, 0 };
+					const double cut[3] = { 0.5, 0.9, 0.99 };
+					for(int c=0 ; c<3 ; c++){
+						long seen = 0;
+						int bin = 0;
+						while(bin < PROBE_BINS && (seen += histogram[bin]) < cut[c] * PROBE_SAMPLE)
+							bin++;
+						percentile[c] = bin;
 					}
-				}
-				
-			}
-			//End of Directive to run all iteration in parallel 
 
-			
+					int live = mapCount(map);
+					double bytes = (double)tableSlots(table) * (1 + 2*sizeof(int)) + sizeof(struct mapTable) + sizeof(struct lfMap);
+					printf("%s,%s,%.2f,%d,%ld,%.4f,%.2f,%.3f,%d,%d,%d,%d,%.3f,%.1f\n", distNames[dist], mixes[m].name, loads[l], threads, ops,
+							seconds, ops / seconds / 1e6, (double)total / PROBE_SAMPLE, percentile[0], percentile[1], percentile[2], longest,
+							(double)live / tableSlots(table), live ? bytes / live : 0.0);
+					fflush(stdout);
+					mapDestroy(map);
 
+				}
+			}
+		}
+	}
 
-			//Count the successful search
-			// int success=0;
+	free(collideKeys);
+	free(pairs);
+	free(workDone);
+	free(searchDone);
 
-			// /*Start Output*/
-			// printf("\n\nSearched Element in the Hash Table:\n\n");
-			// for(int i=0 ; i<searchSize ; i++){
-			// 	if(searchDone[i]){
-			// 		// printf("key = %d  value = %d \n", searchEl[i][0], searchEl[i][1]);
-			// 		success++;
-			// 	}
-			// }			
+}
 
+//./map --suite [--slots N] [--ops N] [--dist uniform,zipf,...] [--mix 90/5/5,...] [--load 0.25,...] [--threads 1,2,...]
+int suiteMain(int argc, char *argv[]){
+
+	int slots = 1 << 21;
+	long ops = 4000000;
+	int distMask = (1 << DISTS) - 1;
+	struct opMix mixes[16];
+	int mixCount = parseMixes("100/0/0,90/5/5,50/25/25,10/45/45", mixes, 16);
+	double loads[16] = { 0.25, 0.5, 0.75 };
+	int loadCount = 3;
+	int threadCounts[16], threadCount = 0;
+	for(int t=1 ; threadCount<16 ; t*=2){
+		threadCounts[threadCount++] = t < omp_get_max_threads() ? t : omp_get_max_threads();
+		if(t >= omp_get_max_threads())
+			break;
+	}
 
-		
-		
+	for(int i=2 ; i<argc ; i++){
+		int ok = i + 1 < argc;
+		if(ok && strcmp(argv[i], "--slots") == 0)
+			ok = (slots = atoi(argv[++i])) > 0;
+		else if(ok && strcmp(argv[i], "--ops") == 0)
+			ok = (ops = atol(argv[++i])) > 0;
+		else if(ok && strcmp(argv[i], "--mix") == 0)
+			ok = (mixCount = parseMixes(argv[++i], mixes, 16)) > 0;
+		else if(ok && strcmp(argv[i], "--load") == 0){
+			ok = (loadCount = parseList(argv[++i], loads, 16)) > 0;
+			for(int l=0 ; ok && l<loadCount ; l++)
+				ok = loads[l] > 0 && loads[l] < 0.875;
+		}
+		else if(ok && strcmp(argv[i], "--threads") == 0){
+			double counts[16];
+			ok = (threadCount = parseList(argv[++i], counts, 16)) > 0;
+			for(int t=0 ; ok && t<threadCount ; t++)
+				ok = (threadCounts[t] = (int)counts[t]) > 0;
+		}
+		else if(ok && strcmp(argv[i], "--dist") == 0){
+			distMask = 0;
+			for(char *name=strtok(argv[++i], ",") ; name != NULL ; name=strtok(NULL, ",")){
+				int d = 0;
+				while(d < DISTS && strcmp(name, distNames[d]) != 0)
+					d++;
+				ok = ok && d < DISTS;
+				distMask |= 1 << (d < DISTS ? d : 0);
+			}
+		}
+		else
+			ok = 0;
+		if(!ok){
+			fprintf(stderr, "usage: %s --suite [--slots N] [--ops N] [--dist uniform,zipf,sequential,collide]\n"
+					"          [--mix read/insert/delete,...] [--load 0.25,0.5,...] [--threads 1,2,...]\n", argv[0]);
+			return 1;
+		}
+	}
 
+	runSuite(slots, ops, distMask, mixes, mixCount, loads, loadCount, threadCounts, threadCount);
+	return 0;
 
+}
 
-		// Search Done
 
 
-		//Start of Directive to run all iteration in parallel 
-		#pragma omp for
-		for(int i=0 ; i<insertSize ; i++){
 
-			//taking key and value from input
-			int key, value, hashedVal;
-			key = insertEl[i][0];
-			value = insertEl[i][1];
 
-			//counter helps in probing
-			int counter = 0;
+int main(int argc, char *argv[]){
 
-			//Run the loop untill the insertion is not marked
-			while(!workDone[i] && !searchDone[i]){
+	if(argc > 1 && strcmp(argv[1], "--bench") == 0){
+		benchmark();
+		return 0;
+	}
+	if(argc > 1 && strcmp(argv[1], "--suite") == 0)
+		return suiteMain(argc, argv);
+	if(argc > 1 && strcmp(argv[1], "--churn") == 0){
+		churnBenchmark();
+		return 0;
+	}
+	if(argc > 1 && strcmp(argv[1], "--stress") == 0)
+		return stressTest() ? 1 : 0;
 
-				// printf("tid = %d and key = %d\n", omp_get_thread_num(), key);
-				hashedVal = doubleDashingFunction(key, counter);
-				// printf(" hashedVal = %d \n", hashedVal);
+	//Time variable
+	double t1,t2;
+	printf("No of Threads: = %d\n",omp_get_max_threads());
 
-				//Check the condition if the respective postion is occupied or not
-				if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){
 
-					//lock the respective index of Map Table where we have to insert
-					omp_set_lock(&lock[hashedVal]);
+	//Handling the operation using condtional variable
+	int insert=1, insertA=1, search=0, del=0,searchPair=0, searchKey=0, deletKey=0, deletPair=0;
 
-					//Again checking so that other thread should not fill at same location
-					if(mapTable[hashedVal].fill==0 || (mapTable[hashedVal].fill==1 && mapTable[hashedVal].delet==1)){						
 
-						mapTable[hashedVal].key = key;
-						mapTable[hashedVal].value = value;
+	//Creating Map Table Dynamically, small so the inserts below grow it
+	struct lfMap *mapTable = mapCreate(MAP_CHUNK);
+	if(searchKey)
+		mapKeepKeyRuns(mapTable);
 
-						if(mapTable[hashedVal].fill==0)
-							mapTable[hashedVal].fill=1;
-						else
-							mapTable[hashedVal].delet=0;
 
-						workDone[i] = 1;
+	//Insertion in Map Data Structure to test insertion before next insertion
+	if(insert){
 
-						//Unset the lock
-						omp_unset_lock(&lock[hashedVal]);		
+		//Insertion Batch Size
+		int insertSize = 10000;
+		int (*insertEl)[2] = malloc(insertSize*sizeof(*insertEl));
 
-					}
-					else{
-
-						counter++;
-						//After one round of traversal of whole Map Table, break out loop
-						if(counter>30){
-							//Unset the lock
-							omp_unset_lock(&lock[hashedVal]);	//I don't think it is required here					
-							break;	
-						}
 
-					}
+		t1 = omp_get_wtime();
 
-				}else{
+		//for Marking the index of Insertion Batch Element
+		int *workDone;
+		workDone = (int*)malloc(insertSize*sizeof(int));
 
-					counter++;
-					//After one round of traversal of whole Map Table, break out loop
-					if(counter>30){
-							break;	
-					}
+		int *searchDone;
+		searchDone = (int*)malloc(insertSize*sizeof(int));
 
-				}
-				// printf("tid = %d and key = %d value = %d and work=%d and counter = %d\n", omp_get_thread_num(), key, value, workDone[i], counter);
-			}
 
+		/*Start of Dummy Input*/
+		for(int i=0 ; i<insertSize ; i++){
+			insertEl[i][0] = i;
+			insertEl[i][1] = i+7	;
+			workDone[i] = 0;	//This is important
+			searchDone[i] = 0;
 		}
-		//End of Directive to run all iteration in parallel 
-		
-
-		t2 = omp_get_wtime();
-
-		
+		/*End of Dummy Input*/
 
-		//Number of Successful Insertion
-		int success=0;
 
-		/*Start Output*/
-		// printf("\n\nElement in the Hash Table:\n\n");
+		//pairs already in the map are marked in searchDone and skipped
+		insertFun(insertSize, insertEl, workDone, searchDone, mapTable);
 
-		for(int i=0 ; i<size ; i++){
 
-			if(mapTable[i].fill==1 && mapTable[i].delet==0){
-		//		printf("key = %d  value = %d at i=%d\n", mapTable[i].key, mapTable[i].value,i);
-				success++;
-			}
+		t2 = omp_get_wtime();
 
-		}
-		
-		printf("\nmap size  = %d Insertion sucess = %d and time = %g\n", size, success, t2-t1);
+		printf("\nmap size  = %d Insertion sucess = %d and time = %g\n", mapCapacity(mapTable), mapCount(mapTable), t2-t1);
 
-		/*End Output*/
+		free(insertEl);
+		free(workDone);
+		free(searchDone);
 
 	}
 
@@ -559,12 +2482,12 @@ int main(){
 
 	// Insert again to check duplicate insertion
 
-	if(insertA){		
+	if(insertA){
 
 		printf("\nInsert Again\n");
 		//Insertion Batch Size
 		int insertSize = 8000;
-		int insertEl[insertSize][2];
+		int (*insertEl)[2] = malloc(insertSize*sizeof(*insertEl));
 
 
 		t1 = omp_get_wtime();
@@ -578,21 +2501,6 @@ int main(){
 
 
 		/*Start of Dummy Input*/
-		insertEl[0][0] = 59;
-		insertEl[0][1] = 6;
-		workDone[0] = 0;
-		searchDone[0] = 0;
-
-		insertEl[1][0] = 59;
-		insertEl[1][1] = 8;
-		workDone[1] = 0;
-		searchDone[1] = 0;
-
-		insertEl[2][0] = 59;
-		insertEl[2][1] = 9;
-		workDone[2] = 0;
-		searchDone[2] = 0;
-
 		for(int i=0 ; i<insertSize ; i++){
 			insertEl[i][0] = i;
 			insertEl[i][1] = i+8;
@@ -602,54 +2510,19 @@ int main(){
 		/*End of Dummy Input*/
 
 
-		// First need to search that all {key, value} pair present or not	
-		
-
-		//Start of Directive to run all iteration in parallel 
-		
-		searchPairFun(insertSize, insertEl, searchDone, mapTable);
-		
-
-
-
-		// Search Done
-		
-		
-
-
-		//Start of Directive to run all iteration in parallel 
-		
 		insertFun(insertSize, insertEl, workDone, searchDone, mapTable);
-		
-		
-		//End of Directive to run all iteration in parallel 
-		
-
-		t2 = omp_get_wtime();
-
-		
-
-		//Number of Successful Insertion
-		int success=0;
-
-		/*Start Output*/
-		// printf("\n\nElement in the Hash Table:\n\n");
-
-		for(int i=0 ; i<size ; i++){
 
-			if(mapTable[i].fill==1 && mapTable[i].delet==0){
-//				printf("key = %d  value = %d at i=%d\n", mapTable[i].key, mapTable[i].value,i);
-				success++;
-			}
 
-		}
-		
-		printf("\nmap size  = %d Insertion sucess = %d and time = %g\n", size, success, t2-t1);
+		t2 = omp_get_wtime();
 
-		/*End Output*/
+		printf("\nmap size  = %d Insertion sucess = %d and time = %g\n", mapCapacity(mapTable), mapCount(mapTable), t2-t1);
 
 		printf("\nInsert Again End\n");
 
+		free(insertEl);
+		free(workDone);
+		free(searchDone);
+
 	}
 
 
@@ -658,10 +2531,10 @@ int main(){
 
 		//Search with pair(key, value)
 		if(searchPair==1){
-		
+
 			//Search Batch Size
 			int searchSize = 100000;
-			int searchEl[searchSize][2];
+			int (*searchEl)[2] = malloc(searchSize*sizeof(*searchEl));
 
 			t1 = omp_get_wtime();
 
@@ -670,45 +2543,27 @@ int main(){
 			searchDone = (int*)malloc(searchSize*sizeof(int));
 
 			/*Start of Dummy Input*/
-			searchEl[0][0] = 0;
-			searchEl[0][1] = 7;
-			searchDone[0] = 0;
-
-			searchEl[1][0] = 7;
-			searchEl[1][1] = 14;
-			searchDone[1] = 0;
-
-			searchEl[2][0] = 14;
-			searchEl[2][1] = 21;
-			searchDone[2] = 0;
-			for(int i=3 ; i<searchSize ; i++){
+			for(int i=0 ; i<searchSize ; i++){
 				searchEl[i][0] = i;
 				searchEl[i][1] = 7+i;
 				searchDone[i] = 0;
 			}
-
-			
 			/*End of Dummy Input*/
 
 
 			searchPairFun(searchSize, searchEl, searchDone, mapTable);
-			
+
 			t2 = omp_get_wtime();
 
 
 			//Count the successful search
 			int success=0;
-
-			/*Start Output*/
-			printf("\n\nSearched Element in the Hash Table:\n\n");
-			for(int i=0 ; i<searchSize ; i++){
-				if(searchDone[i]){
-					// printf("key = %d  value = %d \n", searchEl[i][0], searchEl[i][1]);
-					success++;
-				}
-			}			
+			for(int i=0 ; i<searchSize ; i++)
+				success += searchDone[i];
 			printf("\nSearch sucess = %d and time = %g\n", success, t2-t1);
-			/*End Output*/
+
+			free(searchEl);
+			free(searchDone);
 
 		}
 
@@ -717,155 +2572,98 @@ int main(){
 		if(searchKey==1){
 
 			int searchSize = 100000;
-			int searchEl[searchSize];			
+			int *searchEl = (int*)malloc(searchSize*sizeof(int));
 
-			t1 = omp_get_wtime();		
+			t1 = omp_get_wtime();
 
 			/*Start of Dummy Input*/
-			searchEl[0] = 1;
-			searchEl[1] = 8;
-			searchEl[2] = 9;
-			for(int i=0 ; i<searchSize ; i++){
-				searchEl[i] = 0;
-				// searchDone[i] = 0;
-			}
-			
+			for(int i=0 ; i<searchSize ; i++)
+				searchEl[i] = i % 16;
 			/*End of Dummy Input*/
 
-			int *searchDone = (int*)malloc(searchSize*sizeof(int));
-
-			#pragma omp for
-			for(int i = 0; i < searchSize; ++i){
-				searchDone[i] = 0;
-			}
-
-
-			int checkSearch[size] = {0};
-
-			//Counter to track number of matched results
-			int  ansCounter=0;
-			
-			searchKeyFun(searchSize, &ansCounter, searchEl, searchDone, mapTable, checkSearch); 
-			
-			printf("total found = %d\n", ansCounter);
+			//every searched key's pairs as a span of the runs: no counting pass, no marks
+			struct keyRuns *runs = mapTable->runs;
+			int *ansStart = (int*)malloc(searchSize*sizeof(int));
+			int *ansCount = (int*)malloc(searchSize*sizeof(int));
 
-			
+			int distinct = 0;
+			int ansCounter = searchKeyFun(searchSize, searchEl, ansStart, ansCount, &distinct, runs);
 
-			//checkSearch array used to accumulate the results
-			#pragma omp parallel for
-			for(int i=0 ; i<size ; i++)
-				checkSearch[i]=0;
 
-
-			//Store results in ans array 
-			struct element *ans = (struct element*)malloc(ansCounter*sizeof(struct element));
-			int insertIndex=0;
-			
-			searchKeyAnsInsert(searchSize, &insertIndex, searchEl, searchDone, checkSearch, mapTable, ans);
-
-			
 			t2 = omp_get_wtime();
-		
+
 			/*Start Output*/
 			printf("\n\nNumber of elements found = %d and time = %g\n\n",ansCounter, t2-t1);
-			printf("\n\nNumber of elements non overlapped found = %d and time = %g\n\n",insertIndex, t2-t1);
-			//for(int i=0 ; i<insertIndex ; i++){
-			//	printf("key = %d and value = %d\n", ans[i].key, ans[i].value);
-			//}
+			printf("\n\nNumber of elements non overlapped found = %d and time = %g\n\n",distinct, t2-t1);
 			/*End Output*/
 
+			free(searchEl);
+			free(ansStart);
+			free(ansCount);
+
 		}//End with key only
-	
+
 	}
 
 
 	//Delete operation in Map Data Structure
 	if(del==1){
-		
+
 		//Delete with pair(key, value)
 		if(deletPair == 1){
 
 			int deletBatchSize = 100000;
-			int deletBatchEl[deletBatchSize][2];
+			int (*deletBatchEl)[2] = malloc(deletBatchSize*sizeof(*deletBatchEl));
 
 			/*Start of Dummy Input*/
-			printf("Elements to Delete : \n\n");
 			for(int i=0 ; i<deletBatchSize ; i++){
 				deletBatchEl[i][0] = 5+i;
 				deletBatchEl[i][1] = i+7;
-//				//printf("Dkey = %d Dvalue = %d\n", deletBatchEl[i][0], deletBatchEl[i][1]); 
 			}
-			printf("\n");
-
 			/*End of Dummy Input*/
 
 
 			t1 = omp_get_wtime();
-			int checkDel[size]={0};	
-			
-			deletePairFun(deletBatchSize, deletBatchEl, checkDel, mapTable);				
+			int *checkDel = (int*)malloc(deletBatchSize*sizeof(int));
+
+			deletePairFun(deletBatchSize, deletBatchEl, checkDel, mapTable);
 
-			
 			t2 = omp_get_wtime();
-			int total=0;
 
-			/*Start Output*/
-			//printf("\n\nElement in the Hash Table:\n\n");
-			for(int i=0 ; i<size ; i++){				
-				if(mapTable[i].fill==1 && mapTable[i].delet==0){
-			//		printf("key = %d  value = %d at i=%d\n", mapTable[i].key, mapTable[i].value,i);
-					total++;
-				}
-			}			
-			printf("\nmap size  = %d total reside = %d and time = %g\n", size, total, t2-t1);
-			/*End Output*/
-			
+			printf("\nmap size  = %d total reside = %d and time = %g\n", mapCapacity(mapTable), mapCount(mapTable), t2-t1);
+
+			free(deletBatchEl);
+			free(checkDel);
+
 		}
 
 		//Delete Element with only key matched
 		if(deletKey == 1){
 
 			int deletBatchSize = 100000;
-			int deletBatchEl[deletBatchSize];
+			int *deletBatchEl = (int*)malloc(deletBatchSize*sizeof(int));
 
 			/*Start of Dummy Input*/
-			//printf("Elements to Delete : \n\n");
-			for(int i=0 ; i<deletBatchSize ; i++){
-				deletBatchEl[i] = i+5;				
-				//printf("Dkey = %d \n", deletBatchEl[i]); 
-			}
-			printf("\n");
+			for(int i=0 ; i<deletBatchSize ; i++)
+				deletBatchEl[i] = i+5;
 			/*End of Dummy Input*/
 
 			t1 = omp_get_wtime();
 
-			int checkDel[size]={0};
-			
-			deletKeyFun(deletBatchSize, deletBatchEl, checkDel, mapTable);
+			int *checkDel = (int*)malloc(deletBatchSize*sizeof(int));
 
-			
+			deletKeyFun(deletBatchSize, deletBatchEl, checkDel, mapTable);
 
 			t2 = omp_get_wtime();
-			int total=0;
 
-			/*Start Output*/
-			//printf("\n\nElement in the Hash Table:\n\n");
-			for(int i=0 ; i<size ; i++){				
-				if(mapTable[i].fill==1 && mapTable[i].delet==0){
-					//printf("key = %d  value = %d at i=%d\n", mapTable[i].key, mapTable[i].value,i);
-					total++;
-				}
-			}			
-			printf("\nmap size  = %d total reside = %d and time = %g\n", size, total, t2-t1);
-			/*End Output*/
+			printf("\nmap size  = %d total reside = %d and time = %g\n", mapCapacity(mapTable), mapCount(mapTable), t2-t1);
+
+			free(deletBatchEl);
+			free(checkDel);
 		}
 	}
 
-	//Destroy the lock
-	#pragma omp for
-	for(int i = 0; i < size; ++i){
-		omp_destroy_lock(&lock[i]);
-	}
+	mapDestroy(mapTable);
 
 	return 0;
 
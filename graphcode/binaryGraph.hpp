@@ -0,0 +1,543 @@
+#ifndef BINARY_GRAPH_H
+#define BINARY_GRAPH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graphIndex.hpp"
+#include "compressedCSR.hpp"
+#include "reverseCSR.hpp"
+
+/* Binary CSR graph file (.spcsr), written by csrConvert and mapped
+   read-only by mappedGraph.
+
+   layout, every section starting on a 4096 byte boundary:
+
+     header          binaryGraphHeader
+     offsets         V+1 entries, 4 or 8 bytes (BG_OFFSET64)
+     adjacency       E entries, 4 or 8 bytes (BG_INDEX64), sorted per node,
+                     or the varint stream of compressedCSR.hpp (BG_COMPRESSED)
+     weights         E int32, if BG_WEIGHTED
+     rev offsets     V+1 entries, if BG_REVERSE
+     rev adjacency   E entries, sources grouped by destination
+     adjacency index V+1 uint64 positions in the varint stream, if BG_COMPRESSED
+
+   The converter picks the narrowest widths that hold V and E. Sections
+   whose width matches the graph's index and offset types are used in
+   place from the mapping, so loading costs only the mmap. Narrower
+   sections in a wide build are widened into private arrays. Wider ones
+   stop the load, see requireGraphIndexFits. withMappedGraph avoids both:
+   it takes the widths from the header and maps the file in them. Checksums are FNV-1a over each section and
+   are only checked on request, since checking reads the whole file. */
+
+#define BINARY_GRAPH_MAGIC "SPCSR\0\0"
+#define BINARY_GRAPH_VERSION 2
+#define BINARY_GRAPH_ALIGN 4096
+
+enum
+{
+  BG_WEIGHTED = 1,
+  BG_REVERSE = 2,
+  BG_OFFSET64 = 4,
+  BG_INDEX64 = 8,
+  BG_COMPRESSED = 16
+};
+
+enum
+{
+  BG_SECTION_OFFSETS,
+  BG_SECTION_ADJACENCY,
+  BG_SECTION_WEIGHTS,
+  BG_SECTION_REV_OFFSETS,
+  BG_SECTION_REV_ADJACENCY,
+  BG_SECTION_ADJACENCY_INDEX,
+  BG_NUM_SECTIONS
+};
+
+#define BG_V1_SECTIONS 5
+
+struct binaryGraphHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t numNodes;
+  uint64_t numEdges;
+  uint64_t sectionAt[BG_NUM_SECTIONS];     /* byte position in the file, 0 if absent */
+  uint64_t sectionBytes[BG_NUM_SECTIONS];
+  uint64_t sectionChecksum[BG_NUM_SECTIONS];
+  uint64_t headerChecksum;                 /* over everything above */
+};
+
+/* version 1 had no compressed adjacency and one section fewer */
+struct binaryGraphHeaderV1
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t numNodes;
+  uint64_t numEdges;
+  uint64_t sectionAt[BG_V1_SECTIONS];
+  uint64_t sectionBytes[BG_V1_SECTIONS];
+  uint64_t sectionChecksum[BG_V1_SECTIONS];
+  uint64_t headerChecksum;
+};
+
+inline uint64_t binaryGraphChecksum(const void* data, size_t bytes)
+{
+  const unsigned char* p = (const unsigned char*)data;
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < bytes; i++)
+  {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+inline uint64_t binaryGraphHeaderChecksum(const binaryGraphHeader& header)
+{
+  return binaryGraphChecksum(&header, offsetof(binaryGraphHeader, headerChecksum));
+}
+
+/* Size each section must have for the header's V, E and flags, or -1 if
+   only the file bounds it (the varint stream). 0 means absent. */
+inline long long binaryGraphExpectedBytes(const binaryGraphHeader& header, int s)
+{
+  uint64_t V = header.numNodes;
+  uint64_t E = header.numEdges;
+  uint64_t offsetWidth = (header.flags & BG_OFFSET64) ? 8 : 4;
+  uint64_t indexWidth = (header.flags & BG_INDEX64) ? 8 : 4;
+  bool compressed = (header.flags & BG_COMPRESSED) != 0;
+  bool reverse = (header.flags & BG_REVERSE) != 0;
+
+  switch (s)
+  {
+    case BG_SECTION_OFFSETS:
+      return (V + 1) * offsetWidth;
+    case BG_SECTION_ADJACENCY:
+      return compressed ? -1 : (long long)(E * indexWidth);
+    case BG_SECTION_WEIGHTS:
+      return (header.flags & BG_WEIGHTED) ? E * sizeof(int32_t) : 0;
+    case BG_SECTION_REV_OFFSETS:
+      return reverse ? (V + 1) * offsetWidth : 0;
+    case BG_SECTION_REV_ADJACENCY:
+      return reverse ? E * indexWidth : 0;
+    case BG_SECTION_ADJACENCY_INDEX:
+      return compressed ? (V + 1) * sizeof(uint64_t) : 0;
+  }
+  return 0;
+}
+
+/* Every section lies inside the file and has the size V, E and the widths
+   imply. Written so that no sum can wrap: V and E are first bounded by the
+   file size, then each section by what is left after its start. */
+inline bool binaryGraphSectionsFit(const binaryGraphHeader& header, size_t bytes)
+{
+  if (header.numNodes >= bytes || header.numEdges > bytes)
+    return false;
+  if ((header.flags & BG_COMPRESSED) && header.version < 2)
+    return false;
+
+  for (int s = 0; s < BG_NUM_SECTIONS; s++)
+  {
+    long long expected = binaryGraphExpectedBytes(header, s);
+    if (header.sectionAt[s] == 0)
+    {
+      /* absent is only fine for a section that would be empty anyway */
+      bool empty = expected == 0 || (expected < 0 && header.numEdges == 0);
+      if (header.sectionBytes[s] != 0 || !empty)
+        return false;
+      continue;
+    }
+    if (header.sectionAt[s] > bytes || header.sectionBytes[s] > bytes - header.sectionAt[s])
+      return false;
+    /* a varint takes at least one byte per edge */
+    if (expected < 0 ? header.sectionBytes[s] < header.numEdges : header.sectionBytes[s] != (uint64_t)expected)
+      return false;
+  }
+  return true;
+}
+
+/* Header of a mapped file in the current layout. False if the magic,
+   version or header checksum is wrong, or a section runs past the end or
+   does not have the size the header implies. */
+inline bool readBinaryGraphHeader(const void* mapping, size_t bytes, binaryGraphHeader& header)
+{
+  if (bytes < sizeof(binaryGraphHeaderV1) || memcmp(mapping, BINARY_GRAPH_MAGIC, 8) != 0)
+    return false;
+
+  memset(&header, 0, sizeof(header));
+  const binaryGraphHeaderV1* old = (const binaryGraphHeaderV1*)mapping;
+  if (old->version == 1)
+  {
+    if (old->headerChecksum != binaryGraphChecksum(old, offsetof(binaryGraphHeaderV1, headerChecksum)))
+      return false;
+    memcpy(header.magic, old->magic, 8);
+    header.version = old->version;
+    header.flags = old->flags;
+    header.numNodes = old->numNodes;
+    header.numEdges = old->numEdges;
+    for (int s = 0; s < BG_V1_SECTIONS; s++)
+    {
+      header.sectionAt[s] = old->sectionAt[s];
+      header.sectionBytes[s] = old->sectionBytes[s];
+      header.sectionChecksum[s] = old->sectionChecksum[s];
+    }
+  }
+  else if (old->version == BINARY_GRAPH_VERSION && bytes >= sizeof(header))
+  {
+    memcpy(&header, mapping, sizeof(header));
+    if (header.headerChecksum != binaryGraphHeaderChecksum(header))
+      return false;
+  }
+  else
+    return false;
+
+  return binaryGraphSectionsFit(header, bytes);
+}
+
+inline size_t binaryGraphAlign(size_t pos)
+{
+  return (pos + BINARY_GRAPH_ALIGN - 1) & ~(size_t)(BINARY_GRAPH_ALIGN - 1);
+}
+
+/* Writes the sections given as raw arrays already in the widths named by
+   flags. Absent sections are NULL. With BG_COMPRESSED, adjacency is the
+   varint stream of adjacencyBytes bytes and adjacencyIndex its per-node
+   positions. Returns false on any I/O error. */
+inline bool writeBinaryGraph(const char* path, uint32_t flags, uint64_t V, uint64_t E,
+                             const void* offsets, const void* adjacency, const int32_t* weights,
+                             const void* revOffsets, const void* revAdjacency,
+                             const uint64_t* adjacencyIndex = NULL, uint64_t adjacencyBytes = 0)
+{
+  binaryGraphHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BINARY_GRAPH_MAGIC, 8);
+  header.version = BINARY_GRAPH_VERSION;
+  header.flags = flags;
+  header.numNodes = V;
+  header.numEdges = E;
+
+  size_t offsetWidth = (flags & BG_OFFSET64) ? 8 : 4;
+  size_t indexWidth = (flags & BG_INDEX64) ? 8 : 4;
+  bool compressed = (flags & BG_COMPRESSED) != 0;
+  const void* data[BG_NUM_SECTIONS] = {offsets, adjacency, weights, revOffsets, revAdjacency, compressed ? adjacencyIndex : NULL};
+  header.sectionBytes[BG_SECTION_OFFSETS] = (V + 1) * offsetWidth;
+  header.sectionBytes[BG_SECTION_ADJACENCY] = compressed ? adjacencyBytes : E * indexWidth;
+  header.sectionBytes[BG_SECTION_ADJACENCY_INDEX] = compressed ? (V + 1) * sizeof(uint64_t) : 0;
+  header.sectionBytes[BG_SECTION_WEIGHTS] = (flags & BG_WEIGHTED) ? E * sizeof(int32_t) : 0;
+  header.sectionBytes[BG_SECTION_REV_OFFSETS] = (flags & BG_REVERSE) ? (V + 1) * offsetWidth : 0;
+  header.sectionBytes[BG_SECTION_REV_ADJACENCY] = (flags & BG_REVERSE) ? E * indexWidth : 0;
+
+  size_t pos = binaryGraphAlign(sizeof(header));
+  for (int s = 0; s < BG_NUM_SECTIONS; s++)
+  {
+    if (data[s] == NULL)
+      continue;
+    header.sectionAt[s] = pos;
+    header.sectionChecksum[s] = binaryGraphChecksum(data[s], header.sectionBytes[s]);
+    pos = binaryGraphAlign(pos + header.sectionBytes[s]);
+  }
+  header.headerChecksum = binaryGraphHeaderChecksum(header);
+
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+    return false;
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (int s = 0; s < BG_NUM_SECTIONS && ok; s++)
+  {
+    if (header.sectionAt[s] == 0)
+      continue;
+    ok = fseeko(file, header.sectionAt[s], SEEK_SET) == 0;
+    if (ok && header.sectionBytes[s] > 0)
+      ok = fwrite(data[s], header.sectionBytes[s], 1, file) == 1;
+  }
+  /* pad the last section so the file size is a multiple of the alignment */
+  if (ok && fseeko(file, pos - 1, SEEK_SET) == 0)
+    ok = fputc(0, file) != EOF;
+  return fclose(file) == 0 && ok;
+}
+
+inline bool binaryGraphSectionsOk(const void* mapping, const binaryGraphHeader& header)
+{
+  for (int s = 0; s < BG_NUM_SECTIONS; s++)
+  {
+    if (header.sectionAt[s] == 0)
+      continue;
+    if (binaryGraphChecksum((const char*)mapping + header.sectionAt[s], header.sectionBytes[s]) != header.sectionChecksum[s])
+      return false;
+  }
+  return true;
+}
+
+/* Full check of a written file, independent of this build's index widths.
+   Reads every section. */
+inline bool verifyBinaryGraph(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(binaryGraphHeader))
+  {
+    close(fd);
+    return false;
+  }
+  size_t bytes = info.st_size;
+  void* mapping = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  binaryGraphHeader header;
+  bool ok = readBinaryGraphHeader(mapping, bytes, header) && binaryGraphSectionsOk(mapping, header);
+  munmap(mapping, bytes);
+  return ok;
+}
+
+/* true if path starts with the .spcsr magic, for loaders that accept both
+   the text edge list and the binary format */
+inline bool isBinaryGraph(const char* path)
+{
+  char magic[8];
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+  bool match = fread(magic, 8, 1, file) == 1 && memcmp(magic, BINARY_GRAPH_MAGIC, 8) == 0;
+  fclose(file);
+  return match;
+}
+
+/* Read-only view of an .spcsr file. The member names follow graph.hpp so
+   the CSR export and hand-written mains can use either. mappedGraph has
+   the build's widths; withMappedGraph below picks them per file. */
+template <typename indexT, typename offsetT>
+class basicMappedGraph
+{
+  private:
+  void* mapping;
+  size_t mappingBytes;
+  binaryGraphHeader header;
+  void* widened[BG_NUM_SECTIONS];
+
+  static void fail(const char* path, const char* reason)
+  {
+    fprintf(stderr, "%s: %s\n", path, reason);
+    exit(1);
+  }
+
+  const char* section(int s) const
+  {
+    return header.sectionAt[s] ? (const char*)mapping + header.sectionAt[s] : NULL;
+  }
+
+  /* in place if the file width matches the build, else a widened copy */
+  template <typename T>
+  const T* view(int s, size_t count, bool wideInFile)
+  {
+    const char* raw = section(s);
+    if (raw == NULL)
+      return NULL;
+    if ((wideInFile ? 8 : 4) == sizeof(T))
+      return (const T*)raw;
+
+    T* copy = (T*)malloc(count * sizeof(T));
+    const int32_t* narrow = (const int32_t*)raw;
+    #pragma omp parallel for
+    for (long long i = 0; i < (long long)count; i++)
+      copy[i] = narrow[i];
+    widened[s] = copy;
+    return copy;
+  }
+
+  public:
+  const offsetT* indexofNodes;
+  const indexT* edgeList;
+  const int32_t* edgeLen;
+  const offsetT* rev_indexofNodes;
+  const indexT* srcList;
+  const uint8_t* adjacencyBytes;    /* BG_COMPRESSED: edgeList is NULL, lists are decoded */
+  const uint64_t* adjacencyIndex;
+
+  explicit basicMappedGraph(const char* path)
+  {
+    memset(widened, 0, sizeof(widened));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      fail(path, "cannot open");
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(binaryGraphHeader))
+      fail(path, "not a binary graph file");
+    mappingBytes = info.st_size;
+    mapping = mmap(NULL, mappingBytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+      fail(path, "mmap failed");
+
+    if (!readBinaryGraphHeader(mapping, mappingBytes, header))
+      fail(path, "not a binary graph file of a known version, or truncated");
+    if (!graphWidthsFit<indexT, offsetT>(header.numNodes, header.numEdges))
+    {
+      requireGraphIndexFits(header.numNodes, header.numEdges, path);
+      fail(path, "graph does not fit the index widths it was mapped with");
+    }
+    if (((header.flags & BG_OFFSET64) && sizeof(offsetT) < 8) || ((header.flags & BG_INDEX64) && sizeof(indexT) < 8))
+      fail(path, "file was written with wider indices than this build");
+
+    bool offset64 = (header.flags & BG_OFFSET64) != 0;
+    bool index64 = (header.flags & BG_INDEX64) != 0;
+    indexofNodes = view<offsetT>(BG_SECTION_OFFSETS, header.numNodes + 1, offset64);
+    if (isCompressed())
+    {
+      edgeList = NULL;
+      adjacencyBytes = (const uint8_t*)section(BG_SECTION_ADJACENCY);
+      adjacencyIndex = (const uint64_t*)section(BG_SECTION_ADJACENCY_INDEX);
+    }
+    else
+    {
+      edgeList = view<indexT>(BG_SECTION_ADJACENCY, header.numEdges, index64);
+      adjacencyBytes = NULL;
+      adjacencyIndex = NULL;
+    }
+    edgeLen = (const int32_t*)section(BG_SECTION_WEIGHTS);
+    rev_indexofNodes = view<offsetT>(BG_SECTION_REV_OFFSETS, header.numNodes + 1, offset64);
+    srcList = view<indexT>(BG_SECTION_REV_ADJACENCY, header.numEdges, index64);
+  }
+
+  ~basicMappedGraph()
+  {
+    for (int s = 0; s < BG_NUM_SECTIONS; s++)
+      free(widened[s]);
+    munmap(mapping, mappingBytes);
+  }
+
+  basicMappedGraph(const basicMappedGraph&) = delete;
+  basicMappedGraph& operator=(const basicMappedGraph&) = delete;
+
+  indexT num_nodes() const
+  {
+    return (indexT)header.numNodes;
+  }
+
+  offsetT num_edges() const
+  {
+    return (offsetT)header.numEdges;
+  }
+
+  bool isWeighted() const
+  {
+    return (header.flags & BG_WEIGHTED) != 0;
+  }
+
+  bool hasReverse() const
+  {
+    return (header.flags & BG_REVERSE) != 0;
+  }
+
+  bool isCompressed() const
+  {
+    return (header.flags & BG_COMPRESSED) != 0;
+  }
+
+  /* out-edges of v, decoded on the fly for a compressed file */
+  basicNeighbourRange<indexT, offsetT> getNeighbors(indexT v) const
+  {
+    const uint8_t* cursor = adjacencyBytes ? adjacencyBytes + adjacencyIndex[v] : NULL;
+    return basicNeighbourRange<indexT, offsetT>(v, indexofNodes[v], indexofNodes[v + 1], edgeList, cursor, edgeLen);
+  }
+
+  /* builds the reverse CSR in memory for a file converted without one */
+  void ensureReverse()
+  {
+    if (rev_indexofNodes != NULL)
+      return;
+
+    auto row = [&](int64_t v, auto visit)
+    {
+      for (const basicCsrEdge<indexT, offsetT>& e : getNeighbors((indexT)v))
+        visit(e.destination);
+    };
+    offsetT* revOffsets;
+    indexT* sources;
+    buildReverseCSR<offsetT, indexT>(header.numNodes, row, revOffsets, sources);
+    widened[BG_SECTION_REV_OFFSETS] = revOffsets;
+    widened[BG_SECTION_REV_ADJACENCY] = sources;
+    rev_indexofNodes = revOffsets;
+    srcList = sources;
+  }
+
+  /* reads every section, so only worth it after a copy or on suspicion */
+  bool verify() const
+  {
+    return binaryGraphSectionsOk(mapping, header);
+  }
+};
+
+typedef basicMappedGraph<index_t, offset_t> mappedGraph;
+
+template <typename indexT, typename offsetT>
+inline void ensureReverse(basicMappedGraph<indexT, offsetT>& g)
+{
+  g.ensureReverse();
+}
+
+/* V, E and flags from the header of an .spcsr file; false if it is not one */
+inline bool readBinaryGraphShape(const char* path, uint64_t& V, uint64_t& E, uint32_t& flags)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  bool ok = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(binaryGraphHeaderV1);
+  void* mapping = ok ? mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  binaryGraphHeader header;
+  ok = readBinaryGraphHeader(mapping, info.st_size, header);
+  munmap(mapping, info.st_size);
+  V = header.numNodes;
+  E = header.numEdges;
+  flags = header.flags;
+  return ok;
+}
+
+/* Maps path in the widths its header announces, which the converter chose
+   as the narrowest for V and E, and runs body on it:
+
+     withMappedGraph(path, [&](auto& g) { compute(g); });
+
+   A graph that fits 32 bits gets the 32-bit instance in every build, and
+   a 7B edge crawl loads without -DGRAPH_OFFSET_64. Nothing is widened. */
+template <typename Body>
+inline void withMappedGraph(const char* path, Body body)
+{
+  uint64_t V;
+  uint64_t E;
+  uint32_t flags;
+  if (!readBinaryGraphShape(path, V, E, flags))
+  {
+    fprintf(stderr, "%s: not a binary graph file of a known version, or truncated\n", path);
+    exit(1);
+  }
+
+  bool wideIndex = (flags & BG_INDEX64) || !graphWidthsFit<int32_t, int64_t>(V, 0);
+  bool wideOffset = (flags & BG_OFFSET64) || !graphWidthsFit<int32_t, int32_t>(0, E);
+  dispatchGraphWidthFlags(wideIndex, wideOffset, [&](auto widths)
+  {
+    basicMappedGraph<typename decltype(widths)::index_t, typename decltype(widths)::offset_t> g(path);
+    body(g);
+  });
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef BIT_PROP_H
+#define BIT_PROP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include "numaAlloc.hpp"
+#include "propPool.hpp"
+
+/* propNode<bool> / propEdge<bool> storage, one bit per element packed in
+   64-bit words. Writes go through atomic fetch_or / fetch_and so concurrent
+   updates of neighbouring elements never lose each other's bits.
+
+   prop[i] hands out a small proxy so generated code can keep writing
+   prop[v] = true / if(prop[v]) unchanged. Scans over set bits (filters
+   like v.modified == True) walk the words and use ctz to jump between set
+   bits, so a zero word costs a single compare.
+
+   Built with deviceShared, the words are CUDA managed memory that kernels
+   test and set through deviceView (deviceProp.hpp); reset() then fills
+   them on the device. */
+
+class bitProp
+{
+  private:
+  std::atomic<uint64_t>* words;
+  size_t length;
+  size_t numWords;
+  size_t capacityWords;
+  propPool* pool;           /* the graph's pool, or NULL to map directly */
+  bool deviceShared;        /* managed words kernels also use */
+
+  void releaseWords()
+  {
+    if (pool != NULL)
+      pool->release(words, capacityWords * sizeof(uint64_t), deviceShared);
+    else
+      numaFree(words, capacityWords);
+    words = NULL;
+  }
+
+  static inline size_t wordOf(size_t i)
+  {
+    return i >> 6;
+  }
+
+  static inline uint64_t maskOf(size_t i)
+  {
+    return (uint64_t)1 << (i & 63);
+  }
+
+  /* bits past length in the last word are kept clear so that counts and
+     scans never see them */
+  inline uint64_t tailMask() const
+  {
+    return (length & 63) ? (maskOf(length) - 1) : ~(uint64_t)0;
+  }
+
+  inline uint64_t loadWord(size_t w) const
+  {
+    uint64_t bits = words[w].load(std::memory_order_relaxed);
+    return (w == numWords - 1) ? (bits & tailMask()) : bits;
+  }
+
+  public:
+  class reference
+  {
+    private:
+    bitProp* prop;
+    size_t index;
+
+    public:
+    reference(bitProp* propSent, size_t indexSent)
+    {
+      prop = propSent;
+      index = indexSent;
+    }
+
+    operator bool() const
+    {
+      return prop->test(index);
+    }
+
+    reference& operator=(bool val)
+    {
+      if (val)
+        prop->set(index);
+      else
+        prop->clear(index);
+      return *this;
+    }
+
+    reference& operator=(const reference& other)
+    {
+      return *this = (bool)other;
+    }
+  };
+
+  class setBitIterator
+  {
+    private:
+    const bitProp* prop;
+    size_t wordIndex;
+    uint64_t remaining;
+
+    void skipZeroWords()
+    {
+      while (remaining == 0)
+      {
+        if (++wordIndex >= prop->numWords)
+        {
+          wordIndex = prop->numWords;
+          return;
+        }
+        remaining = prop->loadWord(wordIndex);
+      }
+    }
+
+    public:
+    setBitIterator(const bitProp* propSent, size_t wordIndexSent)
+    {
+      prop = propSent;
+      wordIndex = wordIndexSent;
+      remaining = 0;
+      if (wordIndex < prop->numWords)
+      {
+        remaining = prop->loadWord(wordIndex);
+        skipZeroWords();
+      }
+    }
+
+    size_t operator*() const
+    {
+      return (wordIndex << 6) + __builtin_ctzll(remaining);
+    }
+
+    setBitIterator& operator++()
+    {
+      remaining &= remaining - 1;
+      skipZeroWords();
+      return *this;
+    }
+
+    bool operator!=(const setBitIterator& other) const
+    {
+      return wordIndex != other.wordIndex || remaining != other.remaining;
+    }
+  };
+
+  class setBitRange
+  {
+    private:
+    const bitProp* prop;
+
+    public:
+    setBitRange(const bitProp* propSent)
+    {
+      prop = propSent;
+    }
+
+    setBitIterator begin() const
+    {
+      return setBitIterator(prop, 0);
+    }
+
+    setBitIterator end() const
+    {
+      return setBitIterator(prop, prop->numWords);
+    }
+  };
+
+  bitProp()
+  {
+    words = NULL;
+    length = 0;
+    numWords = 0;
+    capacityWords = 0;
+    pool = NULL;
+    deviceShared = false;
+  }
+
+  explicit bitProp(size_t n)
+  {
+    words = NULL;
+    length = 0;
+    numWords = 0;
+    capacityWords = 0;
+    pool = NULL;
+    deviceShared = false;
+    reset(false, n);
+  }
+
+  /* words from the graph's pool (propPoolFor(g)), returned to it here;
+     deviceShared for a prop kernels read or write */
+  explicit bitProp(propPool& graphPool, bool deviceSharedSent = false)
+  {
+    words = NULL;
+    length = 0;
+    numWords = 0;
+    capacityWords = 0;
+    pool = &graphPool;
+    deviceShared = deviceSharedSent;
+  }
+
+  ~bitProp()
+  {
+    releaseWords();
+  }
+
+  bitProp(const bitProp&) = delete;
+  bitProp& operator=(const bitProp&) = delete;
+
+  /* attach*Property(prop = init) over n elements. Rewrites n/64 words,
+     and the storage only grows. */
+  void reset(bool init, size_t n)
+  {
+    size_t wordsNeeded = (n + 63) >> 6;
+    if (wordsNeeded > capacityWords)
+    {
+      releaseWords();
+      if (pool != NULL)
+        words = (std::atomic<uint64_t>*)pool->acquire(wordsNeeded * sizeof(uint64_t), deviceShared);
+      else
+        words = (std::atomic<uint64_t>*)numaMap(wordsNeeded * sizeof(uint64_t), numaDefaultPolicy());
+      capacityWords = wordsNeeded;
+    }
+    length = n;
+    numWords = wordsNeeded;
+    uint64_t fill = init ? ~(uint64_t)0 : 0;
+
+#ifdef __CUDACC__
+    if (deviceShared)
+    {
+      /* filled where the kernels will read them */
+      cudaMemset(words, init ? 0xFF : 0, numWords * sizeof(uint64_t));
+      if (init && numWords > 0)
+      {
+        uint64_t tail = tailMask();
+        cudaMemcpy(words + numWords - 1, &tail, sizeof(uint64_t), cudaMemcpyHostToDevice);
+      }
+      cudaDeviceSynchronize();
+      return;
+    }
+#endif
+    #pragma omp parallel for schedule(static)
+    for (long w = 0; w < (long)numWords; w++)
+      words[w].store(fill, std::memory_order_relaxed);
+    if (init && numWords > 0)
+      words[numWords - 1].store(tailMask(), std::memory_order_relaxed);
+  }
+
+  inline bool test(size_t i) const
+  {
+    return (words[wordOf(i)].load(std::memory_order_relaxed) & maskOf(i)) != 0;
+  }
+
+  /* both return the previous value of the bit */
+  inline bool set(size_t i)
+  {
+    return (words[wordOf(i)].fetch_or(maskOf(i), std::memory_order_relaxed) & maskOf(i)) != 0;
+  }
+
+  inline bool clear(size_t i)
+  {
+    return (words[wordOf(i)].fetch_and(~maskOf(i), std::memory_order_relaxed) & maskOf(i)) != 0;
+  }
+
+  inline reference operator[](size_t i)
+  {
+    return reference(this, i);
+  }
+
+  inline bool operator[](size_t i) const
+  {
+    return test(i);
+  }
+
+  size_t count() const
+  {
+    size_t total = 0;
+    #pragma omp parallel for reduction(+ : total)
+    for (long w = 0; w < (long)numWords; w++)
+      total += __builtin_popcountll(loadWord(w));
+    return total;
+  }
+
+  bool any() const
+  {
+    for (size_t w = 0; w < numWords; w++)
+      if (loadWord(w) != 0)
+        return true;
+    return false;
+  }
+
+  /* for (int v : prop.setBits()) visits the set elements in order */
+  setBitRange setBits() const
+  {
+    return setBitRange(this);
+  }
+
+  size_t size() const
+  {
+    return length;
+  }
+
+  /* what deviceView hands to kernels */
+  uint64_t* wordData()
+  {
+    return (uint64_t*)words;
+  }
+};
+
+#endif
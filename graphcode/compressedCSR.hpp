@@ -0,0 +1,212 @@
+#ifndef COMPRESSED_CSR_H
+#define COMPRESSED_CSR_H
+
+#include <stdint.h>
+#include <vector>
+#include "graphIndex.hpp"
+
+/* Byte-coded adjacency lists.
+
+   Each node's sorted neighbour list is stored as its first id followed by
+   the gaps to the previous neighbour, every value as a little-endian
+   base-128 varint (7 bits per byte, high bit set on all but the last byte).
+   Gaps on sorted social/web lists are mostly under 128, so most edges take
+   a single byte instead of four. indexofNodes stays a plain array, so
+   degrees and edge ids (for edge properties) cost nothing extra. byteIndex
+   holds where each node's list starts in the byte stream.
+
+   neighbourRange walks one list and hands out csrEdge values. It reads a
+   plain edgeList the same way, so loops written against getNeighbors()
+   work on either representation. */
+
+static inline void encodeVarint(uint64_t value, uint8_t* out, size_t& pos)
+{
+  while (value >= 0x80)
+  {
+    out[pos++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[pos++] = (uint8_t)value;
+}
+
+static inline size_t varintLength(uint64_t value)
+{
+  size_t length = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    length++;
+  }
+  return length;
+}
+
+static inline uint64_t decodeVarint(const uint8_t*& p)
+{
+  uint64_t value = *p & 0x7f;
+  if (!(*p++ & 0x80))
+    return value;
+
+  int shift = 7;
+  uint8_t b;
+  do
+  {
+    b = *p++;
+    value |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+  } while (b & 0x80);
+  return value;
+}
+
+/* offsets/adjacency as in a plain CSR with each list sorted. Fills
+   byteIndex (numNodes + 1 entries) and bytes. */
+template <typename offT, typename idxT>
+static void compressAdjacency(const offT* offsets, const idxT* adjacency, int64_t numNodes,
+                              std::vector<uint64_t>& byteIndex, std::vector<uint8_t>& bytes)
+{
+  byteIndex.assign(numNodes + 1, 0);
+
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+  {
+    uint64_t length = 0;
+    int64_t previous = 0;
+    for (offT e = offsets[v]; e < offsets[v + 1]; e++)
+    {
+      length += varintLength((uint64_t)((int64_t)adjacency[e] - previous));
+      previous = adjacency[e];
+    }
+    byteIndex[v + 1] = length;
+  }
+  for (int64_t v = 0; v < numNodes; v++)
+    byteIndex[v + 1] += byteIndex[v];
+
+  bytes.resize(byteIndex[numNodes]);
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+  {
+    size_t pos = byteIndex[v];
+    int64_t previous = 0;
+    for (offT e = offsets[v]; e < offsets[v + 1]; e++)
+    {
+      encodeVarint((uint64_t)((int64_t)adjacency[e] - previous), bytes.data(), pos);
+      previous = adjacency[e];
+    }
+  }
+}
+
+/* Templates over the index widths so a graph mapped with run-time widths
+   (withMappedGraph in binaryGraph.hpp) walks its lists in them; the build's
+   index_t/offset_t instances keep the plain names. */
+template <typename indexT, typename offsetT>
+struct basicCsrEdge
+{
+  indexT source;
+  indexT destination;
+  int32_t weight;
+  offsetT id;
+};
+
+typedef basicCsrEdge<index_t, offset_t> csrEdge;
+
+template <typename indexT, typename offsetT>
+class basicNeighbourIterator
+{
+  private:
+  const indexT* plain;       /* NULL when decoding */
+  const uint8_t* cursor;
+  const int32_t* weights;
+  offsetT end;
+  basicCsrEdge<indexT, offsetT> current;
+
+  inline void load()
+  {
+    if (plain != NULL)
+      current.destination = plain[current.id];
+    else
+      current.destination += (indexT)decodeVarint(cursor);
+    current.weight = weights ? weights[current.id] : 1;
+  }
+
+  public:
+  basicNeighbourIterator(indexT source, offsetT begin, offsetT endSent, const indexT* plainSent,
+                         const uint8_t* cursorSent, const int32_t* weightsSent)
+  {
+    plain = plainSent;
+    cursor = cursorSent;
+    weights = weightsSent;
+    end = endSent;
+    current.source = source;
+    current.destination = 0;
+    current.id = begin;
+    if (current.id < end)
+      load();
+  }
+
+  const basicCsrEdge<indexT, offsetT>& operator*() const
+  {
+    return current;
+  }
+
+  const basicCsrEdge<indexT, offsetT>* operator->() const
+  {
+    return &current;
+  }
+
+  inline basicNeighbourIterator& operator++()
+  {
+    if (++current.id < end)
+      load();
+    return *this;
+  }
+
+  bool operator!=(const basicNeighbourIterator& other) const
+  {
+    return current.id != other.current.id;
+  }
+};
+
+typedef basicNeighbourIterator<index_t, offset_t> neighbourIterator;
+
+/* for (auto e : g.getNeighbors(v)) over a plain or a compressed list */
+template <typename indexT, typename offsetT>
+class basicNeighbourRange
+{
+  private:
+  indexT source;
+  offsetT beginId;
+  offsetT endId;
+  const indexT* plain;
+  const uint8_t* cursor;
+  const int32_t* weights;
+
+  public:
+  basicNeighbourRange(indexT sourceSent, offsetT beginSent, offsetT endSent, const indexT* plainSent,
+                      const uint8_t* cursorSent, const int32_t* weightsSent)
+  {
+    source = sourceSent;
+    beginId = beginSent;
+    endId = endSent;
+    plain = plainSent;
+    cursor = cursorSent;
+    weights = weightsSent;
+  }
+
+  basicNeighbourIterator<indexT, offsetT> begin() const
+  {
+    return basicNeighbourIterator<indexT, offsetT>(source, beginId, endId, plain, cursor, weights);
+  }
+
+  basicNeighbourIterator<indexT, offsetT> end() const
+  {
+    return basicNeighbourIterator<indexT, offsetT>(source, endId, endId, plain, cursor, weights);
+  }
+
+  offsetT size() const
+  {
+    return endId - beginId;
+  }
+};
+
+typedef basicNeighbourRange<index_t, offset_t> neighbourRange;
+
+#endif
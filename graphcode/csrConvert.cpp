@@ -0,0 +1,139 @@
+/* Converts a text edge list ("src dst [weight]" per line, '#' and '%'
+   comment lines) to the binary CSR format of binaryGraph.hpp.
+
+   g++ -O3 -fopenmp -std=c++14 csrConvert.cpp -o csrConvert
+   ./csrConvert [--no-reverse] [--unweighted] [--drop-self-loops] [--dedupe] [--compress] [--verify]
+                sinaweibowt.txt sinaweibowt.spcsr
+
+   Lines without a weight get weight 1. Neighbours are sorted by id. The
+   text is parsed in parallel, see edgeListParser.hpp. --compress stores
+   the forward lists varint coded, see compressedCSR.hpp. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "binaryGraph.hpp"
+#include "edgeListParser.hpp"
+
+using namespace std;
+
+/* the section in the width the header will announce */
+static void* narrowSection(const vector<int64_t>& values, bool wide)
+{
+  if (wide)
+    return (void*)values.data();
+
+  int32_t* narrow = (int32_t*)malloc(values.size() * sizeof(int32_t));
+  for (size_t i = 0; i < values.size(); i++)
+    narrow[i] = (int32_t)values[i];
+  return narrow;
+}
+
+int main(int argc, char* argv[])
+{
+  edgeListOptions options;
+  bool withWeights = true;
+  bool compress = false;
+  bool verify = false;
+  const char* paths[2];
+  int numPaths = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--no-reverse") == 0)
+      options.buildReverse = false;
+    else if (strcmp(argv[i], "--drop-self-loops") == 0)
+      options.dropSelfLoops = true;
+    else if (strcmp(argv[i], "--dedupe") == 0)
+      options.dropDuplicates = true;
+    else if (strcmp(argv[i], "--unweighted") == 0)
+      withWeights = false;
+    else if (strcmp(argv[i], "--compress") == 0)
+      compress = true;
+    else if (strcmp(argv[i], "--verify") == 0)
+      verify = true;
+    else if (numPaths < 2)
+      paths[numPaths++] = argv[i];
+  }
+  if (numPaths != 2)
+  {
+    fprintf(stderr, "usage: %s [--no-reverse] [--unweighted] [--drop-self-loops] [--dedupe] [--compress] [--verify] <edges.txt> <graph.spcsr>\n", argv[0]);
+    return 1;
+  }
+
+  edgeListCSR<int64_t, int64_t> csr;
+  if (!parseEdgeList(paths[0], options, csr))
+  {
+    fprintf(stderr, "%s: cannot open\n", paths[0]);
+    return 1;
+  }
+  bool withReverse = options.buildReverse;
+  int64_t numNodes = csr.numNodes;
+  int64_t numEdges = csr.numEdges;
+
+  uint32_t flags = 0;
+  if (withWeights)
+    flags |= BG_WEIGHTED;
+  if (withReverse)
+    flags |= BG_REVERSE;
+  if (numEdges > INT32_MAX)
+    flags |= BG_OFFSET64;
+  if (numNodes > INT32_MAX)
+    flags |= BG_INDEX64 | BG_OFFSET64;
+  if (compress)
+    flags |= BG_COMPRESSED;
+  bool offset64 = (flags & BG_OFFSET64) != 0;
+  bool index64 = (flags & BG_INDEX64) != 0;
+
+  void* offsets = narrowSection(csr.offsets, offset64);
+  vector<uint64_t> adjacencyIndex;
+  vector<uint8_t> adjacencyBytes;
+  void* adjacency;
+  if (compress)
+  {
+    compressAdjacency(csr.offsets.data(), csr.adjacency.data(), numNodes, adjacencyIndex, adjacencyBytes);
+    adjacency = adjacencyBytes.data();
+  }
+  else
+    adjacency = narrowSection(csr.adjacency, index64);
+  void* revOffsets = withReverse ? narrowSection(csr.revOffsets, offset64) : NULL;
+  void* revAdjacency = withReverse ? narrowSection(csr.revAdjacency, index64) : NULL;
+
+  bool written = writeBinaryGraph(paths[1], flags, numNodes, numEdges, offsets, adjacency,
+                                  withWeights ? csr.weights.data() : NULL, revOffsets, revAdjacency,
+                                  adjacencyIndex.data(), adjacencyBytes.size());
+  if (!offset64)
+  {
+    free(offsets);
+    free(revOffsets);
+  }
+  if (!index64)
+  {
+    if (!compress)
+      free(adjacency);
+    free(revAdjacency);
+  }
+  if (!written)
+  {
+    fprintf(stderr, "%s: write failed\n", paths[1]);
+    return 1;
+  }
+
+  printf("%s: %lld nodes, %lld edges, %d-bit offsets, %d-bit ids%s%s\n", paths[1], (long long)numNodes, (long long)numEdges,
+         offset64 ? 64 : 32, index64 ? 64 : 32, withWeights ? ", weighted" : "", withReverse ? ", reverse CSR" : "");
+  if (compress)
+    printf("adjacency: %llu bytes varint coded, %.2f bytes per edge\n", (unsigned long long)adjacencyBytes.size(),
+           numEdges ? (double)adjacencyBytes.size() / numEdges : 0.0);
+
+  if (verify)
+  {
+    if (!verifyBinaryGraph(paths[1]))
+    {
+      fprintf(stderr, "%s: checksum mismatch\n", paths[1]);
+      return 1;
+    }
+    printf("checksums ok\n");
+  }
+  return 0;
+}
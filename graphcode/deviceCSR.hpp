@@ -0,0 +1,333 @@
+#ifndef DEVICE_CSR_H
+#define DEVICE_CSR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cuda_runtime.h>
+#include "graphIndex.hpp"
+#include "nbrView.hpp"
+
+/* Device side of the CSR that the kernels of dynamic functions read.
+
+   The rows are uploaded in slackCSR's layout: a node's live neighbours
+   come first and sorted, and NBR_DELETED fills the free slots after
+   them. Generated neighbour loops skip that filler the same way outNbrs
+   does. d_edgeIds holds the id of the edge in each slot (ids[slot] on
+   the host), so device code indexes edge props by id, the same as the
+   host. The lookups below binary search a row, since NBR_DELETED sorts
+   after every node id. */
+
+/* first slot of v's row whose neighbour is not below w */
+__device__ inline offset_t deviceLowerBound(const offset_t* d_meta, const index_t* d_data, index_t v, index_t w)
+{
+  offset_t lo = d_meta[v];
+  offset_t hi = d_meta[v + 1];
+  while (lo < hi)
+  {
+    offset_t mid = lo + (hi - lo) / 2;
+    if (d_data[mid] < w)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* id of u->v, or -1 */
+__device__ inline offset_t deviceFindEdge(const offset_t* d_meta, const index_t* d_data, const offset_t* d_edgeIds, index_t u, index_t v)
+{
+  offset_t slot = deviceLowerBound(d_meta, d_data, u, v);
+  if (slot < d_meta[u + 1] && d_data[slot] == v)
+    return d_edgeIds[slot];
+  return -1;
+}
+
+/* u->v with its weight and id; id -1 if there is no such edge */
+__device__ inline csrEdge deviceEdgeAt(const offset_t* d_meta, const index_t* d_data, const int* d_weight, const offset_t* d_edgeIds,
+                                       index_t u, index_t v)
+{
+  csrEdge found = {u, v, 1, -1};
+  offset_t slot = deviceLowerBound(d_meta, d_data, u, v);
+  if (slot < d_meta[u + 1] && d_data[slot] == v)
+  {
+    found.weight = d_weight[slot];
+    found.id = d_edgeIds[slot];
+  }
+  return found;
+}
+
+/* live out-neighbours of v: the slots before the filler */
+__device__ inline offset_t deviceOutDegree(const offset_t* d_meta, const index_t* d_data, index_t v)
+{
+  return deviceLowerBound(d_meta, d_data, v, NBR_DELETED) - d_meta[v];
+}
+
+/* rows closer than this are uploaded as one copy */
+#define DEVICE_CSR_ROW_GAP 64
+
+/* The device CSR of one graph, kept across the Incremental/Decremental
+   calls of a Dynamic function instead of uploaded at every entry.
+
+   sync() brings it to the graph's current layout. When the edges have
+   not moved since the last sync (same edgeLayoutVersion) it does
+   nothing; when slackCSR's change log reaches back to that layout, only
+   the rows it names are copied, with their offsets; otherwise, and when
+   V changes or the slots outgrow the device arrays, everything goes up
+   again. A graph without an id table (version 0) is taken as unchanged
+   while its arrays are the same ones. The arrays get an eighth of
+   headroom so a few batches of growth do not reallocate them.
+
+   Freed by deviceCSRScope when the Dynamic function returns. */
+class deviceCSR
+{
+  public:
+  index_t V;
+  offset_t E;
+  offset_t slots;
+  offset_t revSlots;
+  offset_t* d_meta;
+  index_t* d_data;
+  int* d_weight;
+  offset_t* d_edgeIds;
+  offset_t* d_rev_meta;
+  index_t* d_src;
+  bool* d_modified_next;
+
+  /* uploads done, whole and by rows */
+  long fullUploads;
+  long rowUploads;
+  size_t bytesUploaded;
+
+  private:
+  offset_t nodeCapacity;
+  offset_t slotCapacity;
+  offset_t revCapacity;
+  bool synced;
+  bool withReverse;
+  uint64_t syncedFor;               /* edgeLayoutVersion at the last sync */
+  const void* syncedMeta;           /* arrays synced, for version 0 */
+  const void* syncedList;
+  std::vector<int> hostWeights;     /* ones, for a graph without weights */
+  std::vector<offset_t> hostIds;    /* slot ids, for a graph without an id table */
+
+  template <typename T>
+  void upload(T* device, const T* host, offset_t from, offset_t count)
+  {
+    if (count <= 0)
+      return;
+    cudaMemcpy(device + from, host + from, sizeof(T) * count, cudaMemcpyHostToDevice);
+    bytesUploaded += sizeof(T) * count;
+  }
+
+  template <typename T>
+  static void reallocate(T*& device, offset_t count)
+  {
+    cudaFree(device);
+    cudaMalloc(&device, sizeof(T) * count);
+  }
+
+  /* rows [lo, hi) of the forward or reverse CSR, offsets lo..hi included */
+  template <typename graphT>
+  void uploadRows(graphT& g, index_t lo, index_t hi, bool reverse)
+  {
+    if (reverse)
+    {
+      upload(d_rev_meta, g.rev_indexofNodes, lo, hi - lo + 1);
+      upload(d_src, g.srcList, g.rev_indexofNodes[lo], g.rev_indexofNodes[hi] - g.rev_indexofNodes[lo]);
+      return;
+    }
+    offset_t first = g.indexofNodes[lo];
+    offset_t count = g.indexofNodes[hi] - first;
+    const offset_t* ids = edgeIdsAt((const void*)&g);
+    upload(d_meta, g.indexofNodes, lo, hi - lo + 1);
+    upload(d_data, g.edgeList, first, count);
+    upload(d_weight, g.edgeLen ? (const int*)g.edgeLen : hostWeights.data(), first, count);
+    upload(d_edgeIds, ids ? ids : hostIds.data(), first, count);
+  }
+
+  template <typename graphT>
+  void uploadAll(graphT& g, bool reverse)
+  {
+    if (V + 1 > nodeCapacity)
+    {
+      nodeCapacity = V + 1 + V / 8;
+      reallocate(d_meta, nodeCapacity);
+      reallocate(d_rev_meta, nodeCapacity);
+      reallocate(d_modified_next, nodeCapacity);
+    }
+    if (slots + 1 > slotCapacity)
+    {
+      slotCapacity = slots + 1 + slots / 8;
+      reallocate(d_data, slotCapacity);
+      reallocate(d_weight, slotCapacity);
+      reallocate(d_edgeIds, slotCapacity);
+    }
+    if (revSlots + 1 > revCapacity)
+    {
+      revCapacity = revSlots + 1 + revSlots / 8;
+      reallocate(d_src, revCapacity);
+    }
+
+    uploadRows(g, 0, V, false);
+    if (reverse)
+      uploadRows(g, 0, V, true);
+    else
+      cudaMemset(d_rev_meta, 0, sizeof(offset_t) * (V + 1));
+    withReverse = reverse;
+    fullUploads++;
+  }
+
+  public:
+  deviceCSR()
+  {
+    V = 0;
+    E = slots = revSlots = 0;
+    d_meta = d_edgeIds = d_rev_meta = NULL;
+    d_data = d_src = NULL;
+    d_weight = NULL;
+    d_modified_next = NULL;
+    fullUploads = rowUploads = 0;
+    bytesUploaded = 0;
+    nodeCapacity = 0;
+    slotCapacity = revCapacity = 0;
+    synced = withReverse = false;
+    syncedFor = 0;
+    syncedMeta = syncedList = NULL;
+  }
+
+  ~deviceCSR()
+  {
+    release();
+  }
+
+  deviceCSR(const deviceCSR&) = delete;
+  deviceCSR& operator=(const deviceCSR&) = delete;
+
+  void release()
+  {
+    cudaFree(d_meta);
+    cudaFree(d_data);
+    cudaFree(d_weight);
+    cudaFree(d_edgeIds);
+    cudaFree(d_rev_meta);
+    cudaFree(d_src);
+    cudaFree(d_modified_next);
+    d_meta = d_edgeIds = d_rev_meta = NULL;
+    d_data = d_src = NULL;
+    d_weight = NULL;
+    d_modified_next = NULL;
+    nodeCapacity = 0;
+    slotCapacity = revCapacity = 0;
+    synced = false;
+  }
+
+  /* reverse: the kernels read the in-edges too (d_rev_meta, d_src) */
+  template <typename graphT>
+  void sync(graphT& g, bool reverse)
+  {
+    const void* graphAddress = (const void*)&g;
+    uint64_t version = edgeLayoutVersion(graphAddress);
+    index_t nodes = g.num_nodes();
+    bool sameNodes = synced && nodes == V;
+    E = g.num_edges();
+    if (sameNodes && version == syncedFor && (!reverse || withReverse) &&
+        (version != 0 || (syncedMeta == (const void*)g.indexofNodes && syncedList == (const void*)g.edgeList)))
+      return;
+
+    V = nodes;
+    slots = g.indexofNodes[V];
+    revSlots = reverse ? g.rev_indexofNodes[V] : 0;
+    if (!g.edgeLen && (offset_t)hostWeights.size() < slots)
+      hostWeights.assign(slots + slots / 8 + 1, 1);
+    if (!edgeIdsAt(graphAddress) && (offset_t)hostIds.size() < slots)
+    {
+      hostIds.resize(slots + slots / 8 + 1);
+      for (size_t i = 0; i < hostIds.size(); i++)
+        hostIds[i] = (offset_t)i;
+    }
+
+    std::vector<std::pair<index_t, index_t>> rows[2];
+    bool logged = sameNodes && version != 0 && syncedFor != 0 && (!reverse || withReverse) &&
+                  slots < slotCapacity && revSlots < revCapacity &&
+                  layoutChangesSince(graphAddress, syncedFor, [&](index_t lo, index_t hi, bool rev)
+                  {
+                    rows[rev ? 1 : 0].push_back(std::make_pair(lo, hi));
+                  });
+    if (!logged)
+      uploadAll(g, reverse);
+    else
+    {
+      for (int rev = 0; rev < 2; rev++)
+      {
+        if (rev && !withReverse)
+          continue;
+        std::vector<std::pair<index_t, index_t>>& ranges = rows[rev];
+        std::sort(ranges.begin(), ranges.end());
+        size_t i = 0;
+        while (i < ranges.size())
+        {
+          index_t lo = ranges[i].first;
+          index_t hi = ranges[i].second;
+          for (i++; i < ranges.size() && ranges[i].first <= hi + DEVICE_CSR_ROW_GAP; i++)
+            hi = std::max(hi, ranges[i].second);
+          uploadRows(g, lo, std::min(hi, V), rev != 0);
+          rowUploads++;
+        }
+      }
+    }
+    synced = true;
+    syncedFor = version;
+    syncedMeta = (const void*)g.indexofNodes;
+    syncedList = (const void*)g.edgeList;
+  }
+};
+
+/* the device CSR of a graph, made on first use and kept for its address */
+inline deviceCSR& deviceCSRAt(const void* graphAddress)
+{
+  static std::mutex registryGuard;
+  static std::map<const void*, deviceCSR*> registry;
+  std::lock_guard<std::mutex> hold(registryGuard);
+  deviceCSR*& csr = registry[graphAddress];
+  if (csr == NULL)
+    csr = new deviceCSR();
+  return *csr;
+}
+
+template <typename graphT>
+inline deviceCSR& deviceCSRFor(const graphT& g)
+{
+  return deviceCSRAt((const void*)&g);
+}
+
+/* declared in the Dynamic function: frees the graph's device CSR when it
+   returns, and prints the upload counts if STARPLAT_DEVICE_STATS is set */
+class deviceCSRScope
+{
+  private:
+  deviceCSR& csr;
+
+  public:
+  template <typename graphT>
+  explicit deviceCSRScope(const graphT& g) : csr(deviceCSRFor(g))
+  {
+  }
+
+  ~deviceCSRScope()
+  {
+    if (getenv("STARPLAT_DEVICE_STATS") != NULL)
+      fprintf(stderr, "deviceCSR: %ld full uploads, %ld row uploads, %.1f MB\n", csr.fullUploads, csr.rowUploads,
+              csr.bytesUploaded / 1048576.0);
+    csr.release();
+  }
+
+  deviceCSRScope(const deviceCSRScope&) = delete;
+  deviceCSRScope& operator=(const deviceCSRScope&) = delete;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef DEVICE_PROP_H
+#define DEVICE_PROP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cuda_runtime.h>
+#include "epochProp.hpp"
+#include "bitProp.hpp"
+
+/* Kernel side of epochProp and bitProp.
+
+   A prop that a kernel of a dynamic function reads or writes is declared
+   with deviceShared, so its arrays are CUDA managed memory, and the
+   kernel gets deviceView(prop) in place of a plain d_prop array. The view
+   is a few pointers and the current epoch, passed by value, and keeps the
+   host's rules: a slot last set in an older epoch reads as the
+   initializer and is re-initialised by the first thread that takes a
+   reference to it, and bits are set and cleared atomically. Host code and
+   kernels never run on the same prop at once (the launch is followed by
+   cudaDeviceSynchronize), so reset() on the host stays an epoch bump, or
+   a device-side fill for bitProp.
+
+   The tag claim spins while another thread holds the busy bit, which
+   needs the independent thread scheduling of sm_70 and later. */
+
+template <typename T>
+struct epochView
+{
+  T* values;
+  uint16_t* tags;
+  uint16_t epoch;
+  T initVal;
+
+  static const uint16_t busyBit = 0x8000;
+
+  /* tags are claimed with a 32-bit CAS on the word holding them */
+  __device__ inline unsigned int* tagWord(size_t i) const
+  {
+    return (unsigned int*)((uintptr_t)(tags + i) & ~(uintptr_t)3);
+  }
+
+  __device__ inline unsigned int tagShift(size_t i) const
+  {
+    return ((uintptr_t)(tags + i) & 2) ? 16 : 0;
+  }
+
+  __device__ inline void touch(size_t i) const
+  {
+    unsigned int* word = tagWord(i);
+    unsigned int shift = tagShift(i);
+    while (true)
+    {
+      unsigned int seen = *(volatile unsigned int*)word;
+      uint16_t tag = (uint16_t)(seen >> shift);
+      if (tag == epoch)
+      {
+        __threadfence();
+        return;
+      }
+      if (tag & busyBit)
+        continue;
+      unsigned int claimed = (seen & ~(0xffffu << shift)) | ((unsigned int)(epoch | busyBit) << shift);
+      if (atomicCAS(word, seen, claimed) == seen)
+      {
+        values[i] = initVal;
+        __threadfence();
+        atomicAnd(word, ~((unsigned int)busyBit << shift));
+        return;
+      }
+    }
+  }
+
+  __device__ inline T& operator[](size_t i) const
+  {
+    touch(i);
+    return values[i];
+  }
+
+  /* read without claiming; a slot being re-initialised reads as initVal */
+  __device__ inline T get(size_t i) const
+  {
+    if (((volatile uint16_t*)tags)[i] == epoch)
+    {
+      __threadfence();
+      return ((volatile T*)values)[i];
+    }
+    return initVal;
+  }
+};
+
+struct bitView
+{
+  unsigned long long* words;
+
+  __device__ inline bool test(size_t i) const
+  {
+    return (((volatile unsigned long long*)words)[i >> 6] >> (i & 63)) & 1;
+  }
+
+  __device__ inline void set(size_t i) const
+  {
+    atomicOr(words + (i >> 6), 1ULL << (i & 63));
+  }
+
+  __device__ inline void clear(size_t i) const
+  {
+    atomicAnd(words + (i >> 6), ~(1ULL << (i & 63)));
+  }
+
+  /* d_prop[i] = true / if (d_prop[i]) in generated kernels */
+  struct reference
+  {
+    unsigned long long* words;
+    size_t index;
+
+    __device__ inline operator bool() const
+    {
+      bitView view = {words};
+      return view.test(index);
+    }
+
+    __device__ inline reference& operator=(bool value)
+    {
+      bitView view = {words};
+      if (value)
+        view.set(index);
+      else
+        view.clear(index);
+      return *this;
+    }
+  };
+
+  __device__ inline reference operator[](size_t i) const
+  {
+    reference r = {words, i};
+    return r;
+  }
+};
+
+template <typename T>
+inline epochView<T> deviceView(epochProp<T>& prop)
+{
+  epochView<T> view;
+  view.values = prop.valueData();
+  view.tags = prop.tagData();
+  view.epoch = prop.currentEpoch();
+  view.initVal = prop.initValue();
+  return view;
+}
+
+inline bitView deviceView(bitProp& prop)
+{
+  bitView view;
+  view.words = (unsigned long long*)prop.wordData();
+  return view;
+}
+
+#endif
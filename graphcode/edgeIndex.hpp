@@ -0,0 +1,390 @@
+#ifndef EDGE_INDEX_H
+#define EDGE_INDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "graphIndex.hpp"
+#include "nbrView.hpp"
+
+/* Edge lookup: (u, v) -> the id of edge u->v, or -1. The id is the slot
+   in edgeList unless the graph registered an edge id table (nbrView.hpp).
+
+   Rows are sorted, with NBR_DELETED (which sorts last) in any free slots,
+   so findEdgeSlot binary searches the row. findEdge also looks in the diff
+   CSR when the graph has one, and is what the generated code calls for
+   is_an_edge; edgeAt hands out the whole edge (csrEdge) for get_edge.
+
+   edgeIndex adds an open addressing table per node of degree at least
+   hubDegree, so probes into hub rows cost O(1) instead of a search over
+   thousands of entries, and findBatch for many probes from one source,
+   which merges sorted probes against the row in one pass. The tables hold
+   slots, so they are brought up to date after the CSR changes: refresh()
+   redoes only the hub tables of rows the graph logged as changed
+   (layoutChangesSince in nbrView.hpp), rebuild() all of them.
+
+   An edgeIndex is shared while it lives: findEdge and edgeAt on its graph
+   go through it, as long as it was built for the graph's current layout
+   (edgeLayoutVersion). A stale index is passed over, so lookups never see
+   edges that moved; the generated batch code refreshes it after every
+   updateCSRAdd/updateCSRDel. */
+
+#define EDGE_INDEX_HUB_DEGREE 512
+#define EDGE_MAX_INDEXES 8
+
+static inline offset_t findEdgeSlot(const offset_t* offsets, const index_t* adjacency, index_t u, index_t v)
+{
+  const index_t* first = adjacency + offsets[u];
+  const index_t* last = adjacency + offsets[u + 1];
+  const index_t* at = std::lower_bound(first, last, v);
+  return (at != last && *at == v) ? (offset_t)(at - adjacency) : -1;
+}
+
+/* u->v in the diff CSR as a csrEdge, id -1 if absent; diff edges are
+   numbered after the primary ones as in nbrView */
+template <typename graphT>
+inline csrEdge findDiffEdge(graphT& g, index_t u, index_t v)
+{
+  csrEdge found = {u, v, 1, -1};
+  if (g.diff_edgeList == NULL)
+    return found;
+  offset_t slot = findEdgeSlot(g.diff_indexofNodes, g.diff_edgeList, u, v);
+  if (slot < 0)
+    return found;
+  found.weight = g.diff_edgeLen ? g.diff_edgeLen[slot] : 1;
+  found.id = g.num_edges() + slot;
+  return found;
+}
+
+template <typename graphT>
+inline csrEdge edgeAtSlot(graphT& g, index_t u, index_t v, offset_t slot)
+{
+  if (slot < 0)
+    return findDiffEdge(g, u, v);
+  csrEdge found = {u, v, g.edgeLen ? g.edgeLen[slot] : 1, edgeIdOf(g, slot)};
+  return found;
+}
+
+struct edgeIndexEntry
+{
+  const void* graph;
+  const void* index;
+};
+
+/* set outside parallel regions, as the edge id tables */
+inline edgeIndexEntry* edgeIndexEntries()
+{
+  static edgeIndexEntry entries[EDGE_MAX_INDEXES];
+  return entries;
+}
+
+inline const void* edgeIndexAt(const void* graphAddress)
+{
+  edgeIndexEntry* entries = edgeIndexEntries();
+  for (int i = 0; i < EDGE_MAX_INDEXES; i++)
+  {
+    if (entries[i].graph == graphAddress)
+      return entries[i].index;
+  }
+  return NULL;
+}
+
+/* index NULL drops the graph's entry if it is still `previous` */
+inline void setEdgeIndex(const void* graphAddress, const void* index, const void* previous = NULL)
+{
+  edgeIndexEntry* entries = edgeIndexEntries();
+  int unused = -1;
+  for (int i = 0; i < EDGE_MAX_INDEXES; i++)
+  {
+    if (entries[i].graph == graphAddress)
+    {
+      if (index == NULL && entries[i].index != previous)
+        return;
+      entries[i].graph = index ? graphAddress : NULL;
+      entries[i].index = index;
+      return;
+    }
+    if (unused < 0 && entries[i].graph == NULL)
+      unused = i;
+  }
+  if (index == NULL)
+    return;
+  if (unused < 0)
+  {
+    fprintf(stderr, "setEdgeIndex: more than %d graphs with an edge index\n", EDGE_MAX_INDEXES);
+    abort();
+  }
+  entries[unused].graph = graphAddress;
+  entries[unused].index = index;
+}
+
+template <typename graphT>
+class edgeIndex
+{
+  private:
+  graphT& g;
+  offset_t hubDegree;
+  uint64_t builtFor;                 /* edgeLayoutVersion at rebuild */
+  std::vector<offset_t> tableAt;     /* per node, start of its table or -1 */
+  std::vector<offset_t> tableSize;   /* power of two */
+  std::vector<index_t> keys;         /* NBR_DELETED marks an empty cell */
+  std::vector<offset_t> slotOf;
+  offset_t abandoned;                /* cells of tables replaced by refresh */
+
+  static inline uint32_t hashNode(index_t v)
+  {
+    return (uint32_t)v * 2654435761u;
+  }
+
+  /* table size for a row of degree slots, 0 if the row gets no table */
+  offset_t sizeFor(offset_t degree) const
+  {
+    if (degree < hubDegree)
+      return 0;
+    offset_t size = 1;
+    while (size < 2 * degree)
+      size <<= 1;
+    return size;
+  }
+
+  /* writes v's live neighbours into its (empty) table */
+  void fill(index_t v)
+  {
+    offset_t mask = tableSize[v] - 1;
+    for (offset_t e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+    {
+      index_t nbr = g.edgeList[e];
+      if (nbr == NBR_DELETED)
+        continue;
+      offset_t cell = hashNode(nbr) & mask;
+      while (keys[tableAt[v] + cell] != NBR_DELETED)
+        cell = (cell + 1) & mask;
+      keys[tableAt[v] + cell] = nbr;
+      slotOf[tableAt[v] + cell] = e;
+    }
+  }
+
+  /* slot of u->v in the primary CSR, or -1 */
+  offset_t findSlot(index_t u, index_t v) const
+  {
+    if (tableAt[u] < 0)
+      return findEdgeSlot(g.indexofNodes, g.edgeList, u, v);
+
+    offset_t mask = tableSize[u] - 1;
+    const index_t* table = keys.data() + tableAt[u];
+    for (offset_t cell = hashNode(v) & mask;; cell = (cell + 1) & mask)
+    {
+      if (table[cell] == v)
+        return slotOf[tableAt[u] + cell];
+      if (table[cell] == NBR_DELETED)
+        return -1;
+    }
+  }
+
+  public:
+  edgeIndex(graphT& graphSent, offset_t hubDegreeSent = EDGE_INDEX_HUB_DEGREE) : g(graphSent)
+  {
+    hubDegree = hubDegreeSent;
+    rebuild();
+    setEdgeIndex((const void*)&g, this);
+  }
+
+  ~edgeIndex()
+  {
+    setEdgeIndex((const void*)&g, NULL, this);
+  }
+
+  edgeIndex(const edgeIndex&) = delete;
+  edgeIndex& operator=(const edgeIndex&) = delete;
+
+  void rebuild()
+  {
+    index_t V = g.num_nodes();
+    builtFor = edgeLayoutVersion((const void*)&g);
+    tableAt.assign(V, -1);
+    tableSize.assign(V, 0);
+    offset_t cells = 0;
+    for (index_t v = 0; v < V; v++)
+    {
+      offset_t size = sizeFor(g.indexofNodes[v + 1] - g.indexofNodes[v]);
+      if (size == 0)
+        continue;
+      tableAt[v] = cells;
+      tableSize[v] = size;
+      cells += size;
+    }
+    keys.assign(cells, NBR_DELETED);
+    slotOf.assign(cells, -1);
+    abandoned = 0;
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (index_t v = 0; v < V; v++)
+    {
+      if (tableAt[v] >= 0)
+        fill(v);
+    }
+  }
+
+  /* Up to date with the graph's layout at the cost of the rows that
+     changed since the last build: their tables are cleared and refilled,
+     moved to the end when they outgrew their cells. Falls back to
+     rebuild() when the graph keeps no log that far back, or once the
+     tables replaced take up as many cells as the live ones. */
+  void refresh()
+  {
+    if (current())
+      return;
+
+    std::vector<std::pair<index_t, index_t> > ranges;
+    bool logged = layoutChangesSince((const void*)&g, builtFor, [&](index_t lo, index_t hi, bool reverse)
+    {
+      if (!reverse)
+        ranges.push_back(std::make_pair(lo, hi));
+    });
+    if (!logged)
+    {
+      rebuild();
+      return;
+    }
+
+    std::vector<index_t> rows;
+    for (const std::pair<index_t, index_t>& r : ranges)
+    {
+      for (index_t v = r.first; v < r.second; v++)
+        rows.push_back(v);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    /* serial pass: place the tables, so the fills below are disjoint */
+    std::vector<index_t> hubs;
+    for (index_t v : rows)
+    {
+      offset_t size = sizeFor(g.indexofNodes[v + 1] - g.indexofNodes[v]);
+      if (size == 0 || size > tableSize[v])
+      {
+        abandoned += tableSize[v];
+        tableAt[v] = -1;
+        tableSize[v] = 0;
+        if (size == 0)
+          continue;
+        tableAt[v] = keys.size();
+        tableSize[v] = size;
+        keys.resize(keys.size() + size, NBR_DELETED);
+        slotOf.resize(slotOf.size() + size, -1);
+      }
+      hubs.push_back(v);
+    }
+    if (abandoned > (offset_t)keys.size() / 2)
+    {
+      rebuild();
+      return;
+    }
+
+    builtFor = edgeLayoutVersion((const void*)&g);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < hubs.size(); i++)
+    {
+      index_t v = hubs[i];
+      std::fill(keys.begin() + tableAt[v], keys.begin() + tableAt[v] + tableSize[v], NBR_DELETED);
+      fill(v);
+    }
+  }
+
+  /* built for the graph's current layout */
+  bool current() const
+  {
+    return builtFor == edgeLayoutVersion((const void*)&g);
+  }
+
+  bool isHub(index_t u) const
+  {
+    return tableAt[u] >= 0;
+  }
+
+  offset_t find(index_t u, index_t v) const
+  {
+    offset_t slot = findSlot(u, v);
+    if (slot >= 0)
+      return edgeIdOf(g, slot);
+    return findDiffEdge(g, u, v).id;
+  }
+
+  csrEdge edge(index_t u, index_t v) const
+  {
+    return edgeAtSlot(g, u, v, findSlot(u, v));
+  }
+
+  bool contains(index_t u, index_t v) const
+  {
+    return find(u, v) >= 0;
+  }
+
+  /* found[i] = find(u, probes[i]) for count probes sharing the source u.
+     Probes in ascending order (another node's row, say) are matched in one
+     galloping pass over u's row, O(count log(degree / count)). */
+  void findBatch(index_t u, const index_t* probes, int64_t count, offset_t* found, bool sorted = false) const
+  {
+    if (!sorted || isHub(u) || g.diff_edgeList != NULL)
+    {
+      for (int64_t i = 0; i < count; i++)
+        found[i] = find(u, probes[i]);
+      return;
+    }
+
+    const offset_t* ids = edgeIdsAt((const void*)&g);
+    const index_t* row = g.edgeList;
+    offset_t e = g.indexofNodes[u];
+    offset_t end = g.indexofNodes[u + 1];
+    for (int64_t i = 0; i < count; i++)
+    {
+      offset_t step = 1;
+      offset_t lo = e;
+      while (e + step < end && row[e + step] < probes[i])
+      {
+        lo = e + step;
+        step <<= 1;
+      }
+      e = std::lower_bound(row + lo, row + std::min(e + step + 1, end), probes[i]) - row;
+      if (e < end && row[e] == probes[i])
+        found[i] = ids ? ids[e] : e;
+      else
+        found[i] = -1;
+    }
+  }
+};
+
+/* the graph's shared edgeIndex if it is current, else NULL */
+template <typename graphT>
+inline const edgeIndex<graphT>* currentEdgeIndex(graphT& g)
+{
+  const edgeIndex<graphT>* index = (const edgeIndex<graphT>*)edgeIndexAt((const void*)&g);
+  return (index != NULL && index->current()) ? index : NULL;
+}
+
+/* id of u->v, or -1 */
+template <typename graphT>
+inline offset_t findEdge(graphT& g, index_t u, index_t v)
+{
+  const edgeIndex<graphT>* index = currentEdgeIndex(g);
+  if (index != NULL)
+    return index->find(u, v);
+  offset_t slot = findEdgeSlot(g.indexofNodes, g.edgeList, u, v);
+  if (slot >= 0)
+    return edgeIdOf(g, slot);
+  return findDiffEdge(g, u, v).id;
+}
+
+/* u->v with its weight and id; id -1 if g has no such edge */
+template <typename graphT>
+inline csrEdge edgeAt(graphT& g, index_t u, index_t v)
+{
+  const edgeIndex<graphT>* index = currentEdgeIndex(g);
+  if (index != NULL)
+    return index->edge(u, v);
+  return edgeAtSlot(g, u, v, findEdgeSlot(g.indexofNodes, g.edgeList, u, v));
+}
+
+#endif
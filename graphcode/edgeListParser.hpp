@@ -0,0 +1,362 @@
+#ifndef EDGE_LIST_PARSER_H
+#define EDGE_LIST_PARSER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "graphIndex.hpp"
+
+/* Parallel loader for "src dst [weight]" text edge lists ('#' and '%'
+   start comment lines, a missing weight reads as 1).
+
+   The mapped file is cut into one byte range per thread, each range moved
+   forward to the next line start, and parsed with a plain digit loop.
+   The CSR is then built with a parallel counting sort on the source:
+   atomic per-node counts, a blocked prefix sum, and an atomic scatter
+   followed by sorting each node's list. Self loops and parallel edges are
+   kept unless the options drop them. offT/idxT are the offset and node id
+   types of the CSR being built (offset_t/index_t for a loader, int64_t
+   for the converter). */
+
+struct edgeListOptions
+{
+  bool dropSelfLoops;
+  bool dropDuplicates;
+  bool buildReverse;
+
+  edgeListOptions()
+  {
+    dropSelfLoops = false;
+    dropDuplicates = false;
+    buildReverse = true;
+  }
+};
+
+template <typename offT, typename idxT>
+struct edgeListCSR
+{
+  int64_t numNodes;
+  int64_t numEdges;
+  std::vector<offT> offsets;
+  std::vector<idxT> adjacency;
+  std::vector<int32_t> weights;
+  std::vector<offT> revOffsets;
+  std::vector<idxT> revAdjacency;
+};
+
+struct parsedEdge
+{
+  int64_t src;
+  int64_t dst;
+  int32_t weight;
+};
+
+static inline const char* skipBlanks(const char* p, const char* end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == ','))
+    p++;
+  return p;
+}
+
+/* returns NULL if there is no number at p */
+static inline const char* parseInteger(const char* p, const char* end, int64_t& value)
+{
+  bool negative = false;
+  if (p < end && *p == '-')
+  {
+    negative = true;
+    p++;
+  }
+  if (p >= end || (unsigned)(*p - '0') > 9)
+    return NULL;
+
+  int64_t v = 0;
+  while (p < end && (unsigned)(*p - '0') <= 9)
+  {
+    v = v * 10 + (*p - '0');
+    p++;
+  }
+  value = negative ? -v : v;
+  return p;
+}
+
+static inline const char* nextLine(const char* p, const char* end)
+{
+  while (p < end && *p != '\n')
+    p++;
+  return p < end ? p + 1 : end;
+}
+
+static void parseEdgeRange(const char* p, const char* end, bool dropSelfLoops, std::vector<parsedEdge>& edges, int64_t& maxId)
+{
+  while (p < end)
+  {
+    const char* lineEnd = nextLine(p, end);
+    p = skipBlanks(p, lineEnd);
+    if (p >= lineEnd || *p == '#' || *p == '%' || *p == '\n')
+    {
+      p = lineEnd;
+      continue;
+    }
+
+    parsedEdge e;
+    int64_t weight = 1;
+    const char* q = parseInteger(p, lineEnd, e.src);
+    if (q != NULL)
+      q = parseInteger(skipBlanks(q, lineEnd), lineEnd, e.dst);
+    if (q != NULL && e.src >= 0 && e.dst >= 0)
+    {
+      parseInteger(skipBlanks(q, lineEnd), lineEnd, weight);
+      e.weight = (int32_t)weight;
+      if (!(dropSelfLoops && e.src == e.dst))
+        edges.push_back(e);
+      maxId = std::max(maxId, std::max(e.src, e.dst));
+    }
+    p = lineEnd;
+  }
+}
+
+/* exclusive prefix sum over counts[0..n), in place, result in counts[n] */
+template <typename offT>
+static void blockedPrefixSum(offT* counts, int64_t n)
+{
+  int numThreads = omp_get_max_threads();
+  std::vector<offT> blockSums(numThreads + 1, 0);
+
+  #pragma omp parallel num_threads(numThreads)
+  {
+    int t = omp_get_thread_num();
+    int64_t lo = n * t / numThreads;
+    int64_t hi = n * (t + 1) / numThreads;
+    offT sum = 0;
+    for (int64_t i = lo; i < hi; i++)
+      sum += counts[i];
+    blockSums[t + 1] = sum;
+
+    #pragma omp barrier
+    #pragma omp single
+    for (int b = 0; b < numThreads; b++)
+      blockSums[b + 1] += blockSums[b];
+
+    offT running = blockSums[t];
+    for (int64_t i = lo; i < hi; i++)
+    {
+      offT c = counts[i];
+      counts[i] = running;
+      running += c;
+    }
+  }
+  counts[n] = blockSums[numThreads];
+}
+
+/* one CSR (forward keyed on src, reverse on dst) from the parsed edges */
+template <typename offT, typename idxT>
+static void countingSortCSR(const std::vector<parsedEdge>& edges, int64_t numNodes, bool reverse, bool withWeights,
+                            bool dropDuplicates, std::vector<offT>& offsets, std::vector<idxT>& adjacency,
+                            std::vector<int32_t>& weights)
+{
+  int64_t numEdges = edges.size();
+  offsets.assign(numNodes + 1, 0);
+  offT* counts = offsets.data();
+
+  #pragma omp parallel for
+  for (int64_t i = 0; i < numEdges; i++)
+    __atomic_fetch_add(&counts[reverse ? edges[i].dst : edges[i].src], 1, __ATOMIC_RELAXED);
+  blockedPrefixSum(counts, numNodes);
+
+  std::vector<offT> cursor(offsets.begin(), offsets.end() - 1);
+  std::vector<std::pair<idxT, int32_t> > slots(numEdges);
+  #pragma omp parallel for
+  for (int64_t i = 0; i < numEdges; i++)
+  {
+    const parsedEdge& e = edges[i];
+    offT at = __atomic_fetch_add(&cursor[reverse ? e.dst : e.src], 1, __ATOMIC_RELAXED);
+    slots[at] = std::make_pair((idxT)(reverse ? e.src : e.dst), e.weight);
+  }
+
+  /* sorted lists; with dropDuplicates the first (lowest weight) copy of
+     a parallel edge stays */
+  std::vector<offT> kept(numNodes + 1, 0);
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+  {
+    std::sort(slots.begin() + offsets[v], slots.begin() + offsets[v + 1]);
+    offT length = offsets[v + 1] - offsets[v];
+    if (dropDuplicates && length > 0)
+    {
+      offT unique = 1;
+      for (offT i = offsets[v] + 1; i < offsets[v + 1]; i++)
+      {
+        if (slots[i].first != slots[offsets[v] + unique - 1].first)
+          slots[offsets[v] + unique++] = slots[i];
+      }
+      length = unique;
+    }
+    kept[v] = length;
+  }
+
+  std::vector<offT> source;
+  if (dropDuplicates)
+  {
+    source = offsets;
+    blockedPrefixSum(kept.data(), numNodes);
+    offsets.swap(kept);
+  }
+  const std::vector<offT>& from = dropDuplicates ? source : offsets;
+
+  adjacency.resize(offsets[numNodes]);
+  if (withWeights)
+    weights.resize(offsets[numNodes]);
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+  {
+    offT out = offsets[v];
+    for (offT i = from[v]; i < from[v] + (offsets[v + 1] - offsets[v]); i++, out++)
+    {
+      adjacency[out] = slots[i].first;
+      if (withWeights)
+        weights[out] = slots[i].second;
+    }
+  }
+}
+
+/* Returns false if the file cannot be read or holds more nodes or edges
+   than idxT/offT can count. An empty file gives an empty CSR. */
+template <typename offT, typename idxT>
+static bool parseEdgeList(const char* path, const edgeListOptions& options, edgeListCSR<offT, idxT>& csr)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    return false;
+  }
+
+  size_t bytes = info.st_size;
+  if (bytes == 0)
+  {
+    close(fd);
+    csr.numNodes = 0;
+    csr.numEdges = 0;
+    csr.offsets.assign(1, 0);
+    csr.adjacency.clear();
+    csr.weights.clear();
+    csr.revOffsets.assign(options.buildReverse ? 1 : 0, 0);
+    csr.revAdjacency.clear();
+    return true;
+  }
+
+  const char* text = (const char*)mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == (const char*)MAP_FAILED)
+    return false;
+  madvise((void*)text, bytes, MADV_SEQUENTIAL);
+
+  int numThreads = omp_get_max_threads();
+  std::vector<std::vector<parsedEdge> > chunks(numThreads);
+  std::vector<int64_t> chunkMax(numThreads, -1);
+
+  #pragma omp parallel num_threads(numThreads)
+  {
+    int t = omp_get_thread_num();
+    const char* end = text + bytes;
+    const char* lo = text + bytes * t / numThreads;
+    const char* hi = text + bytes * (t + 1) / numThreads;
+    /* a range owns the lines that start inside it; with fewer bytes than
+       threads several ranges can start at the first byte */
+    if (lo > text && lo[-1] != '\n')
+      lo = nextLine(lo, end);
+    if (hi < end && hi > text && hi[-1] != '\n')
+      hi = nextLine(hi, end);
+    if (lo < hi)
+    {
+      chunks[t].reserve((hi - lo) / 12);
+      parseEdgeRange(lo, hi, options.dropSelfLoops, chunks[t], chunkMax[t]);
+    }
+  }
+  munmap((void*)text, bytes);
+
+  std::vector<int64_t> chunkAt(numThreads + 1, 0);
+  int64_t maxId = -1;
+  for (int t = 0; t < numThreads; t++)
+  {
+    chunkAt[t + 1] = chunkAt[t] + chunks[t].size();
+    maxId = std::max(maxId, chunkMax[t]);
+  }
+
+  std::vector<parsedEdge> edges(chunkAt[numThreads]);
+  #pragma omp parallel for schedule(static, 1)
+  for (int t = 0; t < numThreads; t++)
+  {
+    std::copy(chunks[t].begin(), chunks[t].end(), edges.begin() + chunkAt[t]);
+    std::vector<parsedEdge>().swap(chunks[t]);
+  }
+
+  if (maxId >= (int64_t)std::numeric_limits<idxT>::max() || chunkAt[numThreads] > (int64_t)std::numeric_limits<offT>::max())
+  {
+    fprintf(stderr, "%s: %lld nodes, %lld edges do not fit the CSR index types\n", path, (long long)(maxId + 1),
+            (long long)chunkAt[numThreads]);
+    return false;
+  }
+
+  csr.numNodes = maxId + 1;
+  countingSortCSR(edges, csr.numNodes, false, true, options.dropDuplicates, csr.offsets, csr.adjacency, csr.weights);
+  if (options.buildReverse)
+  {
+    std::vector<int32_t> unused;
+    countingSortCSR(edges, csr.numNodes, true, false, options.dropDuplicates, csr.revOffsets, csr.revAdjacency, unused);
+  }
+  csr.numEdges = csr.offsets[csr.numNodes];
+  return true;
+}
+
+template <typename T>
+static T* edgeListArray(const std::vector<T>& from)
+{
+  T* to = (T*)malloc(std::max<size_t>(from.size(), 1) * sizeof(T));
+  #pragma omp parallel for
+  for (int64_t i = 0; i < (int64_t)from.size(); i++)
+    to[i] = from[i];
+  return to;
+}
+
+/* The text path of the graph constructor: graph::parseGraph hands its file
+   here instead of reading it line by line, and gets indexofNodes, edgeList,
+   edgeLen, rev_indexofNodes and srcList back as malloc'd arrays (graph.hpp
+   frees them), with nodesTotal and edgesTotal set. Exits if the file cannot
+   be read or does not fit this build's index_t/offset_t. */
+template <typename graphT>
+static void loadEdgeListGraph(graphT& g, const char* path, const edgeListOptions& options = edgeListOptions())
+{
+  edgeListCSR<offset_t, index_t> csr;
+  if (!parseEdgeList(path, options, csr))
+  {
+    fprintf(stderr, "%s: cannot load edge list\n", path);
+    exit(1);
+  }
+  requireGraphIndexFits(csr.numNodes, csr.numEdges, path);
+
+  g.nodesTotal = csr.numNodes;
+  g.edgesTotal = csr.numEdges;
+  g.indexofNodes = edgeListArray(csr.offsets);
+  g.edgeList = edgeListArray(csr.adjacency);
+  g.edgeLen = edgeListArray(csr.weights);
+  if (options.buildReverse)
+  {
+    g.rev_indexofNodes = edgeListArray(csr.revOffsets);
+    g.srcList = edgeListArray(csr.revAdjacency);
+  }
+}
+
+#endif
@@ -0,0 +1,167 @@
+/* Self-test of edgeListParser.hpp on the inputs whose line cutting is
+   easy to get wrong: empty files, files with only comments, a last line
+   without '\n', and files shorter than the number of threads.
+
+   g++ -O3 -fopenmp -std=c++14 edgeListTest.cpp -o edgeListTest
+   ./edgeListTest [--threads t]
+
+   Every case is parsed with 1 thread and with t (at least 8), and the
+   CSR must match the one given with the case. A generated file of a few
+   thousand lines, with comments, CRLF endings and no final newline, is
+   also parsed at every thread count from 1 to t and compared with the
+   single-threaded result. Exits 1 on any failure. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include <string>
+#include <vector>
+#include "edgeListParser.hpp"
+
+using namespace std;
+
+typedef edgeListCSR<int64_t, int64_t> testCSR;
+
+struct parserCase
+{
+  const char* name;
+  const char* text;
+  vector<int64_t> offsets;
+  vector<int64_t> adjacency;
+  vector<int32_t> weights;
+};
+
+static string writeTemp(const string& text)
+{
+  char path[] = "/tmp/edgeListTestXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size())
+  {
+    fprintf(stderr, "cannot write %s\n", path);
+    exit(1);
+  }
+  close(fd);
+  return path;
+}
+
+static bool parseWith(const string& path, int threads, testCSR& csr)
+{
+  omp_set_num_threads(threads);
+  edgeListOptions options;
+  return parseEdgeList(path.c_str(), options, csr);
+}
+
+static bool sameCSR(const testCSR& a, const testCSR& b)
+{
+  return a.numNodes == b.numNodes && a.numEdges == b.numEdges && a.offsets == b.offsets &&
+         a.adjacency == b.adjacency && a.weights == b.weights && a.revOffsets == b.revOffsets &&
+         a.revAdjacency == b.revAdjacency;
+}
+
+static bool checkCase(const parserCase& c, int threads)
+{
+  string path = writeTemp(c.text);
+  bool ok = true;
+  for (int t : {1, threads})
+  {
+    testCSR csr;
+    bool parsed = parseWith(path, t, csr);
+    bool match = parsed && csr.offsets == c.offsets && csr.adjacency == c.adjacency && csr.weights == c.weights &&
+                 csr.numNodes == (int64_t)c.offsets.size() - 1 && csr.numEdges == (int64_t)c.adjacency.size() &&
+                 csr.revOffsets.size() == c.offsets.size();
+    printf("%-20s %2d threads  %s\n", c.name, t, match ? "ok" : "FAILED");
+    ok = ok && match;
+  }
+  unlink(path.c_str());
+  return ok;
+}
+
+/* lines of every shape the parser accepts, in a file too long for one range */
+static string mixedText(int lines)
+{
+  string text;
+  unsigned x = 1;
+  for (int i = 0; i < lines; i++)
+  {
+    x = x * 1103515245 + 12345;
+    unsigned r = x >> 8;
+    char line[64];
+    switch (r % 6)
+    {
+      case 0:
+        snprintf(line, sizeof(line), "# comment %d\n", i);
+        break;
+      case 1:
+        snprintf(line, sizeof(line), "%u %u %u\r\n", r % 997, (r / 997) % 997, r % 50);
+        break;
+      case 2:
+        snprintf(line, sizeof(line), "%u,%u\n", r % 997, (r / 997) % 997);
+        break;
+      case 3:
+        snprintf(line, sizeof(line), "\t%u\t%u\t-%u\n", r % 997, (r / 997) % 997, r % 7);
+        break;
+      case 4:
+        snprintf(line, sizeof(line), "\n");
+        break;
+      default:
+        snprintf(line, sizeof(line), "%u %u\n", r % 997, (r / 997) % 997);
+        break;
+    }
+    text += line;
+  }
+  text += "996 0 5";
+  return text;
+}
+
+int main(int argc, char* argv[])
+{
+  int threads = omp_get_max_threads() < 8 ? 8 : omp_get_max_threads();
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--threads t]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (threads < 2)
+  {
+    fprintf(stderr, "%s: --threads must be at least 2\n", argv[0]);
+    return 1;
+  }
+
+  vector<parserCase> cases = {
+    {"empty", "", {0}, {}, {}},
+    {"comments only", "# a\n% b\n\n#c", {0}, {}, {}},
+    {"no final newline", "0 1 4\n1 2", {0, 1, 2, 2}, {1, 2}, {4, 1}},
+    {"single short line", "1 0", {0, 0, 1}, {0}, {1}},
+    {"comment last", "2 0 3\n0 2\n# end", {0, 1, 1, 2}, {2, 0}, {1, 3}},
+  };
+
+  int failures = 0;
+  for (const parserCase& c : cases)
+    failures += !checkCase(c, threads);
+
+  string path = writeTemp(mixedText(20000));
+  testCSR serial;
+  if (!parseWith(path, 1, serial) || serial.numEdges == 0)
+    failures++;
+  for (int t = 2; t <= threads; t++)
+  {
+    testCSR parallel;
+    if (!parseWith(path, t, parallel) || !sameCSR(serial, parallel))
+    {
+      printf("mixed lines          %2d threads  FAILED\n", t);
+      failures++;
+    }
+  }
+  printf("mixed lines          1..%d threads, %lld edges\n", threads, (long long)serial.numEdges);
+  unlink(path.c_str());
+
+  printf(failures ? "%d failures\n" : "all passed\n", failures);
+  return failures ? 1 : 0;
+}
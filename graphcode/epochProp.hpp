@@ -0,0 +1,226 @@
+#ifndef EPOCH_PROP_H
+#define EPOCH_PROP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include "numaAlloc.hpp"
+#include "propPool.hpp"
+
+/* Property array with an O(1) reset.
+
+   Every slot carries the epoch in which it was last initialised. reset()
+   only bumps the current epoch, so a slot written in an older epoch is
+   brought back to the initializer lazily the first time it is touched.
+   The generator uses this for attachNodeProperty/attachEdgeProperty calls
+   that sit inside a loop (per source in BC, per batch in dynamic codes),
+   where a full V or E sized write on every iteration would dominate.
+
+   The lazy re-initialisation is safe under concurrent access: the first
+   thread to touch a stale slot claims it by setting the busy bit of its tag,
+   writes the initializer and publishes the new epoch. Others spin on the
+   (short) busy window.
+
+   Built with deviceShared, the arrays come from the pool's CUDA managed
+   buffers, so kernels use the same slots through deviceView (deviceProp.hpp)
+   and reset() stays an epoch bump for them too. */
+
+template <typename T>
+class epochProp
+{
+  private:
+  static const uint16_t busyBit = 0x8000;
+  static const uint16_t maxEpoch = 0x7fff;
+
+  T* values;
+  std::atomic<uint16_t>* tags;
+  size_t length;
+  uint16_t epoch;
+  T initVal;
+  propPool* pool;           /* the graph's pool, or NULL to map directly */
+  bool deviceShared;        /* managed buffers kernels also read */
+
+  void allocate(size_t n)
+  {
+    /* values are first written lazily, by whichever thread touches the
+       slot, so they are placed up front with the static partition */
+    if (pool != NULL)
+    {
+      values = (T*)pool->acquire(n * sizeof(T), deviceShared);
+      tags = (std::atomic<uint16_t>*)pool->acquire(n * sizeof(std::atomic<uint16_t>), deviceShared);
+    }
+    else
+    {
+      values = numaAlloc<T>(n, T());
+      tags = (std::atomic<uint16_t>*)numaMap(n * sizeof(std::atomic<uint16_t>), numaDefaultPolicy());
+    }
+    length = n;
+    clearTags();
+  }
+
+  void release()
+  {
+    if (pool != NULL)
+    {
+      pool->release(values, length * sizeof(T), deviceShared);
+      pool->release(tags, length * sizeof(std::atomic<uint16_t>), deviceShared);
+    }
+    else
+    {
+      numaFree(values, length);
+      numaFree(tags, length);
+    }
+    values = NULL;
+    tags = NULL;
+    length = 0;
+  }
+
+  /* tag 0 is never a live epoch, so this marks every slot stale */
+  void clearTags()
+  {
+#ifdef __CUDACC__
+    if (deviceShared)
+    {
+      cudaMemset(tags, 0, length * sizeof(std::atomic<uint16_t>));
+      cudaDeviceSynchronize();
+      return;
+    }
+#endif
+    #pragma omp parallel for schedule(static)
+    for (long i = 0; i < (long)length; i++)
+      tags[i].store(0, std::memory_order_relaxed);
+  }
+
+  inline void touch(size_t i)
+  {
+    uint16_t tag = tags[i].load(std::memory_order_acquire);
+    while (tag != epoch)
+    {
+      if (tag & busyBit)
+      {
+        tag = tags[i].load(std::memory_order_acquire);
+        continue;
+      }
+      if (tags[i].compare_exchange_weak(tag, (uint16_t)(epoch | busyBit), std::memory_order_acquire))
+      {
+        values[i] = initVal;
+        tags[i].store(epoch, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+  public:
+  epochProp()
+  {
+    values = NULL;
+    tags = NULL;
+    length = 0;
+    epoch = 1;
+    initVal = T();
+    pool = NULL;
+    deviceShared = false;
+  }
+
+  explicit epochProp(size_t n)
+  {
+    epoch = 1;
+    initVal = T();
+    pool = NULL;
+    deviceShared = false;
+    allocate(n);
+  }
+
+  /* storage from the graph's pool (propPoolFor(g)), returned to it here;
+     deviceShared for a prop kernels read or write */
+  explicit epochProp(propPool& graphPool, bool deviceSharedSent = false)
+  {
+    values = NULL;
+    tags = NULL;
+    length = 0;
+    epoch = 1;
+    initVal = T();
+    pool = &graphPool;
+    deviceShared = deviceSharedSent;
+  }
+
+  ~epochProp()
+  {
+    release();
+  }
+
+  epochProp(const epochProp&) = delete;
+  epochProp& operator=(const epochProp&) = delete;
+
+  /* equivalent of attach*Property(prop = init) over n elements. The
+     storage only grows, so the amortised cost stays O(1) even when the
+     graph grows between batches. */
+  void reset(const T& init, size_t n)
+  {
+    initVal = init;
+    if (n > length)
+    {
+      release();
+      allocate(n);
+      epoch = 1;
+      return;
+    }
+    if (epoch == maxEpoch)
+    {
+      clearTags();
+      epoch = 1;
+    }
+    else
+      epoch++;
+  }
+
+  inline T& operator[](size_t i)
+  {
+    touch(i);
+    return values[i];
+  }
+
+  /* read without claiming the slot */
+  inline T get(size_t i) const
+  {
+    return tags[i].load(std::memory_order_acquire) == epoch ? values[i] : initVal;
+  }
+
+  /* writes the initializer into every stale slot and hands out the plain
+     array, for callers that need a raw pointer */
+  T* materialize()
+  {
+    #pragma omp parallel for
+    for (long i = 0; i < (long)length; i++)
+      touch(i);
+    return values;
+  }
+
+  size_t size() const
+  {
+    return length;
+  }
+
+  /* what deviceView hands to kernels */
+  T* valueData()
+  {
+    return values;
+  }
+
+  uint16_t* tagData()
+  {
+    return (uint16_t*)tags;
+  }
+
+  uint16_t currentEpoch() const
+  {
+    return epoch;
+  }
+
+  const T& initValue() const
+  {
+    return initVal;
+  }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef GRAPH_INDEX_H
+#define GRAPH_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits>
+
+/* Widths of the CSR arrays.
+
+   index_t holds a node id (adjacency, src lists), offset_t a position in
+   the edge arrays (indexofNodes, rev_indexofNodes). Both are 32 bit unless
+   the build asks otherwise:
+
+     -DGRAPH_OFFSET_64   more than 2^31 - 1 edges, node ids stay 32 bit
+     -DGRAPH_INDEX_64    more than 2^31 - 1 nodes as well (implies offsets)
+
+   A 7B edge crawl with fewer than 2^31 nodes only needs GRAPH_OFFSET_64,
+   which keeps the adjacency array at 4 bytes per edge.
+
+   Code that is a template over the widths instead picks them at run time
+   from the graph header with dispatchGraphWidths, the same way
+   dispatchPropWidths (propWidth.hpp) picks property widths:
+
+     dispatchGraphWidths(V, E, [&](auto widths) {
+       run<typename decltype(widths)::index_t,
+           typename decltype(widths)::offset_t>(...);
+     });
+
+   Graphs that fit take the 32-bit instance, so the wide code is only paid
+   for by the graphs that need it. withMappedGraph (binaryGraph.hpp) loads
+   a binary graph file this way in any build. */
+
+#ifdef GRAPH_INDEX_64
+#ifndef GRAPH_OFFSET_64
+#define GRAPH_OFFSET_64
+#endif
+typedef int64_t index_t;
+#define INDEX_FMT "%" PRId64
+#else
+typedef int32_t index_t;
+#define INDEX_FMT "%" PRId32
+#endif
+
+#ifdef GRAPH_OFFSET_64
+typedef int64_t offset_t;
+#define OFFSET_FMT "%" PRId64
+#else
+typedef int32_t offset_t;
+#define OFFSET_FMT "%" PRId32
+#endif
+
+inline bool graphIndexFits(long long V, long long E)
+{
+  /* a negative count means it already wrapped on the way in */
+  if (V < 0 || E < 0)
+    return false;
+  if (V > (long long)INT32_MAX && sizeof(index_t) < 8)
+    return false;
+  if (E > (long long)INT32_MAX && sizeof(offset_t) < 8)
+    return false;
+  return true;
+}
+
+template <typename indexT, typename offsetT>
+struct graphWidths
+{
+  typedef indexT index_t;
+  typedef offsetT offset_t;
+};
+
+template <typename indexT, typename offsetT>
+inline bool graphWidthsFit(long long V, long long E)
+{
+  if (V < 0 || E < 0)
+    return false;
+  return V <= (long long)std::numeric_limits<indexT>::max() && E <= (long long)std::numeric_limits<offsetT>::max();
+}
+
+/* wide ids imply wide offsets, as with the build flags */
+template <typename Body>
+inline void dispatchGraphWidthFlags(bool wideIndex, bool wideOffset, Body body)
+{
+  if (wideIndex)
+    body(graphWidths<int64_t, int64_t>());
+  else if (wideOffset)
+    body(graphWidths<int32_t, int64_t>());
+  else
+    body(graphWidths<int32_t, int32_t>());
+}
+
+/* the narrowest widths that hold V nodes and E edges */
+template <typename Body>
+inline void dispatchGraphWidths(long long V, long long E, Body body)
+{
+  dispatchGraphWidthFlags(!graphWidthsFit<int32_t, int64_t>(V, 0), !graphWidthsFit<int32_t, int32_t>(0, E), body);
+}
+
+/* Called once the graph size is known (file header, loader). Exits rather
+   than letting node ids or offsets wrap. */
+inline void requireGraphIndexFits(long long V, long long E, const char* source)
+{
+  if (graphIndexFits(V, E))
+    return;
+
+  fprintf(stderr, "%s: %lld nodes, %lld edges do not fit this build's index types (%d-bit ids, %d-bit offsets).\n",
+          source, V, E, (int)(8 * sizeof(index_t)), (int)(8 * sizeof(offset_t)));
+  if (V > (long long)INT32_MAX)
+    fprintf(stderr, "Rebuild with -DGRAPH_INDEX_64, or load a binary graph with withMappedGraph.\n");
+  else
+    fprintf(stderr, "Rebuild with -DGRAPH_OFFSET_64, or load a binary graph with withMappedGraph.\n");
+  exit(1);
+}
+
+#endif
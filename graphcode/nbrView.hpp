@@ -0,0 +1,346 @@
+#ifndef NBR_VIEW_H
+#define NBR_VIEW_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "graphIndex.hpp"
+#include "compressedCSR.hpp"
+
+/* Neighbour views over the CSR and the diff CSR of a dynamic graph.
+
+   graph.hpp's getNeighbors/getInNeighbors/getInOutNbrs build a
+   vector<edge> for every call, which puts a heap allocation in the inner
+   loop of every dynamic algorithm. outNbrs/inNbrs/inOutNbrs walk the same
+   arrays in the same order and hand out csrEdge values by value, so
+
+     for (auto v_edge : outNbrs(g, v))
+
+   allocates nothing. A range is up to four array slices (primary and diff,
+   forward and reverse); slots holding NBR_DELETED are skipped, as
+   getNeighbors does. Diff edges are numbered after the primary ones. In
+   edges carry no weight: destination is the in-neighbour, as in
+   getInNeighbors.
+
+   An edge's id is its slot unless the graph has an edge id table: a graph
+   laid out by slackCSR.hpp moves edges between slots and registers
+   ids[slot] there, so edge props stay with their edges. */
+
+#define NBR_DELETED (INT_MAX / 2)
+#define NBR_MAX_SEGMENTS 4
+#define NBR_MAX_ID_TABLES 8
+
+/* the node range [lo, hi) of the forward or reverse CSR had its slots
+   rewritten on the way to layout `version` */
+struct layoutChange
+{
+  uint64_t version;
+  index_t lo;
+  index_t hi;
+  bool reverse;
+};
+
+/* Kept by a store that moves edges (slackCSR) for its last few layouts,
+   so structures kept per row (hub tables, a device copy) refresh only the
+   rows that changed. Every change after layout `oldest` is in it. */
+struct layoutChangeLog
+{
+  uint64_t oldest;
+  std::vector<layoutChange> changes;
+};
+
+struct edgeIdTable
+{
+  const void* graph;
+  const offset_t* ids;
+  uint64_t version;         /* fresh on every setEdgeIds */
+  const layoutChangeLog* log;
+};
+
+/* a handful of graphs at most; set outside parallel regions */
+inline edgeIdTable* edgeIdTables()
+{
+  static edgeIdTable tables[NBR_MAX_ID_TABLES];
+  return tables;
+}
+
+inline const offset_t* edgeIdsAt(const void* graphAddress)
+{
+  edgeIdTable* tables = edgeIdTables();
+  for (int i = 0; i < NBR_MAX_ID_TABLES; i++)
+  {
+    if (tables[i].graph == graphAddress)
+      return tables[i].ids;
+  }
+  return NULL;
+}
+
+/* changes whenever the graph's edges move (setEdgeIds); 0 for a graph
+   without a table. Lets a lookup structure tell it was built for an
+   older layout. */
+inline uint64_t edgeLayoutVersion(const void* graphAddress)
+{
+  edgeIdTable* tables = edgeIdTables();
+  for (int i = 0; i < NBR_MAX_ID_TABLES; i++)
+  {
+    if (tables[i].graph == graphAddress)
+      return tables[i].version;
+  }
+  return 0;
+}
+
+/* Calls visit(lo, hi, reverse) for every node range whose slots changed
+   after layout `since`. False, without calling it, if the graph keeps no
+   log reaching back that far; everything has to be taken as changed then. */
+template <typename Visit>
+inline bool layoutChangesSince(const void* graphAddress, uint64_t since, Visit visit)
+{
+  edgeIdTable* tables = edgeIdTables();
+  for (int i = 0; i < NBR_MAX_ID_TABLES; i++)
+  {
+    if (tables[i].graph != graphAddress)
+      continue;
+    const layoutChangeLog* log = tables[i].log;
+    if (log == NULL || since == 0 || since < log->oldest)
+      return false;
+    for (const layoutChange& c : log->changes)
+    {
+      if (c.version > since)
+        visit(c.lo, c.hi, c.reverse);
+    }
+    return true;
+  }
+  return false;
+}
+
+/* ids NULL drops the graph's table. Returns the new layout version. */
+inline uint64_t setEdgeIds(const void* graphAddress, const offset_t* ids, const layoutChangeLog* log = NULL)
+{
+  static uint64_t lastVersion = 0;
+  edgeIdTable* tables = edgeIdTables();
+  int unused = -1;
+  for (int i = 0; i < NBR_MAX_ID_TABLES; i++)
+  {
+    if (tables[i].graph == graphAddress)
+    {
+      tables[i].graph = ids ? graphAddress : NULL;
+      tables[i].ids = ids;
+      tables[i].version = ids ? ++lastVersion : 0;
+      tables[i].log = ids ? log : NULL;
+      return tables[i].version;
+    }
+    if (unused < 0 && tables[i].graph == NULL)
+      unused = i;
+  }
+  if (ids == NULL)
+    return 0;
+  if (unused < 0)
+  {
+    fprintf(stderr, "setEdgeIds: more than %d graphs with moving edges\n", NBR_MAX_ID_TABLES);
+    abort();
+  }
+  tables[unused].graph = graphAddress;
+  tables[unused].ids = ids;
+  tables[unused].version = ++lastVersion;
+  tables[unused].log = log;
+  return tables[unused].version;
+}
+
+template <typename graphT>
+inline offset_t edgeIdOf(const graphT& g, offset_t slot)
+{
+  const offset_t* ids = edgeIdsAt((const void*)&g);
+  return ids ? ids[slot] : slot;
+}
+
+struct nbrSegment
+{
+  const index_t* list;
+  const int32_t* weights;   /* NULL reads as weight 1 */
+  const offset_t* ids;      /* NULL numbers edges idBase + slot */
+  offset_t begin;
+  offset_t end;
+  offset_t idBase;
+};
+
+class nbrIterator
+{
+  private:
+  const nbrSegment* segments;
+  int numSegments;
+  int seg;
+  offset_t pos;
+  csrEdge current;
+
+  /* moves to the first live slot at or after (seg, pos) */
+  inline void settle()
+  {
+    while (seg < numSegments)
+    {
+      const nbrSegment& s = segments[seg];
+      for (; pos < s.end; pos++)
+      {
+        if (s.list[pos] != NBR_DELETED)
+        {
+          current.destination = s.list[pos];
+          current.weight = s.weights ? s.weights[pos] : 1;
+          current.id = s.ids ? s.ids[pos] : s.idBase + pos;
+          return;
+        }
+      }
+      if (++seg < numSegments)
+        pos = segments[seg].begin;
+    }
+    pos = 0;
+  }
+
+  public:
+  nbrIterator(index_t source, const nbrSegment* segmentsSent, int numSent, bool atEnd)
+  {
+    segments = segmentsSent;
+    numSegments = numSent;
+    current.source = source;
+    if (atEnd || numSegments == 0)
+    {
+      seg = numSegments;
+      pos = 0;
+      return;
+    }
+    seg = 0;
+    pos = segments[0].begin;
+    settle();
+  }
+
+  const csrEdge& operator*() const
+  {
+    return current;
+  }
+
+  const csrEdge* operator->() const
+  {
+    return &current;
+  }
+
+  inline nbrIterator& operator++()
+  {
+    pos++;
+    settle();
+    return *this;
+  }
+
+  bool operator!=(const nbrIterator& other) const
+  {
+    return seg != other.seg || pos != other.pos;
+  }
+};
+
+class nbrRange
+{
+  private:
+  index_t source;
+  int numSegments;
+  nbrSegment segments[NBR_MAX_SEGMENTS];
+
+  public:
+  nbrRange(index_t sourceSent)
+  {
+    source = sourceSent;
+    numSegments = 0;
+  }
+
+  void add(const index_t* list, const int32_t* weights, offset_t begin, offset_t end, offset_t idBase, const offset_t* ids = NULL)
+  {
+    if (begin >= end)
+      return;
+    nbrSegment& s = segments[numSegments++];
+    s.list = list;
+    s.weights = weights;
+    s.ids = ids;
+    s.begin = begin;
+    s.end = end;
+    s.idBase = idBase;
+  }
+
+  nbrIterator begin() const
+  {
+    return nbrIterator(source, segments, numSegments, false);
+  }
+
+  nbrIterator end() const
+  {
+    return nbrIterator(source, segments, numSegments, true);
+  }
+
+  /* slots, deleted ones included */
+  offset_t slots() const
+  {
+    offset_t n = 0;
+    for (int i = 0; i < numSegments; i++)
+      n += segments[i].end - segments[i].begin;
+    return n;
+  }
+};
+
+/* The adapters read graph.hpp's arrays directly and mirror its
+   getNeighbors layout; keep them in step with it. */
+
+template <typename graphT>
+inline void addOutSegments(nbrRange& r, graphT& g, index_t v)
+{
+  r.add(g.edgeList, g.edgeLen, g.indexofNodes[v], g.indexofNodes[v + 1], 0, edgeIdsAt((const void*)&g));
+  if (g.diff_edgeList != NULL)
+    r.add(g.diff_edgeList, g.diff_edgeLen, g.diff_indexofNodes[v], g.diff_indexofNodes[v + 1], g.num_edges());
+}
+
+template <typename graphT>
+inline void addInSegments(nbrRange& r, graphT& g, index_t v)
+{
+  r.add(g.srcList, NULL, g.rev_indexofNodes[v], g.rev_indexofNodes[v + 1], 0);
+  if (g.diff_rev_edgeList != NULL)
+    r.add(g.diff_rev_edgeList, NULL, g.diff_rev_indexofNodes[v], g.diff_rev_indexofNodes[v + 1], g.num_edges());
+}
+
+/* live out-neighbours of v; with slack or deleted slots in the rows this
+   is not indexofNodes[v + 1] - indexofNodes[v] */
+template <typename graphT>
+inline offset_t outDegree(graphT& g, index_t v)
+{
+  offset_t live = 0;
+  for (offset_t e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+    live += g.edgeList[e] != NBR_DELETED;
+  if (g.diff_edgeList != NULL)
+  {
+    for (offset_t e = g.diff_indexofNodes[v]; e < g.diff_indexofNodes[v + 1]; e++)
+      live += g.diff_edgeList[e] != NBR_DELETED;
+  }
+  return live;
+}
+
+template <typename graphT>
+inline nbrRange outNbrs(graphT& g, index_t v)
+{
+  nbrRange r(v);
+  addOutSegments(r, g, v);
+  return r;
+}
+
+template <typename graphT>
+inline nbrRange inNbrs(graphT& g, index_t v)
+{
+  nbrRange r(v);
+  addInSegments(r, g, v);
+  return r;
+}
+
+template <typename graphT>
+inline nbrRange inOutNbrs(graphT& g, index_t v)
+{
+  nbrRange r(v);
+  addOutSegments(r, g, v);
+  addInSegments(r, g, v);
+  return r;
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef NUMA_ALLOC_H
+#define NUMA_ALLOC_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Page placement for V- and E-sized arrays on multi-socket machines.
+
+   Linux puts a page on the node of the thread that first writes it. With
+   malloc and a serial initialisation everything lands on one socket and
+   the other socket's threads read it remotely. numaAlloc maps the array
+   and writes it once with the partition the compute loops use, so each
+   thread's part is local:
+
+     node arrays   #pragma omp parallel for (schedule(static)) over V,
+                   the generated forall schedule
+     edge arrays   the edges of the same node blocks (numaAllocEdges)
+
+   STARPLAT_NUMA=interleave spreads pages round robin over all nodes
+   instead (for arrays every thread reads everywhere, or when the loops do
+   not partition statically), STARPLAT_NUMA=off gives plain malloc
+   placement and pages. Interleaving uses the mbind system call directly
+   so no libnuma is needed; on a one-node machine all policies behave
+   alike.
+
+   Arrays of 2MB and more are also backed by huge pages, since random
+   gathers from V-sized properties miss the TLB on nearly every access
+   with 4KB pages. STARPLAT_HUGEPAGES picks how:
+
+     thp        (default) 2MB aligned mapping with MADV_HUGEPAGE, which
+                the kernel honours unless THP is set to never
+     hugetlb    MAP_HUGETLB from the reserved pool (vm.nr_hugepages),
+                falling back to thp when the pool runs out
+     off        4KB pages */
+
+enum numaPolicy
+{
+  NUMA_FIRST_TOUCH,
+  NUMA_INTERLEAVE,
+  NUMA_OFF
+};
+
+static inline numaPolicy numaDefaultPolicy()
+{
+  static int policy = -1;
+  if (policy < 0)
+  {
+    const char* knob = getenv("STARPLAT_NUMA");
+    if (knob != NULL && strcmp(knob, "interleave") == 0)
+      policy = NUMA_INTERLEAVE;
+    else if (knob != NULL && strcmp(knob, "off") == 0)
+      policy = NUMA_OFF;
+    else
+      policy = NUMA_FIRST_TOUCH;
+  }
+  return (numaPolicy)policy;
+}
+
+#define HUGE_PAGE_BYTES ((size_t)2 << 20)
+
+enum hugePagePolicy
+{
+  HUGE_PAGES_THP,
+  HUGE_PAGES_HUGETLB,
+  HUGE_PAGES_OFF
+};
+
+static inline hugePagePolicy hugePageDefaultPolicy()
+{
+  static int policy = -1;
+  if (policy < 0)
+  {
+    const char* knob = getenv("STARPLAT_HUGEPAGES");
+    if (knob != NULL && strcmp(knob, "hugetlb") == 0)
+      policy = HUGE_PAGES_HUGETLB;
+    else if (knob != NULL && strcmp(knob, "off") == 0)
+      policy = HUGE_PAGES_OFF;
+    else
+      policy = HUGE_PAGES_THP;
+  }
+  return (hugePagePolicy)policy;
+}
+
+/* the length of the mapping behind bytes; arrays of a huge page or more
+   are rounded to whole huge pages whatever the policy, so numaFree does
+   not need to know how the array was mapped */
+static inline size_t numaMappedBytes(size_t bytes)
+{
+  size_t page = bytes >= HUGE_PAGE_BYTES ? HUGE_PAGE_BYTES : (size_t)sysconf(_SC_PAGESIZE);
+  return (bytes + page - 1) / page * page;
+}
+
+/* a mapping of length bytes starting on a huge page boundary */
+static inline void* mapHugeAligned(size_t length)
+{
+  size_t padded = length + HUGE_PAGE_BYTES;
+  char* raw = (char*)mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return NULL;
+  char* aligned = (char*)(((uintptr_t)raw + HUGE_PAGE_BYTES - 1) & ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+  if (aligned > raw)
+    munmap(raw, aligned - raw);
+  munmap(aligned + length, raw + padded - (aligned + length));
+  return aligned;
+}
+
+/* MPOL_INTERLEAVE over every node the kernel reports; false if not NUMA */
+static inline bool numaInterleave(void* p, size_t bytes)
+{
+#ifdef SYS_mbind
+  unsigned long mask[16];
+  memset(mask, 0xff, sizeof(mask));
+  const int mpolInterleave = 3;
+  return syscall(SYS_mbind, p, bytes, mpolInterleave, mask, sizeof(mask) * 8, 0) == 0;
+#else
+  (void)p;
+  (void)bytes;
+  return false;
+#endif
+}
+
+/* untouched memory for bytes; nothing is placed until it is written */
+static inline void* numaMap(size_t bytes, numaPolicy policy, hugePagePolicy pages = hugePageDefaultPolicy())
+{
+  if (policy == NUMA_OFF)
+    return malloc(bytes ? bytes : 1);
+  size_t length = numaMappedBytes(bytes ? bytes : 1);
+  void* p = NULL;
+  if (length < HUGE_PAGE_BYTES || pages == HUGE_PAGES_OFF)
+  {
+    p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      return NULL;
+  }
+  else
+  {
+#ifdef MAP_HUGETLB
+    if (pages == HUGE_PAGES_HUGETLB)
+    {
+      p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p == MAP_FAILED)
+        p = NULL;
+    }
+#endif
+    if (p == NULL)
+    {
+      p = mapHugeAligned(length);
+      if (p == NULL)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+      madvise(p, length, MADV_HUGEPAGE);
+#endif
+    }
+  }
+  if (policy == NUMA_INTERLEAVE)
+    numaInterleave(p, length);
+  return p;
+}
+
+/* n elements set to init, each thread writing the block of a static
+   schedule over n */
+template <typename T>
+T* numaAlloc(size_t n, const T& init = T(), numaPolicy policy = numaDefaultPolicy(),
+             hugePagePolicy pages = hugePageDefaultPolicy())
+{
+  T* p = (T*)numaMap(n * sizeof(T), policy, pages);
+  if (p == NULL)
+    return NULL;
+  if (policy == NUMA_OFF)
+  {
+    for (size_t i = 0; i < n; i++)
+      p[i] = init;
+    return p;
+  }
+  #pragma omp parallel for schedule(static)
+  for (long i = 0; i < (long)n; i++)
+    p[i] = init;
+  return p;
+}
+
+/* an edge array for offsets[0..numNodes]: each thread writes the edges of
+   the nodes a static schedule over numNodes gives it */
+template <typename T, typename offT>
+T* numaAllocEdges(const offT* offsets, long numNodes, const T& init = T(), numaPolicy policy = numaDefaultPolicy(),
+                  hugePagePolicy pages = hugePageDefaultPolicy())
+{
+  size_t n = offsets[numNodes];
+  T* p = (T*)numaMap(n * sizeof(T), policy, pages);
+  if (p == NULL)
+    return NULL;
+  if (policy == NUMA_OFF)
+  {
+    for (size_t i = 0; i < n; i++)
+      p[i] = init;
+    return p;
+  }
+  #pragma omp parallel for schedule(static)
+  for (long v = 0; v < numNodes; v++)
+  {
+    for (offT e = offsets[v]; e < offsets[v + 1]; e++)
+      p[e] = init;
+  }
+  return p;
+}
+
+template <typename T>
+void numaFree(T* p, size_t n, numaPolicy policy = numaDefaultPolicy())
+{
+  if (p == NULL)
+    return;
+  if (policy == NUMA_OFF)
+    free((void*)p);
+  else
+    munmap((void*)p, numaMappedBytes(n ? n * sizeof(T) : 1));
+}
+
+#endif
@@ -0,0 +1,366 @@
+/* Page placement and page size of the CSR and property arrays under the
+   policies of numaAlloc.hpp, and what they do to a pull kernel.
+
+   g++ -O3 -fopenmp -std=c++14 numaBench.cpp -o numaBench
+   OMP_PROC_BIND=spread OMP_PLACES=cores ./numaBench [--pages] [--nodes N] [--degree d] [--iters k]
+
+   It builds the same random graph under each policy, runs k PageRank
+   style pull sweeps with a static schedule and reports the time and the
+   dTLB load misses per sweep (perf_event_open; "n/a" where the kernel or
+   perf_event_paranoid does not allow it). Per array it reports the share
+   of pages on the socket of the thread whose block they hold (queried
+   with move_pages, so no libnuma is needed) and the share of the mapping
+   backed by huge pages (/proc/self/smaps).
+
+   By default the NUMA policies are compared (off: malloc and a serial
+   initialisation, which is what the arrays got before; first-touch;
+   interleave). The gather from rank[] is remote for every other socket
+   whatever the policy, the streamed arrays (offsets, edges, next) are
+   what first-touch makes local. Threads have to be pinned for the numbers
+   to mean much. --pages compares 4KB pages, THP and hugetlb under
+   first-touch instead; there the gather is what huge pages speed up. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <omp.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#include <vector>
+#include <algorithm>
+#include "numaAlloc.hpp"
+
+using namespace std;
+
+static int countNumaNodes()
+{
+  DIR* dir = opendir("/sys/devices/system/node");
+  if (dir == NULL)
+    return 1;
+  int nodes = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+    if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+      nodes++;
+  closedir(dir);
+  return nodes > 0 ? nodes : 1;
+}
+
+static int currentNode()
+{
+  unsigned cpu = 0, node = 0;
+#ifdef SYS_getcpu
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    return -1;
+  return (int)node;
+#else
+  return -1;
+#endif
+}
+
+static uint32_t mix(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return (uint32_t)x;
+}
+
+/* dTLB load misses of the OpenMP threads; one counter per thread since
+   the pool exists before the counters are opened */
+class tlbCounter
+{
+  private:
+  vector<int> fds;
+
+  public:
+  tlbCounter()
+  {
+    fds.assign(omp_get_max_threads(), -1);
+    #pragma omp parallel
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.size = sizeof(attr);
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds[omp_get_thread_num()] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+
+  ~tlbCounter()
+  {
+    for (int fd : fds)
+      if (fd >= 0)
+        close(fd);
+  }
+
+  bool available() const
+  {
+    for (int fd : fds)
+      if (fd < 0)
+        return false;
+    return true;
+  }
+
+  void start()
+  {
+    for (int fd : fds)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  long long stop()
+  {
+    long long total = 0;
+    for (int fd : fds)
+    {
+      long long count = 0;
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count))
+        total += count;
+    }
+    return total;
+  }
+};
+
+/* share of the mapping holding p that is backed by huge pages, -1 if
+   smaps cannot tell */
+static double hugePageShare(const void* p)
+{
+  FILE* smaps = fopen("/proc/self/smaps", "r");
+  if (smaps == NULL)
+    return -1;
+  char line[512];
+  bool inside = false;
+  long rss = 0, huge = 0;
+  while (fgets(line, sizeof(line), smaps))
+  {
+    unsigned long lo, hi;
+    if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2 && strchr(line, ':') != NULL && strchr(line, '-') < strchr(line, ' '))
+    {
+      if (inside)
+        break;
+      inside = (uintptr_t)p >= lo && (uintptr_t)p < hi;
+      continue;
+    }
+    if (!inside)
+      continue;
+    long kb;
+    if (sscanf(line, "Rss: %ld kB", &kb) == 1)
+      rss += kb;
+    else if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+      huge += kb;
+    else if (sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1 || sscanf(line, "Shared_Hugetlb: %ld kB", &kb) == 1)
+    {
+      huge += kb;
+      rss += kb;
+    }
+  }
+  fclose(smaps);
+  return rss > 0 ? (double)huge / rss : -1;
+}
+
+struct placement
+{
+  long local;
+  long remote;
+  long absent;
+};
+
+/* pages of an array of n elements whose thread t owns the elements from
+   ownerStart[t], checked against threadNode[t] */
+static placement pagePlacement(const void* base, size_t n, size_t elemBytes, const vector<int64_t>& ownerStart,
+                               const vector<int>& threadNode)
+{
+  placement result = {0, 0, 0};
+#ifdef SYS_move_pages
+  size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t first = (uintptr_t)base / page * page;
+  uintptr_t last = (uintptr_t)base + n * elemBytes;
+  const size_t batch = 4096;
+  vector<void*> pages(batch);
+  vector<int> status(batch);
+  vector<int> expected(batch);
+
+  for (uintptr_t at = first; at < last;)
+  {
+    size_t count = 0;
+    for (; count < batch && at < last; count++, at += page)
+    {
+      int64_t element = at < (uintptr_t)base ? 0 : (int64_t)((at - (uintptr_t)base) / elemBytes);
+      int owner = upper_bound(ownerStart.begin(), ownerStart.end(), element) - ownerStart.begin() - 1;
+      pages[count] = (void*)at;
+      expected[count] = threadNode[max(owner, 0)];
+    }
+    if (syscall(SYS_move_pages, 0, count, pages.data(), NULL, status.data(), 0) != 0)
+    {
+      result.absent += count;
+      continue;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+      if (status[i] < 0)
+        result.absent++;
+      else if (status[i] == expected[i])
+        result.local++;
+      else
+        result.remote++;
+    }
+  }
+#else
+  (void)base;
+  (void)n;
+  (void)elemBytes;
+  (void)ownerStart;
+  (void)threadNode;
+#endif
+  return result;
+}
+
+static void printPlacement(const char* name, const void* array, placement p)
+{
+  long total = p.local + p.remote + p.absent;
+  printf("  %-8s %10ld pages  %5.1f%% local  %5.1f%% remote", name, total, total ? 100.0 * p.local / total : 0.0,
+         total ? 100.0 * p.remote / total : 0.0);
+  double huge = hugePageShare(array);
+  if (huge >= 0)
+    printf("  %5.1f%% huge", 100.0 * huge);
+  if (p.absent)
+    printf("  (%ld not queried)", p.absent);
+  printf("\n");
+}
+
+static void runPolicy(numaPolicy policy, hugePagePolicy pages, const char* name, int64_t numNodes, int degree, int iters)
+{
+  double start = omp_get_wtime();
+  int64_t* offsets = numaAlloc<int64_t>(numNodes + 1, 0, policy, pages);
+  offsets[0] = 0;
+  for (int64_t v = 0; v < numNodes; v++)
+    offsets[v + 1] = offsets[v] + 1 + mix(v) % (2 * degree - 1);
+  int64_t numEdges = offsets[numNodes];
+
+  int32_t* edges = numaAllocEdges<int32_t>(offsets, numNodes, 0, policy, pages);
+  float* rank = numaAlloc<float>(numNodes, 1.0f / numNodes, policy, pages);
+  float* next = numaAlloc<float>(numNodes, 0.0f, policy, pages);
+  if (offsets == NULL || edges == NULL || rank == NULL || next == NULL)
+  {
+    fprintf(stderr, "%s: allocation failed\n", name);
+    exit(1);
+  }
+
+  #pragma omp parallel for schedule(static)
+  for (int64_t v = 0; v < numNodes; v++)
+  {
+    for (int64_t e = offsets[v]; e < offsets[v + 1]; e++)
+      edges[e] = mix(((uint64_t)v << 20) ^ e) % numNodes;
+  }
+  double setup = omp_get_wtime() - start;
+
+  tlbCounter tlb;
+  tlb.start();
+  start = omp_get_wtime();
+  for (int it = 0; it < iters; it++)
+  {
+    #pragma omp parallel for schedule(static)
+    for (int64_t v = 0; v < numNodes; v++)
+    {
+      float sum = 0;
+      for (int64_t e = offsets[v]; e < offsets[v + 1]; e++)
+        sum += rank[edges[e]];
+      next[v] = 0.15f / numNodes + 0.85f * sum / (offsets[v + 1] - offsets[v]);
+    }
+    swap(rank, next);
+  }
+  double sweep = (omp_get_wtime() - start) / iters;
+  long long tlbMisses = tlb.stop();
+
+  /* each thread's block of the sweep above, and the node it runs on */
+  int numThreads = omp_get_max_threads();
+  vector<int64_t> nodeStart(numThreads, numNodes);
+  vector<int> threadNode(numThreads, -1);
+  #pragma omp parallel
+  {
+    int t = omp_get_thread_num();
+    threadNode[t] = currentNode();
+    #pragma omp for schedule(static)
+    for (int64_t v = 0; v < numNodes; v++)
+      nodeStart[t] = min(nodeStart[t], v);
+  }
+  for (int t = numThreads - 1; t > 0; t--)
+    nodeStart[t - 1] = min(nodeStart[t - 1], nodeStart[t]);
+  vector<int64_t> edgeStart(numThreads);
+  for (int t = 0; t < numThreads; t++)
+    edgeStart[t] = offsets[nodeStart[t]];
+
+  printf("%-12s setup %.3fs  sweep %.4fs", name, setup, sweep);
+  if (tlb.available())
+    printf("  dTLB misses/sweep %lld", tlbMisses / iters);
+  else
+    printf("  dTLB misses/sweep n/a");
+  printf("  (%lld nodes, %lld edges)\n", (long long)numNodes, (long long)numEdges);
+  printPlacement("offsets", offsets, pagePlacement(offsets, numNodes + 1, sizeof(int64_t), nodeStart, threadNode));
+  printPlacement("edges", edges, pagePlacement(edges, numEdges, sizeof(int32_t), edgeStart, threadNode));
+  printPlacement("rank", rank, pagePlacement(rank, numNodes, sizeof(float), nodeStart, threadNode));
+  printPlacement("next", next, pagePlacement(next, numNodes, sizeof(float), nodeStart, threadNode));
+
+  numaFree(offsets, numNodes + 1, policy);
+  numaFree(edges, numEdges, policy);
+  numaFree(rank, numNodes, policy);
+  numaFree(next, numNodes, policy);
+}
+
+int main(int argc, char* argv[])
+{
+  int64_t numNodes = 1 << 24;
+  int degree = 16;
+  int iters = 10;
+  bool comparePages = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--pages") == 0)
+      comparePages = true;
+    else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+      numNodes = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--degree") == 0 && i + 1 < argc)
+      degree = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc)
+      iters = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--pages] [--nodes N] [--degree d] [--iters k]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (numNodes < 1 || degree < 1 || iters < 1)
+  {
+    fprintf(stderr, "%s: --nodes, --degree and --iters must be positive\n", argv[0]);
+    return 1;
+  }
+
+  int sockets = countNumaNodes();
+  printf("%d NUMA node%s, %d threads%s\n", sockets, sockets == 1 ? "" : "s", omp_get_max_threads(),
+         getenv("OMP_PROC_BIND") ? "" : ", threads not pinned (set OMP_PROC_BIND)");
+  if (sockets == 1)
+    printf("one node: every page is local under every policy\n");
+
+  if (comparePages)
+  {
+    runPolicy(NUMA_FIRST_TOUCH, HUGE_PAGES_OFF, "4KB", numNodes, degree, iters);
+    runPolicy(NUMA_FIRST_TOUCH, HUGE_PAGES_THP, "thp", numNodes, degree, iters);
+    runPolicy(NUMA_FIRST_TOUCH, HUGE_PAGES_HUGETLB, "hugetlb", numNodes, degree, iters);
+    return 0;
+  }
+  runPolicy(NUMA_OFF, hugePageDefaultPolicy(), "off", numNodes, degree, iters);
+  runPolicy(NUMA_FIRST_TOUCH, hugePageDefaultPolicy(), "first-touch", numNodes, degree, iters);
+  runPolicy(NUMA_INTERLEAVE, hugePageDefaultPolicy(), "interleave", numNodes, degree, iters);
+  return 0;
+}
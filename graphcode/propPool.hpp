@@ -0,0 +1,222 @@
+#ifndef PROP_POOL_H
+#define PROP_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include "numaAlloc.hpp"
+#ifdef __CUDACC__
+#include <cuda_runtime.h>
+#endif
+
+/* Property storage kept for reuse, one pool per graph.
+
+   epochProp and bitProp take their arrays from the pool of the graph they
+   are attached to and hand them back when they go out of scope, which in
+   generated code is the return of the function declaring them. The next
+   Incremental/Decremental call (the next batch) attaching a property of
+   the same size then gets the same buffer back instead of mapping and
+   touching V or E elements again.
+
+   Requests are rounded up to a size class, four per doubling above 4KB,
+   so a graph that grows a little between batches still hits the cached
+   buffers. Fresh buffers come from numaMap and are first touched with the
+   static partition like numaAlloc does. Nothing is unmapped until trim(),
+   which propPoolScope calls when the Dynamic function returns; with
+   STARPLAT_POOL_STATS set it also prints the allocator call counts.
+
+   Props that CUDA kernels read as well (deviceProp.hpp) ask for
+   deviceShared buffers: CUDA managed memory, kept in a pool of its own
+   and zeroed on the device, so host and kernels use the same storage and
+   only the pages one side touches move to it. */
+
+#define PROP_POOL_MIN_BYTES ((size_t)4096)
+
+class propPool
+{
+  private:
+  std::mutex guard;
+  std::map<size_t, std::vector<void*>> cached;   /* class bytes -> free buffers */
+  std::map<size_t, std::vector<void*>> cachedShared;
+  size_t cachedBytes;
+
+  static void* mapShared(size_t size)
+  {
+#ifdef __CUDACC__
+    void* p = NULL;
+    if (cudaMallocManaged(&p, size) != cudaSuccess)
+      return NULL;
+    cudaMemset(p, 0, size);
+    cudaDeviceSynchronize();
+    return p;
+#else
+    fprintf(stderr, "propPool: device-shared props need a CUDA build\n");
+    abort();
+#endif
+  }
+
+  static void freeShared(void* p)
+  {
+#ifdef __CUDACC__
+    cudaFree(p);
+#endif
+  }
+
+  public:
+  /* calls into the allocator and requests served */
+  long mapCalls;
+  long unmapCalls;
+  long acquires;
+  long reuses;
+  size_t peakBytes;
+  size_t liveBytes;
+
+  static size_t classBytes(size_t bytes)
+  {
+    if (bytes <= PROP_POOL_MIN_BYTES)
+      return PROP_POOL_MIN_BYTES;
+    size_t high = (size_t)1 << (63 - __builtin_clzll(bytes - 1));
+    size_t step = high / 4;
+    return (bytes + step - 1) / step * step;
+  }
+
+  propPool()
+  {
+    cachedBytes = 0;
+    mapCalls = unmapCalls = acquires = reuses = 0;
+    peakBytes = liveBytes = 0;
+  }
+
+  ~propPool()
+  {
+    trim();
+  }
+
+  propPool(const propPool&) = delete;
+  propPool& operator=(const propPool&) = delete;
+
+  void* acquire(size_t bytes, bool deviceShared = false)
+  {
+    size_t size = classBytes(bytes);
+    void* p = NULL;
+    {
+      std::lock_guard<std::mutex> hold(guard);
+      acquires++;
+      liveBytes += size;
+      peakBytes = std::max(peakBytes, liveBytes);
+      std::vector<void*>& freeList = deviceShared ? cachedShared[size] : cached[size];
+      if (!freeList.empty())
+      {
+        p = freeList.back();
+        freeList.pop_back();
+        cachedBytes -= size;
+        reuses++;
+        return p;
+      }
+      mapCalls++;
+    }
+
+    if (deviceShared)
+      return mapShared(size);
+    p = numaMap(size, numaDefaultPolicy());
+    if (p == NULL)
+      return NULL;
+    uint64_t* words = (uint64_t*)p;
+    #pragma omp parallel for schedule(static)
+    for (long w = 0; w < (long)(size / sizeof(uint64_t)); w++)
+      words[w] = 0;
+    return p;
+  }
+
+  void release(void* p, size_t bytes, bool deviceShared = false)
+  {
+    if (p == NULL)
+      return;
+    size_t size = classBytes(bytes);
+    std::lock_guard<std::mutex> hold(guard);
+    (deviceShared ? cachedShared : cached)[size].push_back(p);
+    cachedBytes += size;
+    liveBytes -= size;
+  }
+
+  /* unmaps every cached buffer; buffers still handed out are not touched */
+  void trim()
+  {
+    std::lock_guard<std::mutex> hold(guard);
+    for (auto& entry : cached)
+    {
+      for (void* p : entry.second)
+      {
+        numaFree((char*)p, entry.first);
+        unmapCalls++;
+      }
+      entry.second.clear();
+    }
+    for (auto& entry : cachedShared)
+    {
+      for (void* p : entry.second)
+      {
+        freeShared(p);
+        unmapCalls++;
+      }
+      entry.second.clear();
+    }
+    cachedBytes = 0;
+  }
+
+  void report(FILE* out, const char* name)
+  {
+    std::lock_guard<std::mutex> hold(guard);
+    fprintf(out, "%s: %ld property allocations, %ld reused, %ld allocator calls (%ld map, %ld unmap), peak %.1f MB\n",
+            name, acquires, reuses, mapCalls + unmapCalls, mapCalls, unmapCalls, peakBytes / 1048576.0);
+  }
+};
+
+/* the pool of a graph, made on first use and kept for the graph's address */
+inline propPool& propPoolAt(const void* graphAddress)
+{
+  static std::mutex registryGuard;
+  static std::map<const void*, propPool*> registry;
+  std::lock_guard<std::mutex> hold(registryGuard);
+  propPool*& pool = registry[graphAddress];
+  if (pool == NULL)
+    pool = new propPool();
+  return *pool;
+}
+
+template <typename graphT>
+inline propPool& propPoolFor(const graphT& g)
+{
+  return propPoolAt((const void*)&g);
+}
+
+/* declared before a function's props, so it is destroyed after them:
+   trims the graph's pool and reports the counts if STARPLAT_POOL_STATS
+   is set */
+class propPoolScope
+{
+  private:
+  propPool& pool;
+
+  public:
+  template <typename graphT>
+  explicit propPoolScope(const graphT& g) : pool(propPoolFor(g))
+  {
+  }
+
+  ~propPoolScope()
+  {
+    pool.trim();
+    if (getenv("STARPLAT_POOL_STATS") != NULL)
+      pool.report(stderr, "propPool");
+  }
+
+  propPoolScope(const propPoolScope&) = delete;
+  propPoolScope& operator=(const propPoolScope&) = delete;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef PROP_WIDTH_H
+#define PROP_WIDTH_H
+
+#include <stdint.h>
+#include <limits>
+
+/* Run-time choice of the storage width for properties whose values the
+   generator could bound by the number of nodes (levels, node ids, counters
+   in a node loop) or edges (counters in a neighbour loop). Generated
+   functions that hold such props are templates over nodeval_t/edgeval_t
+   and the entry point dispatches on V and E once:
+
+     dispatchPropWidths(g.num_nodes(), g.num_edges(), 1, 0, [&](auto widths) {
+       Compute_impl<typename decltype(widths)::nodeval_t,
+                    typename decltype(widths)::edgeval_t>(g, ...);
+     });
+
+   The slack is the largest constant the analysis saw added to the bound
+   (level + 1 gives 1), and a width is picked if bound + slack fits it. */
+
+template <typename nodeT, typename edgeT>
+struct propWidths
+{
+  typedef nodeT nodeval_t;
+  typedef edgeT edgeval_t;
+};
+
+template <typename T>
+inline bool propWidthFits(long long bound, long long slack)
+{
+  return bound + slack <= (long long)std::numeric_limits<T>::max();
+}
+
+template <typename nodeT, typename Body>
+inline void dispatchEdgeWidth(long long E, long long edgeSlack, Body body)
+{
+  if (propWidthFits<int8_t>(E, edgeSlack))
+    body(propWidths<nodeT, int8_t>());
+  else if (propWidthFits<int16_t>(E, edgeSlack))
+    body(propWidths<nodeT, int16_t>());
+  else if (propWidthFits<int32_t>(E, edgeSlack))
+    body(propWidths<nodeT, int32_t>());
+  else
+    body(propWidths<nodeT, int64_t>());
+}
+
+template <typename Body>
+inline void dispatchPropWidths(long long V, long long E, long long nodeSlack, long long edgeSlack, Body body)
+{
+  if (propWidthFits<int8_t>(V, nodeSlack))
+    dispatchEdgeWidth<int8_t>(E, edgeSlack, body);
+  else if (propWidthFits<int16_t>(V, nodeSlack))
+    dispatchEdgeWidth<int16_t>(E, edgeSlack, body);
+  else if (propWidthFits<int32_t>(V, nodeSlack))
+    dispatchEdgeWidth<int32_t>(E, edgeSlack, body);
+  else
+    dispatchEdgeWidth<int64_t>(E, edgeSlack, body);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef REVERSE_CSR_H
+#define REVERSE_CSR_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <omp.h>
+#include <type_traits>
+#include <algorithm>
+#include "edgeListParser.hpp"
+#include "nbrView.hpp"
+
+/* The reverse CSR (rev_indexofNodes / srcList) built on first use.
+
+   Only pull-style code (nodes_to, inOutNbrs) reads the reverse CSR, so a
+   loader can skip it and the generated code calls ensureReverse(g) at the
+   top of the functions the compiler found using it. The build is a
+   parallel counting sort on destination: atomic in-degree counts, a
+   blocked prefix sum, an atomic scatter and a sort of each row.
+   NBR_DELETED slots are not edges and are left out. */
+
+/* row(v, visit) calls visit(u) for every out-neighbour u of v */
+template <typename offT, typename idxT, typename rowT>
+static void buildReverseCSR(int64_t numNodes, rowT row, offT*& revOffsets, idxT*& srcList)
+{
+  revOffsets = (offT*)calloc(numNodes + 1, sizeof(offT));
+
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+    row(v, [&](int64_t u) { __atomic_fetch_add(&revOffsets[u], 1, __ATOMIC_RELAXED); });
+  blockedPrefixSum(revOffsets, numNodes);
+
+  srcList = (idxT*)malloc(std::max(revOffsets[numNodes], (offT)1) * sizeof(idxT));
+  offT* cursor = (offT*)malloc((numNodes + 1) * sizeof(offT));
+  std::copy(revOffsets, revOffsets + numNodes + 1, cursor);
+
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t v = 0; v < numNodes; v++)
+    row(v, [&](int64_t u) { srcList[__atomic_fetch_add(&cursor[u], 1, __ATOMIC_RELAXED)] = (idxT)v; });
+  free(cursor);
+
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (int64_t u = 0; u < numNodes; u++)
+    std::sort(srcList + revOffsets[u], srcList + revOffsets[u + 1]);
+}
+
+/* graph.hpp graphs: builds g.rev_indexofNodes / g.srcList from the out
+   CSR if the loader left them NULL. The graph keeps the arrays. */
+template <typename graphT>
+inline void ensureReverse(graphT& g)
+{
+  if (g.rev_indexofNodes != NULL)
+    return;
+
+  typedef typename std::remove_pointer<decltype(g.rev_indexofNodes)>::type offT;
+  typedef typename std::remove_pointer<decltype(g.srcList)>::type idxT;
+  auto row = [&](int64_t v, auto visit)
+  {
+    for (auto e = g.indexofNodes[v]; e < g.indexofNodes[v + 1]; e++)
+      if (g.edgeList[e] != NBR_DELETED)
+        visit(g.edgeList[e]);
+  };
+  offT* revOffsets;
+  idxT* srcList;
+  buildReverseCSR<offT, idxT>(g.num_nodes(), row, revOffsets, srcList);
+  g.rev_indexofNodes = revOffsets;
+  g.srcList = srcList;
+}
+
+#endif
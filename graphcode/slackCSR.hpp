@@ -0,0 +1,754 @@
+#ifndef SLACK_CSR_H
+#define SLACK_CSR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "graphIndex.hpp"
+#include "nbrView.hpp"
+#include "updateBatch.hpp"
+#include "numaAlloc.hpp"
+
+/* CSR with room to grow, for graphs updated in batches.
+
+   Each node owns the slots [start[v], start[v + 1]); its live neighbours
+   are the first degree[v] of them, sorted, and the rest hold NBR_DELETED.
+   Every loop that already skips deleted edges (getNeighbors, outNbrs,
+   the kernels) therefore reads the layout unchanged, neighbours stay
+   contiguous, and a binary search over a whole segment still works since
+   NBR_DELETED sorts after every node id.
+
+   An insert into a full segment rebalances the smallest aligned window of
+   nodes around it whose density is under that level's bound, spreading
+   the window's free slots over its nodes by degree (a packed memory array
+   over nodes). When the whole array is too dense it is reallocated with
+   more room. A batch of b updates then costs about b times the degree
+   shift plus the amortised rebalance, instead of O(E).
+
+   Edges move between slots, so with ids kept each slot also holds its
+   edge's id, which travels with the edge like its weight. An edge keeps
+   its id until it is deleted; new edges reuse the ids of deleted ones, so
+   every id stays below the largest edge count seen. */
+
+#define SLACK_MIN_ROOM 2
+#define SLACK_MAX_DENSITY 0.85
+#define SLACK_LOGGED_LAYOUTS 8
+
+class slackAdjacency
+{
+  public:
+  index_t numNodes;
+  offset_t* start;          /* numNodes + 1 */
+  offset_t* degree;
+  offset_t* pending;        /* slots promised to a run about to be inserted */
+  index_t* list;
+  int32_t* weights;         /* NULL when unweighted */
+  offset_t* ids;            /* NULL when edges are numbered by slot */
+  offset_t idLimit;         /* every id is below it */
+  std::vector<offset_t> freeIds;
+  std::vector<std::pair<index_t, index_t> > changed;   /* node ranges rewritten since the last publish */
+
+  slackAdjacency()
+  {
+    numNodes = 0;
+    start = degree = pending = NULL;
+    list = NULL;
+    weights = NULL;
+    ids = NULL;
+    idLimit = 0;
+  }
+
+  ~slackAdjacency()
+  {
+    if (start != NULL)
+    {
+      numaFree(list, slots());
+      numaFree(weights, slots());
+      numaFree(ids, slots());
+    }
+    free(start);
+    free(degree);
+    free(pending);
+  }
+
+  offset_t slots() const
+  {
+    return start[numNodes];
+  }
+
+  offset_t liveEdges() const
+  {
+    offset_t live = 0;
+    for (index_t v = 0; v < numNodes; v++)
+      live += degree[v];
+    return live;
+  }
+
+  /* from a plain CSR and, if diffOffsets is not NULL, the diff CSR of the
+     same graph; deleted slots in either are dropped. Edge e of the plain
+     CSR keeps id e and diff edge e gets E + e, as nbrView numbers them. */
+  void build(index_t V, const offset_t* offsets, const index_t* adjacency, const int32_t* edgeWeights,
+             const offset_t* diffOffsets, const index_t* diffAdjacency, const int32_t* diffWeights, bool withIds)
+  {
+    numNodes = V;
+    degree = (offset_t*)malloc(V * sizeof(offset_t));
+    pending = (offset_t*)calloc(V, sizeof(offset_t));
+    std::vector<offset_t> room(V);
+    #pragma omp parallel for
+    for (index_t v = 0; v < V; v++)
+    {
+      offset_t live = 0;
+      for (offset_t e = offsets[v]; e < offsets[v + 1]; e++)
+        live += adjacency[e] != NBR_DELETED;
+      if (diffOffsets != NULL)
+      {
+        for (offset_t e = diffOffsets[v]; e < diffOffsets[v + 1]; e++)
+          live += diffAdjacency[e] != NBR_DELETED;
+      }
+      degree[v] = live;
+      room[v] = live + std::max((offset_t)SLACK_MIN_ROOM, live / 4);
+    }
+
+    start = (offset_t*)malloc((V + 1) * sizeof(offset_t));
+    start[0] = 0;
+    for (index_t v = 0; v < V; v++)
+      start[v + 1] = start[v] + room[v];
+    /* mapped untouched, so the copy below places each node's slots on
+       the socket of the thread that owns the node */
+    list = (index_t*)numaMap(start[V] * sizeof(index_t), numaDefaultPolicy());
+    weights = edgeWeights ? (int32_t*)numaMap(start[V] * sizeof(int32_t), numaDefaultPolicy()) : NULL;
+    ids = withIds ? (offset_t*)numaMap(start[V] * sizeof(offset_t), numaDefaultPolicy()) : NULL;
+
+    offset_t E = offsets[V];
+    #pragma omp parallel for schedule(static)
+    for (index_t v = 0; v < V; v++)
+    {
+      offset_t at = start[v];
+      for (offset_t e = offsets[v]; e < offsets[v + 1]; e++)
+      {
+        if (adjacency[e] == NBR_DELETED)
+          continue;
+        list[at] = adjacency[e];
+        if (weights)
+          weights[at] = edgeWeights[e];
+        if (ids)
+          ids[at] = e;
+        at++;
+      }
+      if (diffOffsets != NULL && diffOffsets[v] < diffOffsets[v + 1])
+      {
+        for (offset_t e = diffOffsets[v]; e < diffOffsets[v + 1]; e++)
+        {
+          if (diffAdjacency[e] == NBR_DELETED)
+            continue;
+          list[at] = diffAdjacency[e];
+          if (weights)
+            weights[at] = diffWeights ? diffWeights[e] : 1;
+          if (ids)
+            ids[at] = E + e;
+          at++;
+        }
+        sortSegment(v);
+      }
+      std::fill(list + at, list + start[v + 1], NBR_DELETED);
+      if (weights)
+        std::fill(weights + at, weights + start[v + 1], 0);
+      if (ids)
+        std::fill(ids + at, ids + start[v + 1], -1);
+    }
+
+    /* ids of the slots that were deleted already are free */
+    idLimit = E + (diffOffsets != NULL ? diffOffsets[V] : 0);
+    if (ids)
+    {
+      for (offset_t e = 0; e < E; e++)
+        if (adjacency[e] == NBR_DELETED)
+          freeIds.push_back(e);
+      for (offset_t e = 0; diffOffsets != NULL && e < diffOffsets[V]; e++)
+        if (diffAdjacency[e] == NBR_DELETED)
+          freeIds.push_back(E + e);
+    }
+  }
+
+  bool fits(index_t v) const
+  {
+    return start[v] + degree[v] + pending[v] <= start[v + 1];
+  }
+
+  /* makes room for pending[v] more neighbours of v without taking the
+     room promised to other nodes */
+  void rebalance(index_t v)
+  {
+    int topLevel = 0;
+    while (((index_t)1 << topLevel) < numNodes)
+      topLevel++;
+
+    for (int level = 1; level <= topLevel; level++)
+    {
+      index_t lo = v & ~(((index_t)1 << level) - 1);
+      index_t hi = std::min(numNodes, lo + ((index_t)1 << level));
+      if (used(lo, hi) <= densityBound(level, topLevel) * (start[hi] - start[lo]))
+      {
+        spread(lo, hi, start[hi] - start[lo]);
+        return;
+      }
+    }
+
+    /* whole array too dense: grow it */
+    offset_t grown = std::max((offset_t)(used(0, numNodes) / SLACK_MAX_DENSITY * 1.5), slots() + numNodes);
+    spread(0, numNodes, grown);
+  }
+
+  /* merges a sorted run of new neighbours into v's list; the caller has
+     made room for count of them. Neighbours already there only get the
+     new weight. The slots of the added edges go to fresh, for their ids. */
+  void insertRun(index_t v, const index_t* nbrs, const int32_t* nbrWeights, offset_t count, std::vector<offset_t>& fresh)
+  {
+    offset_t first = start[v];
+    offset_t last = first + degree[v];
+    offset_t added = 0;
+    for (offset_t i = 0; i < count; i++)
+    {
+      index_t* at = std::lower_bound(list + first, list + last, nbrs[i]);
+      if (at == list + last || *at != nbrs[i])
+        added++;
+      else if (weights)
+        weights[at - list] = nbrWeights[i];
+    }
+
+    /* merge from the back into the free slots */
+    offset_t out = last + added;
+    offset_t j = count;
+    offset_t e = last;
+    while (j > 0)
+    {
+      if (e > first && list[e - 1] > nbrs[j - 1])
+      {
+        out--;
+        e--;
+        list[out] = list[e];
+        if (weights)
+          weights[out] = weights[e];
+        if (ids)
+          ids[out] = ids[e];
+      }
+      else
+      {
+        j--;
+        if (e > first && list[e - 1] == nbrs[j])
+          continue;
+        out--;
+        list[out] = nbrs[j];
+        if (weights)
+          weights[out] = nbrWeights[j];
+        if (ids)
+          fresh.push_back(out);
+      }
+    }
+    degree[v] += added;
+  }
+
+  /* removes a sorted run of neighbours from v's list, absent ones ignored;
+     the ids of the removed edges go to freed */
+  void eraseRun(index_t v, const index_t* nbrs, offset_t count, std::vector<offset_t>& freed)
+  {
+    offset_t first = start[v];
+    offset_t last = first + degree[v];
+    offset_t out = first;
+    offset_t j = 0;
+    for (offset_t e = first; e < last; e++)
+    {
+      while (j < count && nbrs[j] < list[e])
+        j++;
+      if (j < count && nbrs[j] == list[e])
+      {
+        if (ids)
+          freed.push_back(ids[e]);
+        continue;
+      }
+      list[out] = list[e];
+      if (weights)
+        weights[out] = weights[e];
+      if (ids)
+        ids[out] = ids[e];
+      out++;
+    }
+    std::fill(list + out, list + last, NBR_DELETED);
+    if (ids)
+      std::fill(ids + out, ids + last, -1);
+    degree[v] = out - first;
+  }
+
+  /* ids for the edges insertRun placed, freed ones first */
+  void assignIds(const std::vector<offset_t>& fresh)
+  {
+    for (offset_t slot : fresh)
+    {
+      if (freeIds.empty())
+        ids[slot] = idLimit++;
+      else
+      {
+        ids[slot] = freeIds.back();
+        freeIds.pop_back();
+      }
+    }
+  }
+
+  private:
+  /* v's live neighbours in order, weights and ids alongside */
+  void sortSegment(index_t v)
+  {
+    offset_t first = start[v];
+    offset_t last = first + degree[v];
+    std::vector<offset_t> order(last - first);
+    for (offset_t i = 0; i < last - first; i++)
+      order[i] = first + i;
+    std::sort(order.begin(), order.end(), [&](offset_t a, offset_t b) { return list[a] < list[b]; });
+
+    std::vector<index_t> sortedList(order.size());
+    std::vector<int32_t> sortedWeights(weights ? order.size() : 0);
+    std::vector<offset_t> sortedIds(ids ? order.size() : 0);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      sortedList[i] = list[order[i]];
+      if (weights)
+        sortedWeights[i] = weights[order[i]];
+      if (ids)
+        sortedIds[i] = ids[order[i]];
+    }
+    std::copy(sortedList.begin(), sortedList.end(), list + first);
+    if (weights)
+      std::copy(sortedWeights.begin(), sortedWeights.end(), weights + first);
+    if (ids)
+      std::copy(sortedIds.begin(), sortedIds.end(), ids + first);
+  }
+
+  /* density bound of a window of 2^level nodes: 1 at a single node down
+     to SLACK_MAX_DENSITY for the whole array */
+  double densityBound(int level, int topLevel) const
+  {
+    if (topLevel == 0)
+      return SLACK_MAX_DENSITY;
+    return 1.0 - (1.0 - SLACK_MAX_DENSITY) * level / topLevel;
+  }
+
+  offset_t used(index_t lo, index_t hi) const
+  {
+    offset_t n = 0;
+    for (index_t u = lo; u < hi; u++)
+      n += degree[u] + pending[u];
+    return n;
+  }
+
+  /* array with growth more slots in [base, base + total), the slots outside
+     it copied over. Written once in parallel so the pages are spread over
+     the sockets rather than placed by one serial copy. */
+  template <typename T>
+  T* regrow(T* from, offset_t base, offset_t total, offset_t growth, T empty)
+  {
+    offset_t slotsNow = slots() + growth;
+    T* to = (T*)numaMap(slotsNow * sizeof(T), numaDefaultPolicy());
+    #pragma omp parallel for schedule(static)
+    for (offset_t e = 0; e < slotsNow; e++)
+    {
+      if (e < base)
+        to[e] = from[e];
+      else if (e < base + total)
+        to[e] = empty;
+      else
+        to[e] = from[e - growth];
+    }
+    numaFree(from, slots());
+    return to;
+  }
+
+  /* lays nodes [lo, hi) out over total slots starting at start[lo], each
+     keeping its degree + pending and the free slots shared in proportion
+     to that + 1 */
+  void spread(index_t lo, index_t hi, offset_t total)
+  {
+    offset_t base = start[lo];
+    offset_t oldEnd = start[hi];
+    offset_t growth = total - (oldEnd - base);
+    offset_t spare = total - used(lo, hi);
+
+    std::vector<offset_t> newStart(hi - lo + 1);
+    newStart[0] = base;
+    double share = (double)spare / (used(lo, hi) + (hi - lo));
+    offset_t handed = 0;
+    for (index_t u = lo; u < hi; u++)
+    {
+      offset_t room = (offset_t)(share * (degree[u] + pending[u] + 1));
+      if (u == hi - 1)
+        room = spare - handed;
+      handed += room;
+      newStart[u - lo + 1] = newStart[u - lo] + degree[u] + pending[u] + room;
+    }
+
+    std::vector<index_t> oldList(list + base, list + oldEnd);
+    std::vector<int32_t> oldWeights;
+    std::vector<offset_t> oldIds;
+    if (weights)
+      oldWeights.assign(weights + base, weights + oldEnd);
+    if (ids)
+      oldIds.assign(ids + base, ids + oldEnd);
+
+    /* growing moves every later segment too */
+    changed.push_back(std::make_pair(lo, growth != 0 ? numNodes : hi));
+    if (growth != 0)
+    {
+      if (weights)
+        weights = regrow(weights, base, total, growth, (int32_t)0);
+      if (ids)
+        ids = regrow(ids, base, total, growth, (offset_t)-1);
+      list = regrow(list, base, total, growth, (index_t)NBR_DELETED);
+      for (index_t u = hi + 1; u <= numNodes; u++)
+        start[u] += growth;
+    }
+
+    for (index_t u = lo; u < hi; u++)
+    {
+      offset_t from = start[u] - base;
+      offset_t to = newStart[u - lo];
+      memcpy(list + to, oldList.data() + from, degree[u] * sizeof(index_t));
+      std::fill(list + to + degree[u], list + newStart[u - lo + 1], NBR_DELETED);
+      if (weights)
+      {
+        memcpy(weights + to, oldWeights.data() + from, degree[u] * sizeof(int32_t));
+        std::fill(weights + to + degree[u], weights + newStart[u - lo + 1], 0);
+      }
+      if (ids)
+      {
+        memcpy(ids + to, oldIds.data() + from, degree[u] * sizeof(offset_t));
+        std::fill(ids + to + degree[u], ids + newStart[u - lo + 1], -1);
+      }
+    }
+    for (index_t u = lo; u < hi; u++)
+      start[u + 1] = newStart[u - lo + 1];
+  }
+};
+
+/* weight of an update, 1 for update types without one */
+template <typename updateT>
+inline auto updateWeight(const updateT& u, int) -> decltype((int32_t)u.weight)
+{
+  return u.weight;
+}
+
+template <typename updateT>
+inline int32_t updateWeight(const updateT&, long)
+{
+  return 1;
+}
+
+/* Attaches to a graph.hpp graph: lays its forward and reverse CSR, diff
+   CSR included, out with slack, frees the graph's own arrays and points
+   g.indexofNodes, edgeList, edgeLen, rev_indexofNodes, srcList and
+   edgesTotal at the slack arrays, so the rest of the code keeps reading g.
+   The diff CSR is merged in and dropped.
+
+   updateCSRAdd/updateCSRDel and getAddsFromBatch/getDeletesFromBatch take
+   the same arguments as the graph's; a batch is prepared once
+   (updateBatch.hpp) and its per-node runs are merged in parallel. An
+   update naming a node the graph does not have stops the program, since
+   node props are sized by V.
+
+   While attached, edge ids are stable: outNbrs and findEdge hand out the
+   id registered for the slot (nbrView.hpp), the original edge numbers for
+   the edges g had. Each publish also logs the node ranges it rewrote
+   (layoutChangesSince), so an edge index or device copy of the layout
+   can refresh just those. When the store goes out of scope g gets a plain CSR
+   again (without the slack) that it owns, with edges numbered by position.
+   A graph attached without a reverse CSR is kept without one; call
+   ensureReverse first if needed. */
+template <typename graphT, typename updateT>
+class slackCSR
+{
+  private:
+  graphT& g;
+  slackAdjacency out;
+  slackAdjacency in;
+  bool withReverse;                  /* g had a reverse CSR when attached */
+
+  layoutChangeLog log;               /* rows changed by the last few publishes */
+
+  preparedBatch<updateT> batch;      /* keyed on source */
+  preparedBatch<updateT> revBatch;   /* keyed on destination */
+  const updateT* preparedFrom;
+  int preparedIndex;
+  int preparedElements;
+
+  void publish()
+  {
+    g.indexofNodes = out.start;
+    g.edgeList = out.list;
+    g.edgeLen = out.weights;
+    if (withReverse)
+    {
+      g.rev_indexofNodes = in.start;
+      g.srcList = in.list;
+    }
+    g.edgesTotal = std::max(out.slots(), out.idLimit);
+    uint64_t version = setEdgeIds((const void*)&g, out.ids, &log);
+
+    if (log.oldest == 0)
+      log.oldest = version;
+    for (int reverse = 0; reverse < 2; reverse++)
+    {
+      slackAdjacency& a = reverse ? in : out;
+      for (const std::pair<index_t, index_t>& rows : a.changed)
+      {
+        layoutChange c = {version, rows.first, rows.second, reverse != 0};
+        log.changes.push_back(c);
+      }
+      a.changed.clear();
+    }
+
+    /* forget the layouts older than the last few */
+    size_t keep = 0;
+    int layouts = 0;
+    for (size_t i = log.changes.size(); i > 0; i--)
+    {
+      if (i == log.changes.size() || log.changes[i - 1].version != log.changes[i].version)
+      {
+        if (++layouts > SLACK_LOGGED_LAYOUTS)
+        {
+          keep = i;
+          break;
+        }
+      }
+    }
+    if (keep > 0)
+    {
+      log.oldest = log.changes[keep - 1].version;
+      log.changes.erase(log.changes.begin(), log.changes.begin() + keep);
+    }
+  }
+
+  /* the nodes of a batch's runs, as changed rows */
+  static void markRuns(slackAdjacency& a, const std::vector<updateT>& updates, const std::vector<int64_t>& groups, bool reverse)
+  {
+    for (size_t r = 0; r + 1 < groups.size(); r++)
+    {
+      const updateT& u = updates[groups[r]];
+      index_t v = reverse ? u.destination : u.source;
+      a.changed.push_back(std::make_pair(v, v + 1));
+    }
+  }
+
+  void prepare(std::vector<updateT>& updates, int updateIndex, int batchElements)
+  {
+    if (preparedFrom == updates.data() && preparedIndex == updateIndex && preparedElements == batchElements)
+      return;
+    index_t V = out.numNodes;
+    for (int i = updateIndex; i < updateIndex + batchElements && i < (int)updates.size(); i++)
+    {
+      const updateT& u = updates[i];
+      if (u.source < 0 || u.source >= V || u.destination < 0 || u.destination >= V)
+      {
+        fprintf(stderr, "slackCSR: update %d names edge (" INDEX_FMT ", " INDEX_FMT ") outside the " INDEX_FMT " nodes of the graph\n",
+                i, (index_t)u.source, (index_t)u.destination, V);
+        exit(1);
+      }
+    }
+    prepareBatch(updates, updateIndex, batchElements, batch, false);
+    if (withReverse)
+      prepareBatch(updates, updateIndex, batchElements, revBatch, true);
+    preparedFrom = updates.data();
+    preparedIndex = updateIndex;
+    preparedElements = batchElements;
+  }
+
+  /* one run per node: promise the room, rebalance the nodes that lack it
+     one at a time, then merge all runs in parallel */
+  static void applyAdds(slackAdjacency& a, const std::vector<updateT>& adds, const std::vector<int64_t>& groups, bool reverse)
+  {
+    int64_t numGroups = (int64_t)groups.size() - 1;
+    #pragma omp parallel for
+    for (int64_t r = 0; r < numGroups; r++)
+    {
+      const updateT& u = adds[groups[r]];
+      a.pending[reverse ? u.destination : u.source] = groups[r + 1] - groups[r];
+    }
+    for (int64_t r = 0; r < numGroups; r++)
+    {
+      const updateT& u = adds[groups[r]];
+      index_t v = reverse ? u.destination : u.source;
+      if (!a.fits(v))
+        a.rebalance(v);
+    }
+
+    std::vector<offset_t> fresh;
+    #pragma omp parallel
+    {
+      std::vector<index_t> nbrs;
+      std::vector<int32_t> nbrWeights;
+      std::vector<offset_t> placed;
+      #pragma omp for schedule(dynamic, 64)
+      for (int64_t r = 0; r < numGroups; r++)
+      {
+        nbrs.clear();
+        nbrWeights.clear();
+        for (int64_t i = groups[r]; i < groups[r + 1]; i++)
+        {
+          nbrs.push_back(reverse ? adds[i].source : adds[i].destination);
+          nbrWeights.push_back(reverse ? 0 : updateWeight(adds[i], 0));
+        }
+        index_t v = reverse ? adds[groups[r]].destination : adds[groups[r]].source;
+        a.insertRun(v, nbrs.data(), nbrWeights.data(), nbrs.size(), placed);
+        a.pending[v] = 0;
+      }
+      #pragma omp critical
+      fresh.insert(fresh.end(), placed.begin(), placed.end());
+    }
+    if (a.ids)
+    {
+      std::sort(fresh.begin(), fresh.end());
+      a.assignIds(fresh);
+    }
+  }
+
+  static void applyDeletes(slackAdjacency& a, const std::vector<updateT>& deletes, const std::vector<int64_t>& groups, bool reverse)
+  {
+    int64_t numGroups = (int64_t)groups.size() - 1;
+    std::vector<offset_t> freed;
+    #pragma omp parallel
+    {
+      std::vector<index_t> nbrs;
+      std::vector<offset_t> erased;
+      #pragma omp for schedule(dynamic, 64)
+      for (int64_t r = 0; r < numGroups; r++)
+      {
+        nbrs.clear();
+        for (int64_t i = groups[r]; i < groups[r + 1]; i++)
+          nbrs.push_back(reverse ? deletes[i].source : deletes[i].destination);
+        index_t v = reverse ? deletes[groups[r]].destination : deletes[groups[r]].source;
+        a.eraseRun(v, nbrs.data(), nbrs.size(), erased);
+      }
+      #pragma omp critical
+      freed.insert(freed.end(), erased.begin(), erased.end());
+    }
+    /* sorted so the ids handed out next do not depend on the schedule */
+    std::sort(freed.begin(), freed.end(), std::greater<offset_t>());
+    a.freeIds.insert(a.freeIds.end(), freed.begin(), freed.end());
+  }
+
+  /* plain copy of a segment layout, deleted slots dropped */
+  static void compact(const slackAdjacency& a, offset_t*& offsets, index_t*& adjacency, int32_t** edgeWeights)
+  {
+    offsets = (offset_t*)malloc((a.numNodes + 1) * sizeof(offset_t));
+    offsets[0] = 0;
+    for (index_t v = 0; v < a.numNodes; v++)
+      offsets[v + 1] = offsets[v] + a.degree[v];
+    adjacency = (index_t*)malloc(std::max(offsets[a.numNodes], (offset_t)1) * sizeof(index_t));
+    if (edgeWeights)
+      *edgeWeights = (int32_t*)malloc(std::max(offsets[a.numNodes], (offset_t)1) * sizeof(int32_t));
+
+    #pragma omp parallel for
+    for (index_t v = 0; v < a.numNodes; v++)
+    {
+      memcpy(adjacency + offsets[v], a.list + a.start[v], a.degree[v] * sizeof(index_t));
+      if (edgeWeights)
+        memcpy(*edgeWeights + offsets[v], a.weights + a.start[v], a.degree[v] * sizeof(int32_t));
+    }
+  }
+
+  public:
+  slackCSR(graphT& graphSent) : g(graphSent)
+  {
+    index_t V = g.num_nodes();
+    out.build(V, g.indexofNodes, g.edgeList, g.edgeLen, g.diff_indexofNodes, g.diff_edgeList, g.diff_edgeLen, true);
+    withReverse = g.rev_indexofNodes != NULL;
+    if (withReverse)
+      in.build(V, g.rev_indexofNodes, g.srcList, NULL, g.diff_rev_indexofNodes, g.diff_rev_edgeList, NULL, false);
+
+    /* the slack arrays replace the graph's, which it allocated with malloc */
+    free(g.indexofNodes);
+    free(g.edgeList);
+    free(g.edgeLen);
+    free(g.diff_indexofNodes);
+    free(g.diff_edgeList);
+    free(g.diff_edgeLen);
+    g.diff_indexofNodes = NULL;
+    g.diff_edgeList = NULL;
+    g.diff_edgeLen = NULL;
+    if (withReverse)
+    {
+      free(g.rev_indexofNodes);
+      free(g.srcList);
+    }
+    free(g.diff_rev_indexofNodes);
+    free(g.diff_rev_edgeList);
+    g.diff_rev_indexofNodes = NULL;
+    g.diff_rev_edgeList = NULL;
+
+    preparedFrom = NULL;
+    preparedIndex = preparedElements = -1;
+    log.oldest = 0;
+    publish();
+  }
+
+  ~slackCSR()
+  {
+    setEdgeIds((const void*)&g, NULL);
+    int32_t* edgeLen = NULL;
+    compact(out, g.indexofNodes, g.edgeList, out.weights ? &edgeLen : NULL);
+    g.edgeLen = edgeLen;
+    if (withReverse)
+      compact(in, g.rev_indexofNodes, g.srcList, NULL);
+    g.edgesTotal = g.indexofNodes[out.numNodes];
+  }
+
+  slackCSR(const slackCSR&) = delete;
+  slackCSR& operator=(const slackCSR&) = delete;
+
+  void updateCSRAdd(std::vector<updateT>& updates, int updateIndex, int batchElements)
+  {
+    prepare(updates, updateIndex, batchElements);
+    applyAdds(out, batch.adds, batch.addGroups, false);
+    markRuns(out, batch.adds, batch.addGroups, false);
+    if (withReverse)
+    {
+      applyAdds(in, revBatch.adds, revBatch.addGroups, true);
+      markRuns(in, revBatch.adds, revBatch.addGroups, true);
+    }
+    publish();
+  }
+
+  void updateCSRDel(std::vector<updateT>& updates, int updateIndex, int batchElements)
+  {
+    prepare(updates, updateIndex, batchElements);
+    applyDeletes(out, batch.deletes, batch.deleteGroups, false);
+    markRuns(out, batch.deletes, batch.deleteGroups, false);
+    if (withReverse)
+    {
+      applyDeletes(in, revBatch.deletes, revBatch.deleteGroups, true);
+      markRuns(in, revBatch.deletes, revBatch.deleteGroups, true);
+    }
+    publish();
+  }
+
+  /* the batch's net adds / deletes, sorted and grouped by source */
+  const std::vector<updateT>& getAddsFromBatch(int updateIndex, int batchSize, std::vector<updateT>& updates)
+  {
+    prepare(updates, updateIndex, batchSize);
+    return batch.adds;
+  }
+
+  const std::vector<updateT>& getDeletesFromBatch(int updateIndex, int batchSize, std::vector<updateT>& updates)
+  {
+    prepare(updates, updateIndex, batchSize);
+    return batch.deletes;
+  }
+
+  offset_t liveEdges() const
+  {
+    return out.liveEdges();
+  }
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef UPDATE_BATCH_H
+#define UPDATE_BATCH_H
+
+#include <stdint.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
+
+/* One batch of an update stream, prepared for applying.
+
+   prepareBatch takes updates [updateIndex, updateIndex + batchElements),
+   sorts them by (source, destination) in parallel, and keeps only the
+   last update of each edge: an add followed by a delete of the same edge
+   is the delete, a delete followed by an add is the add, repeats collapse
+   to one. Since adds of present edges and deletes of absent ones change
+   nothing, applying all the deletes and then all the adds gives the same
+   graph as the batch in arrival order.
+
+   adds and deletes come out sorted with one run per source; addGroups /
+   deleteGroups hold where each run starts (plus the end), so a run can be
+   handed to one thread and no two threads touch the same node's list.
+   byDestination keys the sort and the runs on the destination instead,
+   for the reverse CSR. */
+
+template <typename updateT>
+struct preparedBatch
+{
+  std::vector<updateT> adds;
+  std::vector<updateT> deletes;
+  std::vector<int64_t> addGroups;
+  std::vector<int64_t> deleteGroups;
+};
+
+struct batchKey
+{
+  int64_t first;
+  int64_t second;
+  int64_t arrival;
+
+  bool operator<(const batchKey& other) const
+  {
+    if (first != other.first)
+      return first < other.first;
+    if (second != other.second)
+      return second < other.second;
+    return arrival < other.arrival;
+  }
+};
+
+/* sorted runs per thread, then pairwise merges */
+template <typename T>
+static void parallelSort(std::vector<T>& items)
+{
+  int64_t n = items.size();
+  int numChunks = omp_get_max_threads();
+  if (n < 4096 || numChunks == 1)
+  {
+    std::sort(items.begin(), items.end());
+    return;
+  }
+
+  std::vector<int64_t> bound(numChunks + 1);
+  for (int c = 0; c <= numChunks; c++)
+    bound[c] = n * c / numChunks;
+
+  #pragma omp parallel for schedule(static, 1)
+  for (int c = 0; c < numChunks; c++)
+    std::sort(items.begin() + bound[c], items.begin() + bound[c + 1]);
+
+  for (int width = 1; width < numChunks; width *= 2)
+  {
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < numChunks - width; c += 2 * width)
+    {
+      int64_t mid = bound[c + width];
+      int64_t hi = bound[std::min(c + 2 * width, numChunks)];
+      std::inplace_merge(items.begin() + bound[c], items.begin() + mid, items.begin() + hi);
+    }
+  }
+}
+
+template <typename updateT>
+static void groupRuns(const std::vector<updateT>& run, bool byDestination, std::vector<int64_t>& groups)
+{
+  groups.clear();
+  for (size_t i = 0; i < run.size(); i++)
+  {
+    int64_t key = byDestination ? run[i].destination : run[i].source;
+    if (i == 0 || key != (byDestination ? run[i - 1].destination : run[i - 1].source))
+      groups.push_back(i);
+  }
+  groups.push_back(run.size());
+}
+
+template <typename updateT>
+static void prepareBatch(const std::vector<updateT>& updates, int updateIndex, int batchElements,
+                         preparedBatch<updateT>& batch, bool byDestination = false)
+{
+  int64_t lo = std::max(updateIndex, 0);
+  int64_t hi = std::min((int64_t)updateIndex + batchElements, (int64_t)updates.size());
+  int64_t n = std::max(hi - lo, (int64_t)0);
+
+  std::vector<batchKey> keys(n);
+  #pragma omp parallel for
+  for (int64_t i = 0; i < n; i++)
+  {
+    const updateT& u = updates[lo + i];
+    keys[i].first = byDestination ? u.destination : u.source;
+    keys[i].second = byDestination ? u.source : u.destination;
+    keys[i].arrival = lo + i;
+  }
+  parallelSort(keys);
+
+  batch.adds.clear();
+  batch.deletes.clear();
+  for (int64_t i = 0; i < n; i++)
+  {
+    /* the last arrival of each edge wins */
+    if (i + 1 < n && keys[i + 1].first == keys[i].first && keys[i + 1].second == keys[i].second)
+      continue;
+    const updateT& u = updates[keys[i].arrival];
+    if (u.type == 'a')
+      batch.adds.push_back(u);
+    else if (u.type == 'd')
+      batch.deletes.push_back(u);
+  }
+  groupRuns(batch.adds, byDestination, batch.addGroups);
+  groupRuns(batch.deletes, byDestination, batch.deleteGroups);
+}
+
+#endif
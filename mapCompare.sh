@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds MAP_cuda.cu and MAP_cpu.cpp and runs both mains with the same map
+# and batch sizes. The final map arrays must be the same bytes and the
+# printed lines the same apart from timings. Needs nvcc and a GPU.
+#
+#   ./mapCompare.sh ["map_size batch_size" ...]
+#
+# CUDA_ARCH picks the nvcc target (default sm_70).
+
+set -e
+cd "$(dirname "$0")"
+nvcc -O3 -arch="${CUDA_ARCH:-sm_70}" MAP_cuda.cu -o mapCuda
+g++ -O3 -fopenmp MAP_cpu.cpp -o map_cpu
+
+if [ $# -eq 0 ]; then
+    set -- "2002 1000" "46002 46000" "1000002 1000000"
+fi
+
+status=0
+for sizes in "$@"; do
+    ./mapCuda cuda.bin $sizes | grep -v "Time taken" > cuda.out
+    ./map_cpu cpu.bin $sizes | grep -v "Time taken" > cpu.out
+    if cmp -s cuda.bin cpu.bin && cmp -s cuda.out cpu.out; then
+        echo "$sizes: same map bytes and output"
+    else
+        echo "$sizes: DIFFERENT"
+        status=1
+    fi
+done
+rm -f cuda.bin cpu.bin cuda.out cpu.out
+exit $status
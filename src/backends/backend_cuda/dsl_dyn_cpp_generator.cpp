@@ -51,17 +51,13 @@ void dsl_dyn_cpp_generator::generateOnDeleteBlock(onDeleteBlock* onDeleteStmt, b
 
    if(methodId == "currentBatch")
    {
-     sprintf(strBuffer,"for(int batchIndex = updateIndex ; batchIndex < (updateIndex+batchSize) && batchIndex < %s.size() ; batchIndex++){",updatesId->getIdentifier());
-     main.pushstr_newL(strBuffer);
-     sprintf(strBuffer,"if(%s[batchIndex].type == 'd')",updatesId->getIdentifier());
-     main.pushstr_newL(strBuffer);
-     main.pushstr_newL("{");
-     sprintf(strBuffer, "update %s = %s[batchIndex] ;",onDeleteStmt->getIteratorId()->getIdentifier(), getUpdatesId()->getIdentifier());
+     /* walk the batch g_slack prepared: net deletes only, sorted and
+        grouped by source (slackCSR.hpp) */
+     sprintf(strBuffer,"for (const update& %s : %s_slack.getDeletesFromBatch(updateIndex, batchElements, %s)){",onDeleteStmt->getIteratorId()->getIdentifier(),graphId[curFuncType][curFuncCount()][0]->getIdentifier(),updatesId->getIdentifier());
      main.pushstr_newL(strBuffer);
      generateBlock(onDeleteStmt->getStatements(),false);
      main.NewLine();
      main.pushstr_newL("}");
-     main.pushstr_newL("}");
    }
    
    resetPreprocessEnv();
@@ -75,17 +71,12 @@ void dsl_dyn_cpp_generator::generateOnAddBlock(onAddBlock* onAddStmt,bool isMain
     setPreprocessEnv();
 
    char strBuffer[1024];
-   sprintf(strBuffer,"for(int batchIndex = updateIndex ; batchIndex < (updateIndex+batchSize) && batchIndex < %s.size() ; batchIndex++){",getUpdatesId()->getIdentifier());
-   main.pushstr_newL(strBuffer);
-   sprintf(strBuffer, "if(%s[batchIndex].type == 'a')",getUpdatesId()->getIdentifier());
-   main.pushstr_newL(strBuffer);
-   main.pushstr_newL("{");
-   sprintf(strBuffer, "update %s = %s[batchIndex] ;",onAddStmt->getIteratorId()->getIdentifier(), getUpdatesId()->getIdentifier());
+   /* net adds of the prepared batch, grouped by source like OnDelete */
+   sprintf(strBuffer,"for (const update& %s : %s_slack.getAddsFromBatch(updateIndex, batchElements, %s)){",onAddStmt->getIteratorId()->getIdentifier(),graphId[curFuncType][curFuncCount()][0]->getIdentifier(),getUpdatesId()->getIdentifier());
    main.pushstr_newL(strBuffer);
    generateBlock(onAddStmt->getStatements(),false);
    main.NewLine();
    main.pushstr_newL("}");
-   main.pushstr_newL("}");
 
    resetPreprocessEnv();
 
@@ -140,6 +131,17 @@ void dsl_dyn_cpp_generator::generateBatchBlock(batchBlock* batchStmt, bool isMai
   if(updateId != NULL)
     {
       setBatchEnvIds(updateId); //TODO: need to set batchsize's Id as well.
+      /* the batches update the graph through a slack CSR (slackCSR.hpp),
+         which hands g back as a plain CSR when the block closes; it also
+         prepares each batch (sorted, collapsed, grouped by source) for
+         currentBatch() */
+      Identifier* graphVar = graphId[curFuncType][curFuncCount()][0];
+      main.pushstr_newL("{");
+      sprintf(strBuffer,"slackCSR<graph, update> %s_slack(%s);",graphVar->getIdentifier(),graphVar->getIdentifier());
+      main.pushstr_newL(strBuffer);
+      /* answers findEdge/edgeAt on g, rebuilt after every updateCSR* */
+      sprintf(strBuffer,"edgeIndex<graph> %s_index(%s);",graphVar->getIdentifier(),graphVar->getIdentifier());
+      main.pushstr_newL(strBuffer);
       main.pushString("int batchSize = ");
       generateExpr(batchStmt->getBatchSizeExpr(),false);
       main.pushstr_newL(";");
@@ -164,6 +166,7 @@ void dsl_dyn_cpp_generator::generateBatchBlock(batchBlock* batchStmt, bool isMai
      // generateFreeInCurrentBatch();
      //freeIdStore.pop_back();
       main.pushstr_newL("}");
+      main.pushstr_newL("}");
 
       resetBatchEnv();
 
@@ -176,6 +179,964 @@ void dsl_dyn_cpp_generator::generateBatchBlock(batchBlock* batchStmt, bool isMai
 
 }
 
+/* Props whose attach*Property call sits inside a loop get re-initialised on
+   every iteration (per source, per batch). They are lowered to epochProp<T>
+   (graphcode/epochProp.hpp) whose reset is O(1), and their declarations are
+   hoisted to the top of the function so the storage outlives the loop.
+   Bool props on this path are stored as bitProp (graphcode/bitProp.hpp),
+   whose reset is a fill of V/64 or E/64 words. The ones a kernel also
+   reads or writes are kept on this path with shared storage, see
+   markDeviceEpochProps. */
+void dsl_dyn_cpp_generator::collectEpochProps(statement* stmt, Function* func, int loopDepth)
+{
+  if(stmt == NULL)
+    return;
+
+  if(stmt->getTypeofNode() == NODE_BLOCKSTMT)
+    {
+      list<statement*> stmtList = ((blockStatement*)stmt)->returnStatements();
+      for(statement* s : stmtList)
+        collectEpochProps(s, func, loopDepth);
+    }
+  if(stmt->getTypeofNode() == NODE_DECL)
+    {
+      declaration* declStmt = (declaration*)stmt;
+      if(declStmt->getType()->isPropType())
+        {
+          hoistedPropDecls[func].push_back(declStmt);
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_PROCCALLSTMT && loopDepth > 0)
+    {
+      proc_callExpr* proc = ((proc_callStmt*)stmt)->getProcCallExpr();
+      string methodId(proc->getMethodId()->getIdentifier());
+      if(methodId == "attachNodeProperty" || methodId == "attachEdgeProperty")
+        {
+          list<argument*> argList = proc->getArgList();
+          for(argument* arg : argList)
+            {
+              if(arg->getAssignExpr() != NULL)
+                 epochProps.insert(arg->getAssignExpr()->getId()->getSymbolInfo()->getId());
+            }
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_IFSTMT)
+    {
+      collectEpochProps(((ifStmt*)stmt)->getIfBody(), func, loopDepth);
+      collectEpochProps(((ifStmt*)stmt)->getElseBody(), func, loopDepth);
+    }
+  if(stmt->getTypeofNode() == NODE_FORALLSTMT)
+     collectEpochProps(((forallStmt*)stmt)->getBody(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_WHILESTMT)
+     collectEpochProps(((whileStmt*)stmt)->getBody(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_DOWHILESTMT)
+     collectEpochProps(((dowhileStmt*)stmt)->getBody(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_FIXEDPTSTMT)
+     collectEpochProps(((fixedPointStmt*)stmt)->getBody(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_ITRBFS)
+     collectEpochProps(((iterateBFS*)stmt)->getBody(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_BATCHBLOCKSTMT)
+     collectEpochProps(((batchBlock*)stmt)->getStatements(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_ONADDBLOCK)
+     collectEpochProps(((onAddBlock*)stmt)->getStatements(), func, loopDepth + 1);
+  if(stmt->getTypeofNode() == NODE_ONDELETEBLOCK)
+     collectEpochProps(((onDeleteBlock*)stmt)->getStatements(), func, loopDepth + 1);
+}
+
+/* an epoch prop handed to Incremental/Decremental must be received as one.
+   Every prop arg/param pair is also kept for the range analysis, since both
+   names refer to the same storage. */
+void dsl_dyn_cpp_generator::markEpochArgs(Expression* expr)
+{
+  if(expr == NULL || expr->getExpressionFamily() != EXPR_PROCCALL)
+    return;
+
+  proc_callExpr* proc = (proc_callExpr*)expr;
+  string methodId(proc->getMethodId()->getIdentifier());
+  int calleeType;
+  if(methodId == "Incremental")
+    calleeType = INCREMENTAL_FUNC;
+  else if(methodId == "Decremental")
+    calleeType = DECREMENTAL_FUNC;
+  else
+    return;
+
+  list<Function*> funcList = frontEndContext.getFuncList();
+  for(Function* func : funcList)
+    {
+      if(func->getFuncType() != calleeType)
+        continue;
+
+      list<argument*> argList = proc->getArgList();
+      list<formalParam*> paramList = func->getParamList();
+      list<formalParam*>::iterator paramItr = paramList.begin();
+      for(argument* arg : argList)
+        {
+          if(paramItr == paramList.end())
+            break;
+          Expression* argExpr = arg->getExpr();
+          Identifier* paramId = (*paramItr)->getIdentifier()->getSymbolInfo()->getId();
+          if(argExpr != NULL && argExpr->isIdentifierExpr() && (*paramItr)->getType()->isPropType())
+            {
+              Identifier* argId = argExpr->getId()->getSymbolInfo()->getId();
+              epochArgLinks.push_back(make_pair(argId, paramId));
+              if(isEpochProp(argId))
+                 epochProps.insert(paramId);
+            }
+          paramItr++;
+        }
+    }
+}
+
+void dsl_dyn_cpp_generator::propagateEpochProps(statement* stmt)
+{
+  if(stmt == NULL)
+    return;
+
+  if(stmt->getTypeofNode() == NODE_BLOCKSTMT)
+    {
+      list<statement*> stmtList = ((blockStatement*)stmt)->returnStatements();
+      for(statement* s : stmtList)
+        propagateEpochProps(s);
+    }
+  if(stmt->getTypeofNode() == NODE_ASSIGN)
+     markEpochArgs(((assignment*)stmt)->getExpr());
+  if(stmt->getTypeofNode() == NODE_DECL && ((declaration*)stmt)->isInitialized())
+     markEpochArgs(((declaration*)stmt)->getExpressionAssigned());
+  if(stmt->getTypeofNode() == NODE_PROCCALLSTMT)
+     markEpochArgs(((proc_callStmt*)stmt)->getProcCallExpr());
+  if(stmt->getTypeofNode() == NODE_IFSTMT)
+    {
+      propagateEpochProps(((ifStmt*)stmt)->getIfBody());
+      propagateEpochProps(((ifStmt*)stmt)->getElseBody());
+    }
+  if(stmt->getTypeofNode() == NODE_FORALLSTMT)
+     propagateEpochProps(((forallStmt*)stmt)->getBody());
+  if(stmt->getTypeofNode() == NODE_WHILESTMT)
+     propagateEpochProps(((whileStmt*)stmt)->getBody());
+  if(stmt->getTypeofNode() == NODE_DOWHILESTMT)
+     propagateEpochProps(((dowhileStmt*)stmt)->getBody());
+  if(stmt->getTypeofNode() == NODE_FIXEDPTSTMT)
+     propagateEpochProps(((fixedPointStmt*)stmt)->getBody());
+  if(stmt->getTypeofNode() == NODE_BATCHBLOCKSTMT)
+     propagateEpochProps(((batchBlock*)stmt)->getStatements());
+}
+
+/* props read or written by a forall body: those run as a CUDA kernel and
+   are passed as d_<prop>, so they must keep their device arrays. The
+   functions holding a kernel also get a device CSR, see generateCSRArrays. */
+void dsl_dyn_cpp_generator::collectKernelProps(statement* stmt, Function* func)
+{
+  if(stmt == NULL)
+    return;
+
+  if(stmt->getTypeofNode() == NODE_BLOCKSTMT)
+    {
+      list<statement*> stmtList = ((blockStatement*)stmt)->returnStatements();
+      for(statement* s : stmtList)
+        collectKernelProps(s, func);
+    }
+  if(stmt->getTypeofNode() == NODE_FORALLSTMT)
+    {
+      forallStmt* forAll = (forallStmt*)stmt;
+      if(!forAll->isForall() || (func->getFuncType() != STATIC_FUNC && forAll->getMapLocal().size() > 0))
+        {
+          /* host loops (isHostForall) launch nothing */
+          collectKernelProps(forAll->getBody(), func);
+          return;
+        }
+
+      kernelFuncs.insert(func);
+      usedVariables usedVars = getVarsForAll(forAll);
+      list<Identifier*> vars = usedVars.getVariables();
+      for(Identifier* iden : vars)
+        {
+          if(iden->getSymbolInfo() != NULL && iden->getSymbolInfo()->getType()->isPropType())
+            kernelProps.insert(iden->getSymbolInfo()->getId());
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_IFSTMT)
+    {
+      collectKernelProps(((ifStmt*)stmt)->getIfBody(), func);
+      collectKernelProps(((ifStmt*)stmt)->getElseBody(), func);
+    }
+  if(stmt->getTypeofNode() == NODE_WHILESTMT)
+     collectKernelProps(((whileStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_DOWHILESTMT)
+     collectKernelProps(((dowhileStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_FIXEDPTSTMT)
+     collectKernelProps(((fixedPointStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_ITRBFS)
+     collectKernelProps(((iterateBFS*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_BATCHBLOCKSTMT)
+     collectKernelProps(((batchBlock*)stmt)->getStatements(), func);
+  if(stmt->getTypeofNode() == NODE_ONADDBLOCK)
+     collectKernelProps(((onAddBlock*)stmt)->getStatements(), func);
+  if(stmt->getTypeofNode() == NODE_ONDELETEBLOCK)
+     collectKernelProps(((onDeleteBlock*)stmt)->getStatements(), func);
+}
+
+/* An epoch prop that a kernel touches keeps its O(1) reset: it is built
+   on the pool's CUDA managed buffers and the kernels get deviceView(prop)
+   (graphcode/deviceProp.hpp) in place of d_<prop>, a bitView for bool
+   props. The per-batch modified_del/modified_add flags of the dynamic TC
+   take this path: they are attached in Batch, set by the host loops of
+   OnDelete/OnAdd and read by the update kernels of Decremental/Incremental.
+
+   Both ends of an Incremental/Decremental link name the same storage, so
+   first a link whose ends disagree on being epoch props loses both, and
+   then device-ness spreads along the links until the types agree. */
+void dsl_dyn_cpp_generator::markDeviceEpochProps()
+{
+  bool changed = true;
+  while(changed)
+    {
+      changed = false;
+      for(pair<Identifier*, Identifier*> link : epochArgLinks)
+        {
+          if(isEpochProp(link.first) == isEpochProp(link.second))
+            continue;
+          epochProps.erase(link.first->getSymbolInfo()->getId());
+          epochProps.erase(link.second->getSymbolInfo()->getId());
+          changed = true;
+        }
+    }
+
+  for(Identifier* prop : kernelProps)
+    {
+      if(isEpochProp(prop))
+        deviceEpochProps.insert(prop);
+    }
+
+  changed = true;
+  while(changed)
+    {
+      changed = false;
+      for(pair<Identifier*, Identifier*> link : epochArgLinks)
+        {
+          if(isDeviceEpochProp(link.first) == isDeviceEpochProp(link.second))
+            continue;
+          deviceEpochProps.insert(link.first->getSymbolInfo()->getId());
+          deviceEpochProps.insert(link.second->getSymbolInfo()->getId());
+          changed = true;
+        }
+    }
+}
+
+bool dsl_dyn_cpp_generator::isEpochProp(Identifier* id)
+{
+  if(id == NULL || id->getSymbolInfo() == NULL)
+    return false;
+
+  return epochProps.find(id->getSymbolInfo()->getId()) != epochProps.end();
+}
+
+bool dsl_dyn_cpp_generator::isDeviceEpochProp(Identifier* id)
+{
+  if(id == NULL || id->getSymbolInfo() == NULL)
+    return false;
+
+  return deviceEpochProps.find(id->getSymbolInfo()->getId()) != deviceEpochProps.end();
+}
+
+/* kernel parameter of a prop: its deviceView, or the plain d_<prop> array */
+string dsl_dyn_cpp_generator::kernelPropType(Identifier* id, Type* type)
+{
+  if(!isDeviceEpochProp(id))
+    return convertToCppType(type);
+  if(type->getInnerTargetType()->gettypeId() == TYPE_BOOL)
+    return "bitView";
+
+  string viewType = "epochView<";
+  viewType = viewType + narrowedType(id, type);
+  viewType = viewType + ">";
+  return viewType;
+}
+
+void dsl_dyn_cpp_generator::generateKernelPropArg(Identifier* id)
+{
+  char strBuffer[1024];
+  if(isDeviceEpochProp(id))
+    sprintf(strBuffer, ",deviceView(%s)", id->getIdentifier());
+  else
+    sprintf(strBuffer, ",d_%s", id->getIdentifier());
+  main.pushString(strBuffer);
+}
+
+string dsl_dyn_cpp_generator::epochPropType(Identifier* id, Type* type)
+{
+  if(type->getInnerTargetType()->gettypeId() == TYPE_BOOL)
+    return "bitProp";
+
+  string propType = "epochProp<";
+  propType = propType + narrowedType(id, type);
+  propType = propType + ">";
+  return propType;
+}
+
+/* the storage comes from the graph's property pool (propPool.hpp), so the
+   props of one Incremental/Decremental call reuse the buffers of the last.
+   The Dynamic function owns the pool's scope: its propPoolScope is declared
+   first, so it is destroyed after every prop and unmaps what is cached.
+   The device CSR the kernels share (generateCSRArrays) is scoped there too. */
+void dsl_dyn_cpp_generator::generateEpochPropDecls(Function* func)
+{
+  char strBuffer[1024];
+  const char* gId = graphId[curFuncType][curFuncCount()][0]->getIdentifier();
+  if(func->getFuncType() == DYNAMIC_FUNC)
+    {
+      sprintf(strBuffer, "propPoolScope %s_pool(%s);", gId, gId);
+      main.pushstr_newL(strBuffer);
+      if(!kernelFuncs.empty())
+        {
+          sprintf(strBuffer, "deviceCSRScope %s_deviceScope(%s);", gId, gId);
+          main.pushstr_newL(strBuffer);
+        }
+    }
+
+  vector<declaration*> declList = hoistedPropDecls[func];
+  for(declaration* declStmt : declList)
+    {
+      if(!isEpochProp(declStmt->getdeclId()))
+        continue;
+
+      if(isDeviceEpochProp(declStmt->getdeclId()))
+        sprintf(strBuffer, "%s %s(propPoolFor(%s), true);", epochPropType(declStmt->getdeclId(), declStmt->getType()).c_str(), declStmt->getdeclId()->getIdentifier(), gId);
+      else
+        sprintf(strBuffer, "%s %s(propPoolFor(%s));", epochPropType(declStmt->getdeclId(), declStmt->getType()).c_str(), declStmt->getdeclId()->getIdentifier(), gId);
+      main.pushstr_newL(strBuffer);
+    }
+}
+
+/* attach on an epoch prop only bumps its epoch (and grows it with the graph) */
+bool dsl_dyn_cpp_generator::generateEpochPropAttach(proc_callStmt* procStmt, bool isMainFile)
+{
+  char strBuffer[1024];
+  proc_callExpr* proc = procStmt->getProcCallExpr();
+  string methodId(proc->getMethodId()->getIdentifier());
+  if(methodId != "attachNodeProperty" && methodId != "attachEdgeProperty")
+    return false;
+
+  list<argument*> argList = proc->getArgList();
+  bool hasEpochProp = false;
+  for(argument* arg : argList)
+    {
+      if(arg->getAssignExpr() != NULL && isEpochProp(arg->getAssignExpr()->getId()))
+        hasEpochProp = true;
+    }
+  if(!hasEpochProp)
+    return false;
+
+  const char* sizeFunc = (methodId == "attachNodeProperty") ? "num_nodes" : "num_edges";
+  for(argument* arg : argList)
+    {
+      assignment* assign = arg->getAssignExpr();
+      if(assign == NULL)
+        continue;
+
+      Identifier* propId = assign->getId();
+      if(!isEpochProp(propId))
+        {
+          generateInitkernel1(assign, isMainFile);
+          continue;
+        }
+
+      string innerType = narrowedType(propId, propId->getSymbolInfo()->getType());
+      sprintf(strBuffer, "%s.reset((%s)", propId->getIdentifier(), innerType.c_str());
+      main.pushString(strBuffer);
+      generateExpr(assign->getExpr(), isMainFile);
+      sprintf(strBuffer, ", %s.%s());", proc->getId1()->getIdentifier(), sizeFunc);
+      main.pushstr_newL(strBuffer);
+    }
+
+  return true;
+}
+
+void dsl_dyn_cpp_generator::generateEpochParamList(Function* func, dslCodePad& targetFile)
+{
+  char strBuffer[1024];
+  list<formalParam*> paramList = func->getParamList();
+  list<formalParam*>::iterator itr;
+  for(itr = paramList.begin(); itr != paramList.end(); itr++)
+    {
+      Identifier* paramId = (*itr)->getIdentifier();
+      Type* type = (*itr)->getType();
+      if(itr != paramList.begin())
+        targetFile.pushString(", ");
+
+      if(type->isPropType() && isEpochProp(paramId))
+        sprintf(strBuffer, "%s& %s", epochPropType(paramId, type).c_str(), paramId->getIdentifier());
+      else
+        sprintf(strBuffer, "%s %s", convertToCppType(type), paramId->getIdentifier());
+      targetFile.pushString(strBuffer);
+    }
+}
+
+/* filter(v.prop == True) over g.nodes() with a bitProp prop: returns the
+   prop so a host for-loop can walk its set bits instead of testing every
+   node. setBits() is sequential, so a forall keeps its kernel and filter. */
+Identifier* dsl_dyn_cpp_generator::getBitFilterProp(forallStmt* forAll)
+{
+  if(forAll->isForall() || !forAll->hasFilterExpr() || !forAll->isSourceProcCall())
+    return NULL;
+
+  string methodId(forAll->getExtractElementFunc()->getMethodId()->getIdentifier());
+  if(methodId != "nodes")
+    return NULL;
+
+  Expression* filterExpr = forAll->getfilterExpr();
+  if(filterExpr->getExpressionFamily() != EXPR_RELATIONAL || filterExpr->getOperatorType() != OPERATOR_EQ)
+    return NULL;
+
+  Expression* lhs = filterExpr->getLeft();
+  Expression* rhs = filterExpr->getRight();
+  if(!lhs->isPropIdExpr() || rhs->getExpressionFamily() != EXPR_BOOLCONSTANT || !rhs->getBooleanConstant())
+    return NULL;
+
+  PropAccess* propId = lhs->getPropId();
+  if(strcmp(propId->getIdentifier1()->getIdentifier(), forAll->getIterator()->getIdentifier()) != 0)
+    return NULL;
+
+  Identifier* prop = propId->getIdentifier2();
+  if(!isEpochProp(prop) || prop->getSymbolInfo()->getType()->getInnerTargetType()->gettypeId() != TYPE_BOOL)
+    return NULL;
+
+  return prop;
+}
+
+/* Value-range analysis for the width of epoch props.
+
+   Each int/long/node prop gets the join of everything written to it: a
+   constant interval, or a bound in terms of the graph size when it holds
+   node ids, out-degrees, or is a counter stepped a constant amount inside a
+   g.nodes()/neighbour loop. A prop with no recorded write is the empty
+   interval (lo > hi). Anything the analysis cannot follow (reductions,
+   INF, opaque calls, counters under while/fixedPoint/batch loops) is
+   RANGE_NONE and keeps its declared type.
+
+   NODES/EDGES ranges carry a constant part: [lo, hi] there stands for
+   [lo - V, hi + V] (E for edges). The largest constant part is handed to
+   dispatchPropWidths as slack. */
+valueRange dsl_dyn_cpp_generator::joinRange(valueRange a, valueRange b)
+{
+  if(a.bound == RANGE_CONST && a.lo > a.hi)
+    return b;
+  if(b.bound == RANGE_CONST && b.lo > b.hi)
+    return a;
+
+  valueRange joined;
+  joined.bound = max(a.bound, b.bound);
+  joined.lo = min(a.lo, b.lo);
+  joined.hi = max(a.hi, b.hi);
+
+  /* the constant part is added to V or E in the run-time dispatch */
+  if((joined.bound == RANGE_NODES || joined.bound == RANGE_EDGES) && (joined.lo < INT_MIN / 2 || joined.hi > INT_MAX / 2))
+    joined.bound = RANGE_NONE;
+  if(joined.bound == RANGE_CONST && (joined.lo < LONG_MIN / 4 || joined.hi > LONG_MAX / 4))
+    joined.bound = RANGE_NONE;
+  return joined;
+}
+
+valueRange dsl_dyn_cpp_generator::getPropRange(Identifier* prop)
+{
+  valueRange empty = {RANGE_CONST, 1, 0};
+  map<Identifier*, valueRange>::iterator itr = propRanges.find(prop->getSymbolInfo()->getId());
+  return itr == propRanges.end() ? empty : itr->second;
+}
+
+/* next int8/int16/int32 limit at or beyond v */
+static long widenLimit(long v)
+{
+  long upper[] = {INT8_MAX, INT16_MAX, INT32_MAX, LONG_MAX / 4};
+  long lower[] = {INT8_MIN, INT16_MIN, INT32_MIN, LONG_MIN / 4};
+  for(int i = 0; i < 4; i++)
+    {
+      if(v >= 0 && v <= upper[i])
+        return upper[i];
+      if(v < 0 && v >= lower[i])
+        return lower[i];
+    }
+  return v;
+}
+
+/* A bound that keeps moving (p.x = q.x + 1 around a cycle of props) is
+   widened to the next type limit after its second change, so every prop
+   reaches a fixpoint in a few passes without losing its width. */
+void dsl_dyn_cpp_generator::widenPropRange(Identifier* prop, valueRange range)
+{
+  Identifier* propKey = prop->getSymbolInfo()->getId();
+  valueRange current = getPropRange(prop);
+  valueRange widened = joinRange(current, range);
+  if(widened.bound == current.bound && widened.lo == current.lo && widened.hi == current.hi)
+    return;
+
+  if(current.lo <= current.hi && widened.bound != RANGE_NONE && ++rangeUpdates[propKey] > 2)
+    {
+      valueRange limit = widened;
+      if(widened.lo < current.lo)
+        limit.lo = widenLimit(widened.lo);
+      if(widened.hi > current.hi)
+        limit.hi = widenLimit(widened.hi);
+      widened = joinRange(current, limit);
+    }
+  propRanges[propKey] = widened;
+  changedProps.insert(propKey);
+}
+
+valueRange dsl_dyn_cpp_generator::evalRange(Expression* expr)
+{
+  valueRange range = {RANGE_NONE, 0, 0};
+  if(expr == NULL)
+    return range;
+
+  int family = expr->getExpressionFamily();
+  if(family == EXPR_INTCONSTANT || family == EXPR_LONGCONSTANT)
+    {
+      range.bound = RANGE_CONST;
+      range.lo = range.hi = expr->getIntegerConstant();
+    }
+  else if(family == EXPR_BOOLCONSTANT)
+    {
+      range.bound = RANGE_CONST;
+      range.lo = 0;
+      range.hi = 1;
+    }
+  else if(family == EXPR_ID)
+    {
+      Type* type = expr->getId()->getSymbolInfo()->getType();
+      if(type->isNodeType())
+        range.bound = RANGE_NODES;
+      else if(type->isEdgeType())
+        range.bound = RANGE_EDGES;
+      else if(type->isPropType())
+        range = getPropRange(expr->getId());
+    }
+  else if(family == EXPR_PROPID)
+     range = getPropRange(expr->getPropId()->getIdentifier2());
+  else if(family == EXPR_PROCCALL)
+    {
+      string methodId(((proc_callExpr*)expr)->getMethodId()->getIdentifier());
+      if(methodId == "count_outNbrs")
+        range.bound = RANGE_NODES;
+    }
+  else if(family == EXPR_ARITHMETIC)
+    {
+      int op = expr->getOperatorType();
+      valueRange left = evalRange(expr->getLeft());
+      valueRange right = evalRange(expr->getRight());
+      if(op != OPERATOR_ADD && op != OPERATOR_SUB && op != OPERATOR_MUL)
+        return range;
+      if(left.bound == RANGE_NONE || right.bound == RANGE_NONE)
+        return range;
+      if(left.lo > left.hi || right.lo > right.hi)
+        return range;
+      if(op == OPERATOR_MUL && (left.bound != RANGE_CONST || right.bound != RANGE_CONST))
+        return range;
+      if(op == OPERATOR_SUB && right.bound != RANGE_CONST)
+        return range;
+      if(op == OPERATOR_MUL && (labs(left.lo) > INT_MAX || labs(left.hi) > INT_MAX || labs(right.lo) > INT_MAX || labs(right.hi) > INT_MAX))
+        return range;
+
+      valueRange result;
+      result.bound = max(left.bound, right.bound);
+      if(op == OPERATOR_ADD)
+        {
+          result.lo = left.lo + right.lo;
+          result.hi = left.hi + right.hi;
+        }
+      else if(op == OPERATOR_SUB)
+        {
+          result.lo = left.lo - right.hi;
+          result.hi = left.hi - right.lo;
+        }
+      else
+        {
+          long products[4] = {left.lo * right.lo, left.lo * right.hi, left.hi * right.lo, left.hi * right.hi};
+          result.lo = *min_element(products, products + 4);
+          result.hi = *max_element(products, products + 4);
+        }
+      /* a sum of two graph-size bounds is no longer bounded by either */
+      if(left.bound != RANGE_CONST && right.bound != RANGE_CONST)
+        result.bound = RANGE_NONE;
+      valueRange empty = {RANGE_CONST, 1, 0};
+      range = joinRange(empty, result);
+    }
+
+  return range;
+}
+
+/* p.x = q.x + c, p.x = c + q.x, p.x = q.x - c: the value written is an
+   element of the same prop moved by c, so each executed assignment moves
+   the prop's extremes by at most c, as for a counter (p.x = p.x + 1) or a
+   BFS level (v.level = u.level + 1) */
+bool dsl_dyn_cpp_generator::isCounterUpdate(assignment* asst, long& step)
+{
+  Expression* expr = asst->getExpr();
+  if(expr == NULL || expr->getExpressionFamily() != EXPR_ARITHMETIC)
+    return false;
+
+  int op = expr->getOperatorType();
+  Expression* self = expr->getLeft();
+  Expression* inc = expr->getRight();
+  if(op == OPERATOR_ADD && inc->isPropIdExpr())
+    {
+      self = expr->getRight();
+      inc = expr->getLeft();
+    }
+  if((op != OPERATOR_ADD && op != OPERATOR_SUB) || !self->isPropIdExpr() || inc->getExpressionFamily() != EXPR_INTCONSTANT)
+    return false;
+
+  PropAccess* lhs = asst->getPropId();
+  PropAccess* rhs = self->getPropId();
+  if(lhs->getIdentifier2()->getSymbolInfo()->getId() != rhs->getIdentifier2()->getSymbolInfo()->getId())
+    return false;
+
+  step = (op == OPERATOR_ADD) ? inc->getIntegerConstant() : -inc->getIntegerConstant();
+  return true;
+}
+
+/* A counter moves by step once per iteration of the enclosing loops: one
+   node loop bounds it by V, a node loop around a neighbour loop by E.
+   Params are stepped again on every call, so they are never bounded here. */
+valueRange dsl_dyn_cpp_generator::counterRange(Identifier* prop, long step, vector<int>& loopKinds)
+{
+  valueRange range = {RANGE_NONE, 0, 0};
+  list<formalParam*> paramList = currentFunc->getParamList();
+  for(formalParam* param : paramList)
+    {
+      if(param->getIdentifier()->getSymbolInfo()->getId() == prop->getSymbolInfo()->getId())
+        return range;
+    }
+
+  int nodeLoops = 0;
+  int nbrLoops = 0;
+  for(int kind : loopKinds)
+    {
+      if(kind == LOOP_OTHER)
+        return range;
+      if(kind == LOOP_NODES)
+        nodeLoops++;
+      else
+        nbrLoops++;
+    }
+
+  valueRange current = getPropRange(prop);
+  if(loopKinds.empty())
+    {
+      if(current.lo > current.hi || current.bound == RANGE_NONE)
+        return current;
+      valueRange stepped = current;
+      stepped.lo = current.lo + step;
+      stepped.hi = current.hi + step;
+      return joinRange(current, stepped);
+    }
+
+  if(step < -1 || step > 1 || current.bound == RANGE_NONE)
+    return range;
+  if(nodeLoops + nbrLoops == 1)
+    range.bound = RANGE_NODES;
+  else if(nodeLoops == 1 && nbrLoops == 1)
+    range.bound = RANGE_EDGES;
+  else
+    return range;
+
+  range.lo = (current.lo > current.hi) ? 0 : current.lo;
+  range.hi = (current.lo > current.hi) ? 0 : current.hi;
+  return joinRange(current, range);
+}
+
+/* props handed to any other procedure may be written there */
+void dsl_dyn_cpp_generator::widenOpaqueArgs(Expression* expr)
+{
+  if(expr == NULL || expr->getExpressionFamily() != EXPR_PROCCALL)
+    return;
+
+  proc_callExpr* proc = (proc_callExpr*)expr;
+  string methodId(proc->getMethodId()->getIdentifier());
+  if(methodId == "Incremental" || methodId == "Decremental" || methodId == "attachNodeProperty" || methodId == "attachEdgeProperty")
+    return;
+
+  valueRange unknown = {RANGE_NONE, 0, 0};
+  list<argument*> argList = proc->getArgList();
+  for(argument* arg : argList)
+    {
+      Expression* argExpr = arg->getExpr();
+      if(argExpr != NULL && argExpr->isIdentifierExpr() && argExpr->getId()->getSymbolInfo()->getType()->isPropType())
+         widenPropRange(argExpr->getId(), unknown);
+    }
+}
+
+void dsl_dyn_cpp_generator::analyseRanges(statement* stmt, vector<int>& loopKinds)
+{
+  if(stmt == NULL)
+    return;
+
+  valueRange unknown = {RANGE_NONE, 0, 0};
+  if(stmt->getTypeofNode() == NODE_BLOCKSTMT)
+    {
+      list<statement*> stmtList = ((blockStatement*)stmt)->returnStatements();
+      for(statement* s : stmtList)
+        analyseRanges(s, loopKinds);
+    }
+  if(stmt->getTypeofNode() == NODE_DECL)
+    {
+      declaration* declStmt = (declaration*)stmt;
+      if(declStmt->isInitialized())
+        {
+          widenOpaqueArgs(declStmt->getExpressionAssigned());
+          if(declStmt->getType()->isPropType())
+             widenPropRange(declStmt->getdeclId(), unknown);
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_ASSIGN)
+    {
+      assignment* asst = (assignment*)stmt;
+      long step;
+      widenOpaqueArgs(asst->getExpr());
+      if(asst->lhs_isProp() && isCounterUpdate(asst, step))
+         widenPropRange(asst->getPropId()->getIdentifier2(), counterRange(asst->getPropId()->getIdentifier2(), step, loopKinds));
+      else if(asst->lhs_isProp())
+         widenPropRange(asst->getPropId()->getIdentifier2(), evalRange(asst->getExpr()));
+      else if(asst->getId()->getSymbolInfo()->getType()->isPropType())
+         widenPropRange(asst->getId(), evalRange(asst->getExpr()));
+    }
+  if(stmt->getTypeofNode() == NODE_UNARYSTMT)
+    {
+      Expression* unaryExpr = ((unary_stmt*)stmt)->getUnaryExpr();
+      Expression* operand = unaryExpr->getUnaryExpr();
+      if(operand != NULL && operand->isPropIdExpr())
+        {
+          Identifier* prop = operand->getPropId()->getIdentifier2();
+          long step = (unaryExpr->getOperatorType() == OPERATOR_INC) ? 1 : -1;
+          widenPropRange(prop, counterRange(prop, step, loopKinds));
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_REDUCTIONCALLSTMT)
+    {
+      reductionCallStmt* reducStmt = (reductionCallStmt*)stmt;
+      if(reducStmt->getLhsType() == 2)
+         widenPropRange(reducStmt->getPropAccess()->getIdentifier2(), unknown);
+      if(reducStmt->getLhsType() == 3)
+        {
+          list<ASTNode*> leftList = reducStmt->getLeftList();
+          for(ASTNode* node : leftList)
+            {
+              if(node->getTypeofNode() == NODE_PROPACCESS)
+                 widenPropRange(((PropAccess*)node)->getIdentifier2(), unknown);
+            }
+        }
+    }
+  if(stmt->getTypeofNode() == NODE_PROCCALLSTMT)
+    {
+      proc_callExpr* proc = ((proc_callStmt*)stmt)->getProcCallExpr();
+      string methodId(proc->getMethodId()->getIdentifier());
+      if(methodId == "attachNodeProperty" || methodId == "attachEdgeProperty")
+        {
+          list<argument*> argList = proc->getArgList();
+          for(argument* arg : argList)
+            {
+              if(arg->getAssignExpr() != NULL)
+                 widenPropRange(arg->getAssignExpr()->getId(), evalRange(arg->getAssignExpr()->getExpr()));
+            }
+        }
+      else
+         widenOpaqueArgs(proc);
+    }
+  if(stmt->getTypeofNode() == NODE_IFSTMT)
+    {
+      analyseRanges(((ifStmt*)stmt)->getIfBody(), loopKinds);
+      analyseRanges(((ifStmt*)stmt)->getElseBody(), loopKinds);
+    }
+  if(stmt->getTypeofNode() == NODE_FORALLSTMT)
+    {
+      forallStmt* forAll = (forallStmt*)stmt;
+      int kind = LOOP_OTHER;
+      if(forAll->isSourceProcCall())
+        {
+          char* methodId = forAll->getExtractElementFunc()->getMethodId()->getIdentifier();
+          if(strcmp(methodId, "nodes") == 0)
+            kind = LOOP_NODES;
+          else if(neighbourIteration(methodId))
+            kind = LOOP_NBRS;
+        }
+      loopKinds.push_back(kind);
+      analyseRanges(forAll->getBody(), loopKinds);
+      loopKinds.pop_back();
+    }
+  if(stmt->getTypeofNode() == NODE_ITRBFS)
+    {
+      iterateBFS* bfs = (iterateBFS*)stmt;
+      loopKinds.push_back(LOOP_NODES);
+      analyseRanges(bfs->getBody(), loopKinds);
+      if(bfs->getRBFS() != NULL)
+         analyseRanges(bfs->getRBFS()->getBody(), loopKinds);
+      loopKinds.pop_back();
+    }
+
+  statement* otherBody = NULL;
+  if(stmt->getTypeofNode() == NODE_WHILESTMT)
+     otherBody = ((whileStmt*)stmt)->getBody();
+  if(stmt->getTypeofNode() == NODE_DOWHILESTMT)
+     otherBody = ((dowhileStmt*)stmt)->getBody();
+  if(stmt->getTypeofNode() == NODE_FIXEDPTSTMT)
+     otherBody = ((fixedPointStmt*)stmt)->getBody();
+  if(stmt->getTypeofNode() == NODE_BATCHBLOCKSTMT)
+     otherBody = ((batchBlock*)stmt)->getStatements();
+  if(stmt->getTypeofNode() == NODE_ONADDBLOCK)
+     otherBody = ((onAddBlock*)stmt)->getStatements();
+  if(stmt->getTypeofNode() == NODE_ONDELETEBLOCK)
+     otherBody = ((onDeleteBlock*)stmt)->getStatements();
+  if(otherBody != NULL)
+    {
+      loopKinds.push_back(LOOP_OTHER);
+      analyseRanges(otherBody, loopKinds);
+      loopKinds.pop_back();
+    }
+}
+
+/* Iterated to a fixpoint since ranges flow between props (p.x = q.x + 1)
+   and across Incremental/Decremental calls. Props passed in from outside
+   the dynamic functions are unknown. Props still moving after 8 passes
+   are set to unknown, which is stable, and the others are iterated on. */
+void dsl_dyn_cpp_generator::analysePropRanges()
+{
+  valueRange unknown = {RANGE_NONE, 0, 0};
+  list<Function*> funcList = frontEndContext.getFuncList();
+  for(Function* func : funcList)
+    {
+      if(func->getFuncType() == STATIC_FUNC)
+        continue;
+      list<formalParam*> paramList = func->getParamList();
+      for(formalParam* param : paramList)
+        {
+          Identifier* paramId = param->getIdentifier()->getSymbolInfo()->getId();
+          bool linked = false;
+          for(pair<Identifier*, Identifier*> link : epochArgLinks)
+            {
+              if(link.second == paramId)
+                linked = true;
+            }
+          if(param->getType()->isPropType() && !linked)
+             widenPropRange(paramId, unknown);
+        }
+    }
+
+  int pass = 0;
+  do
+    {
+      changedProps.clear();
+      for(Function* func : funcList)
+        {
+          if(func->getFuncType() == STATIC_FUNC)
+            continue;
+          vector<int> loopKinds;
+          currentFunc = func;
+          analyseRanges(func->getBlockStatement(), loopKinds);
+        }
+      for(pair<Identifier*, Identifier*> link : epochArgLinks)
+        {
+          valueRange shared = joinRange(getPropRange(link.first), getPropRange(link.second));
+          widenPropRange(link.first, shared);
+          widenPropRange(link.second, shared);
+        }
+      pass++;
+      if(pass % 8 == 0)
+        {
+          for(Identifier* prop : changedProps)
+             propRanges[prop] = unknown;
+        }
+    } while(!changedProps.empty());
+
+  usesWidthTemplates = false;
+  for(Function* func : funcList)
+    {
+      if(func->getFuncType() != DYNAMIC_FUNC || func->containsReturn())
+        continue;
+      for(Identifier* prop : epochProps)
+        {
+          int bound = getPropRange(prop).bound;
+          if((bound == RANGE_NODES || bound == RANGE_EDGES) && !isDeviceEpochProp(prop))
+            usesWidthTemplates = true;
+        }
+    }
+}
+
+/* element type of an epoch prop: the smallest integer type holding its range */
+string dsl_dyn_cpp_generator::narrowedType(Identifier* prop, Type* type)
+{
+  Type* innerType = type->getInnerTargetType();
+  int typeId = innerType->gettypeId();
+  string declared(convertToCppType(innerType));
+  if(typeId != TYPE_INT && typeId != TYPE_LONG && typeId != TYPE_NODE)
+    return declared;
+
+  valueRange range = getPropRange(prop);
+  if(range.bound == RANGE_CONST && range.lo <= range.hi)
+    {
+      if(range.lo >= INT8_MIN && range.hi <= INT8_MAX)
+        return "int8_t";
+      if(range.lo >= INT16_MIN && range.hi <= INT16_MAX)
+        return "int16_t";
+      if(range.lo >= INT32_MIN && range.hi <= INT32_MAX)
+        return "int32_t";
+    }
+  /* kernels are not templated on the widths, so their props keep the
+     declared type past the constant cases */
+  if(isDeviceEpochProp(prop))
+    return declared;
+  if(range.bound == RANGE_NODES && usesWidthTemplates)
+    return "nodeval_t";
+  if(range.bound == RANGE_EDGES && usesWidthTemplates)
+    return "edgeval_t";
+  return declared;
+}
+
+/* The entry point keeps its name and signature and picks the widths once
+   from the graph size, see graphcode/propWidth.hpp */
+void dsl_dyn_cpp_generator::generateWidthDispatch(Function* dynFunc)
+{
+  char strBuffer[1024];
+  list<formalParam*> paramList = dynFunc->getParamList();
+  Identifier* graphParam = NULL;
+  string callArgs;
+  for(formalParam* param : paramList)
+    {
+      if(graphParam == NULL && param->getType()->isGraphType())
+        graphParam = param->getIdentifier();
+      if(!callArgs.empty())
+        callArgs = callArgs + ", ";
+      callArgs = callArgs + param->getIdentifier()->getIdentifier();
+    }
+  assert(graphParam != NULL);
+
+  long nodeSlack = 0;
+  long edgeSlack = 0;
+  for(Identifier* prop : epochProps)
+    {
+      valueRange range = getPropRange(prop);
+      long slack = max(labs(range.lo), labs(range.hi));
+      if(range.bound == RANGE_NODES)
+        nodeSlack = max(nodeSlack, slack);
+      if(range.bound == RANGE_EDGES)
+        edgeSlack = max(edgeSlack, slack);
+    }
+
+  main.NewLine();
+  main.pushString("void ");
+  main.pushString(dynFunc->getIdentifier()->getIdentifier());
+  main.push('(');
+  generateParamList(paramList, main);
+  main.pushstr_newL(")");
+  main.pushstr_newL("{");
+  sprintf(strBuffer, "dispatchPropWidths(%s.num_nodes(), %s.num_edges(), %ld, %ld, [&](auto widths)", graphParam->getIdentifier(), graphParam->getIdentifier(), nodeSlack, edgeSlack);
+  main.pushstr_newL(strBuffer);
+  main.pushstr_newL("{");
+  sprintf(strBuffer, "%s_impl<typename decltype(widths)::nodeval_t, typename decltype(widths)::edgeval_t>(%s);", dynFunc->getIdentifier()->getIdentifier(), callArgs.c_str());
+  main.pushstr_newL(strBuffer);
+  main.pushstr_newL("});");
+  main.pushstr_newL("}");
+}
+
 void dsl_dyn_cpp_generator::generateStatement(statement* stmt, bool isMainFile )
 { 
 
@@ -184,7 +1145,14 @@ void dsl_dyn_cpp_generator::generateStatement(statement* stmt, bool isMainFile )
     generateBlock((blockStatement*)stmt, false, isMainFile);
   }
   if (stmt->getTypeofNode() == NODE_DECL) {
-    generateVariableDecl((declaration*)stmt, isMainFile);
+    declaration* declStmt = (declaration*)stmt;
+    /* epoch props are declared once at function entry, see generateEpochPropDecls */
+    if (isConcurrentContainer(declStmt->getdeclId()))
+      generateConcurrentContainerDecl(declStmt, isMainFile);
+    else if (declStmt->getType()->isEdgeType() && isDynamicFuncType())
+      generateEdgeDecl(declStmt, isMainFile);
+    else if (!(declStmt->getType()->isPropType() && isEpochProp(declStmt->getdeclId())))
+      generateVariableDecl(declStmt, isMainFile);
   }
   if (stmt->getTypeofNode() == NODE_ASSIGN) {
     // generateAssignmentStmt((assignment*)stmt);
@@ -223,7 +1191,9 @@ void dsl_dyn_cpp_generator::generateStatement(statement* stmt, bool isMainFile )
     generateBFSAbstraction((iterateBFS*)stmt, isMainFile);
   }
   if (stmt->getTypeofNode() == NODE_PROCCALLSTMT) {
-    generateProcCall((proc_callStmt*)stmt, isMainFile);
+    if (!generateEpochPropAttach((proc_callStmt*)stmt, isMainFile))
+      generateProcCall((proc_callStmt*)stmt, isMainFile);
+    generateEdgeIndexRefresh((proc_callStmt*)stmt);
   }
   if (stmt->getTypeofNode() == NODE_UNARYSTMT) {
     unary_stmt* unaryStmt = (unary_stmt*)stmt;
@@ -265,9 +1235,33 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
   string methodId(proc->getMethodId()->getIdentifier());
    printf("HERE PRESENT %s\n",proc->getMethodId()->getIdentifier());
 
-  if(methodId=="get_edge")
+  if(methodId=="get_edge" && insideKernel && isDynamicFuncType())
   {
-   
+   /* in a kernel: the device loop's edge, else a search of the device row */
+   char strBuffer[1024];
+   list<argument*> argList=proc->getArgList();
+   string loopEdge = nbrLoopEdgeName(proc);
+   if(!loopEdge.empty())
+     header.pushString(loopEdge.c_str());
+   else
+     {
+       sprintf(strBuffer,"deviceEdgeAt(d_meta, d_data, d_weight, d_edgeIds, %s, %s)",argList.front()->getExpr()->getId()->getIdentifier(),argList.back()->getExpr()->getId()->getIdentifier());
+       header.pushString(strBuffer);
+     }
+  }
+  else if(methodId=="get_edge")
+  {
+   /* outside the source's neighbour loop there is no loop edge to name:
+      look the edge up instead of graph.hpp's getEdge row scan */
+   if(isDynamicFuncType() && !isNbrLoopEdge(proc))
+     {
+       char strBuffer[1024];
+       list<argument*> argList=proc->getArgList();
+       assert(argList.size()==2);
+       sprintf(strBuffer,"edgeAt(%s, %s, %s)",proc->getId1()->getIdentifier(),argList.front()->getExpr()->getId()->getIdentifier(),argList.back()->getExpr()->getId()->getIdentifier());
+       main.pushString(strBuffer);
+     }
+   else
    // if(curFuncType == INCREMENTAL_FUNC || curFuncType == DECREMENTAL_FUNC)
         getEdgeTranslation(expr);//uncomment it
     /*else    
@@ -281,8 +1275,12 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
          assert(argList.size()==1);
          Identifier* nodeId=argList.front()->getExpr()->getId();
          Identifier* objectId=proc->getId1();
-         sprintf(strBuffer,"(%s.%s[%s+1]-%s.%s[%s])",objectId->getIdentifier(),"indexofNodes",nodeId->getIdentifier(),objectId->getIdentifier(),"indexofNodes",nodeId->getIdentifier());
-         main.pushString(strBuffer);
+         /* the rows may hold slack slots (slackCSR.hpp) */
+         if(insideKernel && isDynamicFuncType())
+           sprintf(strBuffer,"deviceOutDegree(d_meta, d_data, %s)",nodeId->getIdentifier());
+         else
+           sprintf(strBuffer,"outDegree(%s, %s)",objectId->getIdentifier(),nodeId->getIdentifier());
+         currentPad().pushString(strBuffer);
        }
   else if(methodId=="is_an_edge")
      {
@@ -292,8 +1290,15 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
          Identifier* srcId=argList.front()->getExpr()->getId();
          Identifier* destId=argList.back()->getExpr()->getId();
          Identifier* objectId=proc->getId1();
-         sprintf(strBuffer,"%s.%s(%s, %s)",objectId->getIdentifier(),"check_if_nbr",srcId->getIdentifier(),destId->getIdentifier());
-         main.pushString(strBuffer);
+         /* a static function runs on the graph as loaded, no slack or
+            moved edges to look through */
+         if(insideKernel && isDynamicFuncType())
+           sprintf(strBuffer,"(deviceFindEdge(d_meta, d_data, d_edgeIds, %s, %s) >= 0)",srcId->getIdentifier(),destId->getIdentifier());
+         else if(isDynamicFuncType())
+           sprintf(strBuffer,"(findEdge(%s, %s, %s) >= 0)",objectId->getIdentifier(),srcId->getIdentifier(),destId->getIdentifier());
+         else
+           sprintf(strBuffer,"%s.%s(%s, %s)",objectId->getIdentifier(),"check_if_nbr",srcId->getIdentifier(),destId->getIdentifier());
+         currentPad().pushString(strBuffer);
          
      }
    else if(methodId == "updateCSRAdd" || methodId == "updateCSRDel") 
@@ -306,9 +1311,9 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
        Identifier* objectId=proc->getId1();
        assert(updateId->getSymbolInfo()->getType()->gettypeId() == TYPE_UPDATES);
        if(methodId == "updateCSRAdd")
-          sprintf(strBuffer,"%s.%s(%s, %s, %s)",objectId->getIdentifier(),"updateCSRAdd",updateId->getIdentifier(),"updateIndex","batchElements");
+          sprintf(strBuffer,"%s_slack.%s(%s, %s, %s)",objectId->getIdentifier(),"updateCSRAdd",updateId->getIdentifier(),"updateIndex","batchElements");
        else
-          sprintf(strBuffer,"%s.%s(%s, %s, %s)",objectId->getIdentifier(),"updateCSRDel",updateId->getIdentifier(),"updateIndex","batchElements");
+          sprintf(strBuffer,"%s_slack.%s(%s, %s, %s)",objectId->getIdentifier(),"updateCSRDel",updateId->getIdentifier(),"updateIndex","batchElements");
        main.pushString(strBuffer);
 
      }
@@ -322,9 +1327,9 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
           int updateType = argList.front()->getExpr()->getIntegerConstant();
 
           if(updateType == 0)
-             sprintf(strBuffer,"%s.%s(%s, %s, %s)",graphId[curFuncType][curFuncCount()][0]->getIdentifier(),"getDeletesFromBatch","updateIndex","batchSize",updatesId->getIdentifier());
+             sprintf(strBuffer,"%s_slack.%s(%s, %s, %s)",graphId[curFuncType][curFuncCount()][0]->getIdentifier(),"getDeletesFromBatch","updateIndex","batchElements",updatesId->getIdentifier());
           else
-             sprintf(strBuffer,"%s.%s(%s, %s, %s)",graphId[curFuncType][curFuncCount()][0]->getIdentifier(),"getAddsFromBatch","updateIndex","batchSize",updatesId->getIdentifier());
+             sprintf(strBuffer,"%s_slack.%s(%s, %s, %s)",graphId[curFuncType][curFuncCount()][0]->getIdentifier(),"getAddsFromBatch","updateIndex","batchElements",updatesId->getIdentifier());
           main.pushString(strBuffer);   
 
       }   
@@ -338,6 +1343,8 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
            if(methodId == "Decremental")
               sprintf(strBuffer, "%s_del", fileName);
            main.pushString(strBuffer);
+           if(usesWidthTemplates)
+              main.pushString("<nodeval_t, edgeval_t>");
            generateArgList(proc->getArgList(), true);   //uncomment it later  
 
         } 
@@ -356,13 +1363,27 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
                  sprintf(strBuffer,"%s.%s",objectId->getIdentifier(), getProcName(proc).c_str());    
           }
 
+          else if(indexExpr != NULL && parallelConstruct.size() > 0 && isConcurrentContainer(indexExpr->getMapExpr()->getId())
+                  && (methodId == "push" || methodId == "insert"))
+          {
+            /* x[i].push(v) in a host forall goes straight into x's concurrent map */
+            sprintf(strBuffer, "%s_pending.%s(", indexExpr->getMapExpr()->getId()->getIdentifier(),
+                    methodId == "push" ? "append" : "appendAll");
+            main.pushString(strBuffer);
+            generateExpr(indexExpr->getIndexExpr(), isMainFile);
+            main.pushString(", ");
+            generateArgList(argList, false);
+            main.pushString(")");
+            return;
+          }
+
           else if(indexExpr != NULL)
           {
             cout<<"ENTERED HERE FOR INDEXEXPR GENERATION DYNAMIC"<<"\n";
             Expression* mapExpr = indexExpr->getMapExpr();
             Identifier* mapExprId = mapExpr->getId();
 
-            if(parallelConstruct.size() > 0 && mapExprId->getSymbolInfo()->getId()->isLocalMapReq())
+            if(parallelConstruct.size() > 0 && mapExprId->getSymbolInfo()->getId()->isLocalMapReq() && !isConcurrentContainer(mapExprId))
                  generate_exprIndex(indexExpr, true, isMainFile);
             else
                  generate_exprIndex(indexExpr, false, isMainFile);
@@ -383,7 +1404,7 @@ void dsl_dyn_cpp_generator::generate_exprProcCall(Expression* expr, bool isMainF
          Expression* mapExpr = indexExpr->getMapExpr();
          Identifier* mapExprId = mapExpr->getId();
 
-        if(parallelConstruct.size() > 0 && mapExprId->getSymbolInfo()->getId()->isLocalMapReq())
+        if(parallelConstruct.size() > 0 && mapExprId->getSymbolInfo()->getId()->isLocalMapReq() && !isConcurrentContainer(mapExprId))
             generate_exprIndex(indexExpr, true, true);
         else
             generate_exprIndex(indexExpr, false, true);
@@ -453,15 +1474,18 @@ void dsl_dyn_cpp_generator::generate_exprPropId(PropAccess* propId, bool isMainF
         }
       else 
        {   
+        /* kernels take every prop as d_<prop>, a device epoch prop as its view (addCudaKernel) */
+        const char* prefix = insideKernel ? "d_" : "";
         if(curFuncType == INCREMENTAL_FUNC || curFuncType == DECREMENTAL_FUNC || curFuncType == DYNAMIC_FUNC)
            { 
+              /* edge props by the edge's stable id, on the device too */
               if(id2->getSymbolInfo()->getType()->gettypeId()==TYPE_PROPEDGE)
-                 sprintf(strBuffer,"%s[%s.id]",id2->getIdentifier(),id1->getIdentifier());
+                 sprintf(strBuffer,"%s%s[%s.id]",prefix,id2->getIdentifier(),id1->getIdentifier());
               else
-                 sprintf(strBuffer,"%s[%s]",id2->getIdentifier(),id1->getIdentifier());  
+                 sprintf(strBuffer,"%s%s[%s]",prefix,id2->getIdentifier(),id1->getIdentifier());  
            }
         else 
-          sprintf(strBuffer,"%s[%s]",id2->getIdentifier(),id1->getIdentifier());
+          sprintf(strBuffer,"%s%s[%s]",prefix,id2->getIdentifier(),id1->getIdentifier());
 
        }
     }
@@ -490,7 +1514,7 @@ else if(indexexpr != NULL){
         sprintf(strBuffer,"[%s]",id1->getIdentifier());   
  }
      
- main.pushString(strBuffer);
+ currentPad().pushString(strBuffer);
 }
 
 
@@ -527,17 +1551,26 @@ void dsl_dyn_cpp_generator::generateForAllSignature(forallStmt* forAll, bool isM
       char* graphId=sourceGraph->getIdentifier();
       char* methodId=iteratorMethodId->getIdentifier();
       string s(methodId);
-      if(s.compare("nodes")==0)
+      Identifier* bitFilterProp = getBitFilterProp(forAll);
+      if(s.compare("nodes")==0 && bitFilterProp != NULL)
+      {
+       sprintf(strBuffer,"for (%s %s : %s.setBits()) ","index_t",iterator->getIdentifier(),bitFilterProp->getIdentifier());
+      }
+      else if(s.compare("nodes")==0)
       {
         cout<<"INSIDE NODES VALUE"<<"\n";
-       sprintf(strBuffer,"for (%s %s = 0; %s < %s.%s(); %s ++) ","int",iterator->getIdentifier(),iterator->getIdentifier(),graphId,"num_nodes",iterator->getIdentifier());
+       sprintf(strBuffer,"for (%s %s = 0; %s < %s.%s(); %s ++) ","index_t",iterator->getIdentifier(),iterator->getIdentifier(),graphId,"num_nodes",iterator->getIdentifier());
       }
       else
-      sprintf(strBuffer,"for (%s %s = 0; %s < %s.%s(); %s ++) ","int",iterator->getIdentifier(),iterator->getIdentifier(),graphId,"num_edges",iterator->getIdentifier());
+      sprintf(strBuffer,"for (%s %s = 0; %s < %s.%s(); %s ++) ","offset_t",iterator->getIdentifier(),iterator->getIdentifier(),graphId,"num_edges",iterator->getIdentifier());
 
       main.pushstr_newL(strBuffer);
 
      }
+    else if(neighbourIteration(iteratorMethodId->getIdentifier()) && insideKernel)
+    {
+       generateDeviceNbrLoop(forAll);
+    }
     else if(neighbourIteration(iteratorMethodId->getIdentifier()))
     { 
        
@@ -549,10 +1582,10 @@ void dsl_dyn_cpp_generator::generateForAllSignature(forallStmt* forAll, bool isM
        list<argument*>  argList=extractElemFunc->getArgList();
        assert(argList.size()==1);
        Identifier* nodeNbr=argList.front()->getExpr()->getId();
-       sprintf(strBuffer,"for (edge %s_edge : %s.getNeighbors(%s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
+       sprintf(strBuffer,"for (auto %s_edge : outNbrs(%s, %s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
        main.pushstr_newL(strBuffer);
        main.pushString("{");
-       sprintf(strBuffer,"%s %s = %s_edge.destination ;","int",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
+       sprintf(strBuffer,"%s %s = %s_edge.destination ;","index_t",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
        main.pushstr_newL(strBuffer);
        }
        if(s.compare("nodes_to")==0)
@@ -560,10 +1593,10 @@ void dsl_dyn_cpp_generator::generateForAllSignature(forallStmt* forAll, bool isM
         list<argument*>  argList=extractElemFunc->getArgList();
        assert(argList.size()==1);
        Identifier* nodeNbr=argList.front()->getExpr()->getId();
-       sprintf(strBuffer,"for (edge %s_inedge : %s.getInNeighbors(%s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
+       sprintf(strBuffer,"for (auto %s_inedge : inNbrs(%s, %s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
        main.pushstr_newL(strBuffer);
        main.pushString("{");
-       sprintf(strBuffer,"%s %s = %s_inedge.destination ;","int",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
+       sprintf(strBuffer,"%s %s = %s_inedge.destination ;","index_t",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
        main.pushstr_newL(strBuffer);
        }
         if(s.compare("inOutNbrs")==0)
@@ -571,10 +1604,10 @@ void dsl_dyn_cpp_generator::generateForAllSignature(forallStmt* forAll, bool isM
         list<argument*>  argList=extractElemFunc->getArgList();
        assert(argList.size()==1);
        Identifier* nodeNbr=argList.front()->getExpr()->getId();
-       sprintf(strBuffer,"for (edge %s_edges: %s.getInOutNbrs(%s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
+       sprintf(strBuffer,"for (auto %s_edges : inOutNbrs(%s, %s)) ",nodeNbr->getIdentifier(),graphId,nodeNbr->getIdentifier());
        main.pushstr_newL(strBuffer);
        main.pushString("{");
-       sprintf(strBuffer,"%s %s = %s_edges.destination ;","int",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
+       sprintf(strBuffer,"%s %s = %s_edges.destination ;","index_t",iterator->getIdentifier(),nodeNbr->getIdentifier()); //needs to move the addition of
        main.pushstr_newL(strBuffer);
        }                                                                                                //statement to a different method.                                                                                                    //statement to a different method.
 
@@ -675,8 +1708,209 @@ else {
 
 }
 
+bool dsl_dyn_cpp_generator::isDynamicFuncType()
+{
+  return curFuncType == INCREMENTAL_FUNC || curFuncType == DECREMENTAL_FUNC || curFuncType == DYNAMIC_FUNC;
+}
+
+/* get_edge(src, nbr) inside a loop over src's neighbours with iterator nbr,
+   which getEdgeTranslation names as the loop's <src>_edge */
+bool dsl_dyn_cpp_generator::isNbrLoopEdge(proc_callExpr* proc)
+{
+  return !nbrLoopEdgeName(proc).empty();
+}
+
+/* the loop edge get_edge(src, nbr) names, as the dynamic neighbour loops
+   declare it: <src>_edge, <src>_inedge or <src>_edges; empty if none */
+string dsl_dyn_cpp_generator::nbrLoopEdgeName(proc_callExpr* proc)
+{
+  list<argument*> argList = proc->getArgList();
+  string srcId(argList.front()->getExpr()->getId()->getIdentifier());
+  string destId(argList.back()->getExpr()->getId()->getIdentifier());
+  for (int i = (int)forallStack.size() - 1; i >= 0; i--)
+    {
+      proc_callExpr* loopFunc = forallStack[i].second;
+      if (loopFunc == NULL || !neighbourIteration(loopFunc->getMethodId()->getIdentifier()))
+        continue;
+      string loopSrc(loopFunc->getArgList().front()->getExpr()->getId()->getIdentifier());
+      if (loopSrc == srcId && destId == forallStack[i].first->getIdentifier())
+        {
+          string method(loopFunc->getMethodId()->getIdentifier());
+          if (method == "neighbors")
+            return srcId + "_edge";
+          if (method == "nodes_to")
+            return srcId + "_inedge";
+          return srcId + "_edges";
+        }
+    }
+  return "";
+}
+
+/* the dynamic overrides below write to main; inside a kernel body the
+   code belongs in the header with the kernel */
+dslCodePad& dsl_dyn_cpp_generator::currentPad()
+{
+  return insideKernel ? header : main;
+}
+
+/* A neighbour loop in a kernel of a dynamic function, over the device
+   CSR (deviceCSR.hpp) instead of outNbrs. Rows carry NBR_DELETED filler,
+   which is skipped as outNbrs skips it. The loop edge is a csrEdge with
+   the slot's stable id, under the name the host loop gives it. */
+void dsl_dyn_cpp_generator::generateDeviceNbrLoop(forallStmt* forAll)
+{
+  char strBuffer[1024];
+  proc_callExpr* extractElemFunc = forAll->getExtractElementFunc();
+  string method(extractElemFunc->getMethodId()->getIdentifier());
+  list<argument*> argList = extractElemFunc->getArgList();
+  assert(argList.size() == 1);
+  const char* src = argList.front()->getExpr()->getId()->getIdentifier();
+  const char* nbr = forAll->getIterator()->getIdentifier();
+
+  if (method == "neighbors")
+    {
+      sprintf(strBuffer, "for (offset_t %s_slot = d_meta[%s]; %s_slot < d_meta[%s+1]; %s_slot++)", src, src, src, src, src);
+      header.pushstr_newL(strBuffer);
+      header.pushstr_newL("{");
+      sprintf(strBuffer, "index_t %s = d_data[%s_slot];", nbr, src);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "if (%s == NBR_DELETED) continue;", nbr);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "csrEdge %s_edge = {%s, %s, d_weight[%s_slot], d_edgeIds[%s_slot]};", src, src, nbr, src, src);
+      header.pushstr_newL(strBuffer);
+    }
+  else if (method == "nodes_to")
+    {
+      /* in-edges are numbered by reverse slot and carry no weight, as in inNbrs */
+      sprintf(strBuffer, "for (offset_t %s_inslot = d_rev_meta[%s]; %s_inslot < d_rev_meta[%s+1]; %s_inslot++)", src, src, src, src, src);
+      header.pushstr_newL(strBuffer);
+      header.pushstr_newL("{");
+      sprintf(strBuffer, "index_t %s = d_src[%s_inslot];", nbr, src);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "if (%s == NBR_DELETED) continue;", nbr);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "csrEdge %s_inedge = {%s, %s, 1, %s_inslot};", src, src, nbr, src);
+      header.pushstr_newL(strBuffer);
+    }
+  else
+    {
+      /* out-edges, then in-edges */
+      sprintf(strBuffer, "for (int %s_side = 0; %s_side < 2; %s_side++)", src, src, src);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "for (offset_t %s_slots = (%s_side ? d_rev_meta : d_meta)[%s]; %s_slots < (%s_side ? d_rev_meta : d_meta)[%s+1]; %s_slots++)",
+              src, src, src, src, src, src, src);
+      header.pushstr_newL(strBuffer);
+      header.pushstr_newL("{");
+      sprintf(strBuffer, "index_t %s = (%s_side ? d_src : d_data)[%s_slots];", nbr, src, src);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "if (%s == NBR_DELETED) continue;", nbr);
+      header.pushstr_newL(strBuffer);
+      sprintf(strBuffer, "csrEdge %s_edges = {%s, %s, %s_side ? 1 : d_weight[%s_slots], %s_side ? %s_slots : d_edgeIds[%s_slots]};",
+              src, src, nbr, src, src, src, src, src);
+      header.pushstr_newL(strBuffer);
+    }
+}
+
+/* edges in dynamic functions are csrEdge values (nbrView.hpp, edgeAt) */
+void dsl_dyn_cpp_generator::generateEdgeDecl(declaration* declStmt, bool isMainFile)
+{
+  dslCodePad& targetFile = currentPad();
+  targetFile.pushstr_space("csrEdge");
+  targetFile.pushString(declStmt->getdeclId()->getIdentifier());
+  if (declStmt->isInitialized())
+    {
+      targetFile.pushString(" = ");
+      generateExpr(declStmt->getExpressionAssigned(), isMainFile);
+    }
+  targetFile.pushstr_newL(";");
+}
+
+void dsl_dyn_cpp_generator::generateEdgeIndexRefresh(proc_callStmt* procStmt)
+{
+  proc_callExpr* proc = procStmt->getProcCallExpr();
+  string methodId(proc->getMethodId()->getIdentifier());
+  if (!insideBatchBlock || proc->getId1() == NULL)
+    return;
+  if (methodId != "updateCSRAdd" && methodId != "updateCSRDel")
+    return;
+  char strBuffer[1024];
+  /* only the hub tables of the rows the update rewrote */
+  sprintf(strBuffer, "%s_index.refresh();", proc->getId1()->getIdentifier());
+  main.pushstr_newL(strBuffer);
+  /* and the device rows, for the kernels launched after it */
+  if (kernelFuncs.count(currentFunc))
+    generateDeviceCSRSync(proc->getId1()->getIdentifier(), false);
+}
+
+/* A for over src's neighbours whose body only acts on the neighbour equal
+   to some dest,
+
+     for(nbr in g.neighbors(src)) { edge e = g.get_edge(src, nbr); if(nbr == dest) {...} }
+
+   as OnAdd/OnDelete blocks mark an updated edge, becomes one lookup of
+   src->dest instead of a scan of src's row. Returns false, generating
+   nothing, for any other loop. */
+bool dsl_dyn_cpp_generator::generateNbrLookup(forallStmt* forAll)
+{
+  proc_callExpr* extractElemFunc = forAll->getExtractElementFunc();
+  if (!isDynamicFuncType() || extractElemFunc == NULL || forAll->hasFilterExpr())
+    return false;
+  string methodId(extractElemFunc->getMethodId()->getIdentifier());
+  if (methodId != "neighbors" || forAll->getBody()->getTypeofNode() != NODE_BLOCKSTMT)
+    return false;
+
+  Identifier* iterator = forAll->getIterator();
+  string iteratorId(iterator->getIdentifier());
+  list<statement*> stmts = ((blockStatement*)forAll->getBody())->returnStatements();
+  if (stmts.empty() || stmts.back()->getTypeofNode() != NODE_IFSTMT)
+    return false;
+  for (statement* stmt : stmts)
+    {
+      if (stmt == stmts.back())
+        break;
+      if (stmt->getTypeofNode() != NODE_DECL || !((declaration*)stmt)->getType()->isEdgeType())
+        return false;
+    }
+
+  ifStmt* onMatch = (ifStmt*)stmts.back();
+  Expression* cond = onMatch->getCondition();
+  if (onMatch->getElseBody() != NULL || !cond->isRelational() || cond->getOperatorType() != OPERATOR_EQ)
+    return false;
+  if (!cond->getLeft()->isIdentifierExpr() || !cond->getRight()->isIdentifierExpr())
+    return false;
+  Identifier* left = cond->getLeft()->getId();
+  Identifier* right = cond->getRight()->getId();
+  Identifier* target;
+  if (iteratorId == left->getIdentifier())
+    target = right;
+  else if (iteratorId == right->getIdentifier())
+    target = left;
+  else
+    return false;
+  if (iteratorId == target->getIdentifier())
+    return false;
+
+  char strBuffer[1024];
+  Identifier* sourceNode = extractElemFunc->getArgList().front()->getExpr()->getId();
+  main.pushstr_newL("{");
+  sprintf(strBuffer, "csrEdge %s_edge = edgeAt(%s, %s, %s);", sourceNode->getIdentifier(), extractElemFunc->getId1()->getIdentifier(), sourceNode->getIdentifier(), target->getIdentifier());
+  main.pushstr_newL(strBuffer);
+  sprintf(strBuffer, "if (%s_edge.id >= 0) {", sourceNode->getIdentifier());
+  main.pushstr_newL(strBuffer);
+  sprintf(strBuffer, "index_t %s = %s_edge.destination;", iterator->getIdentifier(), sourceNode->getIdentifier());
+  main.pushstr_newL(strBuffer);
+  forallStack.push_back(make_pair(iterator, extractElemFunc));
+  generateBlock((blockStatement*)forAll->getBody(), false);
+  forallStack.pop_back();
+  main.pushstr_newL("}");
+  main.pushstr_newL("}");
+  return true;
+}
+
 void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
 { 
+  if (!forAll->isForall() && generateNbrLookup(forAll))
+    return;
 
    dslCodePad& targetFile = isMainFile ? main : header;
     proc_callExpr* extractElemFunc = forAll->getExtractElementFunc();
@@ -695,7 +1929,10 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
     iteratorMethodId = extractElemFunc->getMethodId();
   statement* body = forAll->getBody();
   char strBuffer[1024];
-  if (forAll->isForall()) {  // IS FORALL
+  /* a forall writing a host container runs on the host, see isHostForall */
+  bool hostForall = isHostForall(forAll);
+  bool parallelHost = hostForall && isIndexedHostLoop(forAll);
+  if (forAll->isForall() && !hostForall) {  // IS FORALL
 
     /*
     if (forAll->hasFilterExpr()) {
@@ -752,7 +1989,10 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
     main.pushString("numBlocks, threadsPerBlock");
     main.pushString(">>>");
     main.push('(');
-    main.pushString("V,E,d_meta,d_data,d_src,d_weight,d_rev_meta,d_modified_next");
+    if(kernelFuncs.count(currentFunc))
+      main.pushString("V,E,d_meta,d_data,d_src,d_weight,d_rev_meta,d_edgeIds,d_modified_next");
+    else
+      main.pushString("V,E,d_meta,d_data,d_src,d_weight,d_rev_meta,d_modified_next");
     //  if(currentFunc->getParamList().size()!=0)
     // main.pushString(",");
     if (!isOptimized) {
@@ -761,22 +2001,16 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
       list<Identifier*> vars = usedVars.getVariables();
       for (Identifier* iden : vars) {
         Type* type = iden->getSymbolInfo()->getType();
-        if (type->isPropType()) {
-          main.pushString(",");
-          main.pushString("d_");
-          main.pushString(/*createParamName(*/ iden->getIdentifier());
-        }
+        if (type->isPropType())
+          generateKernelPropArg(iden);
       }
     } else {
       std::cout<< "INN OPTIMESED ---------------" << '\n';
       for (Identifier* iden : forAll->getUsedVariables()) {
         std::cout<< "_" << '\n';
         Type* type = iden->getSymbolInfo()->getType();
-        if (type->isPropType()) {
-          main.pushString(",");
-          main.pushString("d_");
-          main.pushString(/*createParamName(*/ iden->getIdentifier());
-        }
+        if (type->isPropType())
+          generateKernelPropArg(iden);
       }
     }
     main.pushString(")");
@@ -827,9 +2061,14 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
 
   else {  // IS FOR
 
+    if (parallelHost) {
+      main.pushstr_newL("#pragma omp parallel for");
+      parallelConstruct.push_back(forAll);
+    }
     generateForAllSignature(forAll, false);  // FOR LINE
 
-    if (forAll->hasFilterExpr()) {
+    /* a bitProp filter is already folded into the set-bit scan */
+    if (forAll->hasFilterExpr() && getBitFilterProp(forAll) == NULL) {
       blockStatement* changedBody = includeIfToBlock(forAll);
       cout << "============CHANGED BODY  TYPE==============" << (changedBody->getTypeofNode() == NODE_BLOCKSTMT);
       forAll->setBody(changedBody);
@@ -936,7 +2175,8 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
           //~ std::cout<< "FOR BODY BEGIN" << '\n';
           //~ targetFile.pushstr_newL("{ // FOR BEGIN ITR BEGIN");
           generateStatement(forAll->getBody(), isMainFile);
-          targetFile.pushstr_newL("} //  end FOR NBR ITR. TMP FIX!");
+          /* closes the loop generateForAllSignature opened, on its pad */
+          currentPad().pushstr_newL("} //  end FOR NBR ITR. TMP FIX!");
           std::cout << "FOR BODY END" << '\n';
         }
 
@@ -952,7 +2192,7 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
         generateStatement(forAll->getBody(), false);
       }
 
-      if (forAll->isForall() && forAll->hasFilterExpr()) {
+      if (forAll->isForall() && !hostForall && forAll->hasFilterExpr()) {
         Expression* filterExpr = forAll->getfilterExpr();
         generatefixedpt_filter(filterExpr, false);
       }
@@ -1004,7 +2244,7 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
         //~ cout << iteratorMethodId->getIdentifier() << "\n";
         generateStatement(forAll->getBody(), false);
       }
-      if(forAll->isForall() && (forAll->hasFilterExpr() || forAll->hasFilterExprAssoc()))
+      if(forAll->isForall() && !hostForall && (forAll->hasFilterExpr() || forAll->hasFilterExprAssoc()))
      { 
          
        checkAndGenerateFixedPtFilter(forAll, isMainFile);
@@ -1013,22 +2253,28 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
     
     }
 
-    if(forAll->isForall()) {
+    if(parallelHost) {
     parallelConstruct.pop_back();
 
  if(forAll->getMapLocal().size() > 0) {
 
-    /* write logic here */
+    /* containers written through a concurrent map are moved into place in
+       parallel; the others merge their per-thread copies */
 
     set<Identifier*>  containerId = forAll->getMapLocal();
-    auto it = containerId.begin();
-    Identifier* id = *it;
-    int start = 0;
-    generateForMergeContainer(id->getSymbolInfo()->getType(), start,isMainFile);
-    char val = 'k' + start + 1;
-    sprintf(strBuffer, "for(int %c = 0 ; %c < omp_get_max_threads() ; %c++)", val, val, val);
-    main.pushstr_newL(strBuffer);
-    generateInserts(id->getSymbolInfo()->getType(), id, isMainFile);
+    for(Identifier* id : containerId) {
+      if(isConcurrentContainer(id)) {
+        sprintf(strBuffer, "%s_pending.drainInto(%s);", id->getIdentifier(), id->getIdentifier());
+        main.pushstr_newL(strBuffer);
+        continue;
+      }
+      int start = 0;
+      generateForMergeContainer(id->getSymbolInfo()->getType(), start,isMainFile);
+      char val = 'k' + start + 1;
+      sprintf(strBuffer, "for(int %c = 0 ; %c < omp_get_max_threads() ; %c++)", val, val, val);
+      main.pushstr_newL(strBuffer);
+      generateInserts(id->getSymbolInfo()->getType(), id, isMainFile);
+    }
 
  }   
 
@@ -1043,6 +2289,261 @@ void dsl_dyn_cpp_generator::generateForAll(forallStmt* forAll, bool isMainFile )
 
 
 
+/* A forall that pushes into a host container (the analyser lists it in
+   getMapLocal) cannot be a CUDA kernel, so on the dynamic side it runs as
+   a host loop: an OpenMP one when isIndexedHostLoop, with its pushes going
+   to the container's concurrent map (isConcurrentContainer) or to per-thread
+   copies; otherwise a serial one writing the container directly. */
+bool dsl_dyn_cpp_generator::isHostForall(forallStmt* forAll)
+{
+  return forAll->isForall() && curFuncType != STATIC_FUNC && forAll->getMapLocal().size() > 0;
+}
+
+/* the loops generateForAllSignature opens with a plain index, which
+   "#pragma omp parallel for" can split */
+bool dsl_dyn_cpp_generator::isIndexedHostLoop(forallStmt* forAll)
+{
+  if (forAll->isSourceProcCall())
+    {
+      char* methodId = forAll->getExtractElementFunc()->getMethodId()->getIdentifier();
+      return allGraphIteration(methodId) && !(string(methodId) == "nodes" && getBitFilterProp(forAll) != NULL);
+    }
+  if (forAll->isSourceExpr())
+    return forAll->getSourceExpr()->getMapExpr()->getId()->getSymbolInfo()->getType()->gettypeId() == TYPE_CONTAINER;
+  Identifier* sourceId = forAll->getSource();
+  if (forAll->isSourceField() || sourceId == NULL)
+    return false;
+  int typeId = sourceId->getSymbolInfo()->getType()->gettypeId();
+  return typeId == TYPE_UPDATES || typeId == TYPE_CONTAINER;
+}
+
+/* A container<container<T>> that foralls push into is kept as the container
+   plus a concurrentMap<int, T> of pending pushes, instead of one full copy
+   per thread merged serially after the loop. Deeper nestings keep the
+   per-thread copies. */
+bool dsl_dyn_cpp_generator::isConcurrentContainer(Identifier* id)
+{
+  if(id == NULL || id->getSymbolInfo() == NULL)
+    return false;
+  Type* type = id->getSymbolInfo()->getType();
+  if(type->gettypeId() != TYPE_CONTAINER || !id->getSymbolInfo()->getId()->isLocalMapReq())
+    return false;
+  Type* inner = type->getInnerTargetType();
+  return inner != NULL && inner->gettypeId() == TYPE_CONTAINER
+         && inner->getInnerTargetType() != NULL && inner->getInnerTargetType()->gettypeId() != TYPE_CONTAINER;
+}
+
+void dsl_dyn_cpp_generator::generateConcurrentContainerDecl(declaration* declStmt, bool isMainFile)
+{
+  char strBuffer[1024];
+  Type* type = declStmt->getType();
+  Identifier* id = declStmt->getdeclId();
+
+  main.pushstr_space(convertToCppType(type));
+  main.pushString(id->getIdentifier());
+  if(type->getArgList().size() != 0) {
+    list<argument*> args = type->getArgList();
+    main.pushString("(");
+    generateExpr(args.front()->getExpr(), isMainFile);
+    if(type->getInnerTargetSize() != NULL) {
+      main.pushstr_space(",");
+      generateNestedContainer(type->getInnerTargetSize(), isMainFile);
+    }
+    else if(args.size() == 2) {
+      main.pushstr_space(",");
+      generateExpr(args.back()->getExpr(), isMainFile);
+    }
+    main.pushString(")");
+  }
+  main.pushstr_newL(";");
+
+  sprintf(strBuffer, "concurrentMap<int, %s> %s_pending;",
+          convertToCppType(type->getInnerTargetType()->getInnerTargetType()), id->getIdentifier());
+  main.pushstr_newL(strBuffer);
+}
+
+
+/* Which graph views (GRAPHVIEW) each function reads, so the reverse CSR
+   is only built and exported for functions that pull from in-neighbours. */
+void dsl_dyn_cpp_generator::collectGraphViews(statement* stmt, Function* func)
+{
+  if(stmt == NULL)
+    return;
+
+  if(stmt->getTypeofNode() == NODE_BLOCKSTMT)
+    {
+      list<statement*> stmtList = ((blockStatement*)stmt)->returnStatements();
+      for(statement* s : stmtList)
+        collectGraphViews(s, func);
+    }
+  if(stmt->getTypeofNode() == NODE_FORALLSTMT)
+    {
+      forallStmt* forAll = (forallStmt*)stmt;
+      if(forAll->isSourceProcCall())
+        {
+          string methodId(forAll->getExtractElementFunc()->getMethodId()->getIdentifier());
+          if(methodId == "neighbors")
+            graphViews[func] |= VIEW_OUT;
+          else if(methodId == "nodes_to")
+            graphViews[func] |= VIEW_IN;
+          else if(methodId == "inOutNbrs")
+            graphViews[func] |= VIEW_IN | VIEW_OUT;
+        }
+      collectGraphViews(forAll->getBody(), func);
+    }
+  if(stmt->getTypeofNode() == NODE_IFSTMT)
+    {
+      collectGraphViews(((ifStmt*)stmt)->getIfBody(), func);
+      collectGraphViews(((ifStmt*)stmt)->getElseBody(), func);
+    }
+  if(stmt->getTypeofNode() == NODE_WHILESTMT)
+     collectGraphViews(((whileStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_DOWHILESTMT)
+     collectGraphViews(((dowhileStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_FIXEDPTSTMT)
+     collectGraphViews(((fixedPointStmt*)stmt)->getBody(), func);
+  if(stmt->getTypeofNode() == NODE_ITRBFS)
+    {
+      graphViews[func] |= VIEW_OUT;
+      collectGraphViews(((iterateBFS*)stmt)->getBody(), func);
+    }
+  if(stmt->getTypeofNode() == NODE_BATCHBLOCKSTMT)
+     collectGraphViews(((batchBlock*)stmt)->getStatements(), func);
+  if(stmt->getTypeofNode() == NODE_ONADDBLOCK)
+     collectGraphViews(((onAddBlock*)stmt)->getStatements(), func);
+  if(stmt->getTypeofNode() == NODE_ONDELETEBLOCK)
+     collectGraphViews(((onDeleteBlock*)stmt)->getStatements(), func);
+}
+
+/* The Dynamic function attaches the slack CSR for its Incremental and
+   Decremental calls, so it needs whatever they read. */
+int dsl_dyn_cpp_generator::usedGraphViews(Function* func)
+{
+  if(func->getFuncType() != DYNAMIC_FUNC)
+    return graphViews[func];
+
+  int views = 0;
+  for(Function* f : frontEndContext.getFuncList())
+    {
+      if(f->getFuncType() != STATIC_FUNC)
+        views |= graphViews[f];
+    }
+  return views;
+}
+
+void dsl_dyn_cpp_generator::generateReverseRequest(Function* func)
+{
+  char strBuffer[1024];
+  if(!(usedGraphViews(func) & VIEW_IN))
+    return;
+  sprintf(strBuffer, "ensureReverse(%s);", graphId[curFuncType][curFuncCount()][0]->getIdentifier());
+  main.pushstr_newL(strBuffer);
+}
+
+/* Kernel of a forall in the index_t/offset_t widths of
+   graphcode/graphIndex.hpp. Static and general functions get their device
+   CSR from the base generator, which declares it int, so their kernels keep
+   the int signature; the dynamic-side functions upload it themselves in
+   generateCSRArrays. */
+void dsl_dyn_cpp_generator::addCudaKernel(forallStmt* forAll)
+{
+  char strBuffer[1024];
+  const char* loopVar = forAll->getIterator()->getIdentifier();
+  bool wideCSR = kernelFuncs.count(currentFunc) > 0;
+
+  header.pushString("__global__ void ");
+  header.pushString("_kernel");
+  if(wideCSR)
+    header.pushString("(index_t V, offset_t E, offset_t* d_meta, index_t* d_data, index_t* d_src, int* d_weight, offset_t* d_rev_meta, offset_t* d_edgeIds, bool* d_modified_next");
+  else
+    header.pushString("(int V, int E, int* d_meta, int* d_data, int* d_src, int* d_weight, int *d_rev_meta,bool *d_modified_next");
+
+  usedVariables usedVars = getVarsForAll(forAll);
+  list<Identifier*> vars = usedVars.getVariables();
+  for(Identifier* iden : vars)
+    {
+      Type* type = iden->getSymbolInfo()->getType();
+      if(type->isPropType())
+        {
+          sprintf(strBuffer, ",%s d_%s", kernelPropType(iden, type).c_str(), iden->getIdentifier());
+          header.pushString(strBuffer);
+        }
+    }
+  header.pushstr_newL("){ // BEGIN KER FUN via ADDKERNEL");
+
+  sprintf(strBuffer, "%s %s = blockIdx.x * blockDim.x + threadIdx.x;", wideCSR ? "index_t" : "unsigned", loopVar);
+  header.pushstr_newL(strBuffer);
+  header.pushstr_newL("float num_nodes  = V;");
+  sprintf(strBuffer, "if(%s >= V) return;", loopVar);
+  header.pushstr_newL(strBuffer);
+
+  if(forAll->hasFilterExpr())
+    {
+      blockStatement* changedBody = includeIfToBlock(forAll);
+      forAll->setBody(changedBody);
+    }
+
+  statement* body = forAll->getBody();
+  assert(body->getTypeofNode() == NODE_BLOCKSTMT);
+  list<statement*> statementList = ((blockStatement*)body)->returnStatements();
+  insideKernel = true;
+  for(statement* stmt : statementList)
+    generateStatement(stmt, false);
+  insideKernel = false;
+
+  header.pushstr_newL("} // end KER FUNC");
+}
+
+/* CSR of an Incremental/Decremental/Dynamic function that launches
+   kernels. It is the graph's deviceCSR (deviceCSR.hpp), kept on the
+   device across calls: sync at entry copies only the rows the batches
+   rewrote since the last call, or nothing when the edges have not moved.
+   Widths are the build's index_t/offset_t; requireGraphIndexFits stops a
+   graph that does not fit them.
+
+   The rows are in the graph's slot layout, NBR_DELETED filler included
+   (slackCSR.hpp), and d_edgeIds carries each slot's id for the edge props.
+   The Dynamic function's deviceCSRScope frees it on return. */
+void dsl_dyn_cpp_generator::generateCSRArrays(const char* gId)
+{
+  char strBuffer[1024];
+
+  sprintf(strBuffer, "requireGraphIndexFits(%s.num_nodes(), %s.num_edges(), \"%s\");", gId, gId, gId);
+  main.pushstr_newL(strBuffer);
+  sprintf(strBuffer, "deviceCSR& %s_device = deviceCSRFor(%s);", gId, gId);
+  main.pushstr_newL(strBuffer);
+  generateDeviceCSRSync(gId, true);
+  main.NewLine();
+
+  main.pushstr_newL("printf(\"#nodes:\" INDEX_FMT \"\\n\",V);");
+  main.pushstr_newL("printf(\"#edges:\" OFFSET_FMT \"\\n\",E);");
+  main.pushstr_newL("cudaMemset(d_modified_next, 0, sizeof(bool)*V);");
+  main.NewLine();
+}
+
+/* syncs <g>_device and (re)binds the locals the launches pass; with a
+   pull view the reverse rows are kept too, generateReverseRequest having
+   built them */
+void dsl_dyn_cpp_generator::generateDeviceCSRSync(const char* gId, bool declare)
+{
+  char strBuffer[1024];
+  bool pulls = (usedGraphViews(currentFunc) & VIEW_IN) != 0;
+  sprintf(strBuffer, "%s_device.sync(%s, %s);", gId, gId, pulls ? "true" : "false");
+  main.pushstr_newL(strBuffer);
+
+  const char* locals[][2] = {{"index_t", "V"}, {"offset_t", "E"}, {"offset_t*", "d_meta"}, {"index_t*", "d_data"},
+                             {"index_t*", "d_src"}, {"int*", "d_weight"}, {"offset_t*", "d_rev_meta"},
+                             {"offset_t*", "d_edgeIds"}, {"bool*", "d_modified_next"}};
+  for (auto& local : locals)
+    {
+      if (declare)
+        sprintf(strBuffer, "%s %s = %s_device.%s;", local[0], local[1], gId, local[1]);
+      else
+        sprintf(strBuffer, "%s = %s_device.%s;", local[1], gId, local[1]);
+      main.pushstr_newL(strBuffer);
+    }
+}
+
 void dsl_dyn_cpp_generator::generateInDecHeader(Function* inDecFunc, bool isMainFile)
 {
   dslCodePad& targetFile = isMainFile ? main : header;
@@ -1057,6 +2558,9 @@ void dsl_dyn_cpp_generator::generateInDecHeader(Function* inDecFunc, bool isMain
      sprintf(temp,"%s_del",fileName);
    }
 
+  if(usesWidthTemplates)
+     targetFile.pushstr_newL("template <typename nodeval_t, typename edgeval_t>");
+
   if(inDecFunc->containsReturn()) 
      targetFile.pushString("auto ");
   else
@@ -1065,7 +2569,18 @@ void dsl_dyn_cpp_generator::generateInDecHeader(Function* inDecFunc, bool isMain
   targetFile.pushString(temp);
   targetFile.push('(');
 
-  generateParamList(inDecFunc->getParamList(), targetFile);
+  bool hasEpochParam = false;
+  list<formalParam*> params = inDecFunc->getParamList();
+  for(formalParam* param : params)
+    {
+      if(param->getType()->isPropType() && isEpochProp(param->getIdentifier()))
+        hasEpochParam = true;
+    }
+
+  if(hasEpochParam)
+    generateEpochParamList(inDecFunc, targetFile);
+  else
+    generateParamList(inDecFunc->getParamList(), targetFile);
   
  /* int maximum_arginline=4;
   int arg_currNo=0;
@@ -1116,6 +2631,13 @@ void dsl_dyn_cpp_generator::generateDynamicHeader(Function* dynFunc, bool isMain
   //dslCodePad& targetFile = main;
  
  sprintf(temp,"%s",dynFunc->getIdentifier()->getIdentifier());
+
+ /* the entry point itself becomes a width dispatcher, see generateWidthDispatch */
+ if(usesWidthTemplates)
+   {
+     targetFile.pushstr_newL("template <typename nodeval_t, typename edgeval_t>");
+     sprintf(temp,"%s_impl",dynFunc->getIdentifier()->getIdentifier());
+   }
   
  if(dynFunc->containsReturn()) 
      targetFile.pushString("auto ");
@@ -1148,10 +2670,11 @@ void dsl_dyn_cpp_generator::generateIncremental(Function* incFunc, bool isMainFi
    if(incFunc->getInitialLockDecl())
        {
          vector<Identifier*> graphVar = graphId[curFuncType][curFuncCount()]; 
-         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)malloc(%s.num_nodes()*sizeof(omp_lock_t));",graphVar[0]->getIdentifier());
+         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)numaMap(%s.num_nodes()*sizeof(omp_lock_t), numaDefaultPolicy());",graphVar[0]->getIdentifier());
          main.pushstr_newL(strBuffer);
          main.NewLine();
-         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","int","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
+         main.pushstr_newL("#pragma omp parallel for schedule(static)");
+         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","index_t","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
          main.pushstr_newL(strBuffer);
          sprintf(strBuffer,"omp_init_lock(&lock[%s]);","v");
          main.space();
@@ -1161,6 +2684,10 @@ void dsl_dyn_cpp_generator::generateIncremental(Function* incFunc, bool isMainFi
 
        }
    generatePriorDeclarations(incFunc, isMainFile);
+   generateEpochPropDecls(incFunc);
+   generateReverseRequest(incFunc);
+   if(kernelFuncs.count(incFunc))
+      generateCSRArrays(graphId[curFuncType][curFuncCount()][0]->getIdentifier());
    generateBlock(incFunc->getBlockStatement(),false);
    main.NewLine();
    main.pushstr_newL("}");
@@ -1183,10 +2710,11 @@ void dsl_dyn_cpp_generator::generateDecremental(Function* decFunc, bool isMainFi
    if(decFunc->getInitialLockDecl())
        {
          vector<Identifier*> graphVar = graphId[curFuncType][curFuncCount()]; 
-         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)malloc(%s.num_nodes()*sizeof(omp_lock_t));",graphVar[0]->getIdentifier());
+         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)numaMap(%s.num_nodes()*sizeof(omp_lock_t), numaDefaultPolicy());",graphVar[0]->getIdentifier());
          main.pushstr_newL(strBuffer);
          main.NewLine();
-         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","int","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
+         main.pushstr_newL("#pragma omp parallel for schedule(static)");
+         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","index_t","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
          main.pushstr_newL(strBuffer);
          sprintf(strBuffer,"omp_init_lock(&lock[%s]);","v");
          main.space();
@@ -1196,6 +2724,10 @@ void dsl_dyn_cpp_generator::generateDecremental(Function* decFunc, bool isMainFi
 
        }
 
+   generateEpochPropDecls(decFunc);
+   generateReverseRequest(decFunc);
+   if(kernelFuncs.count(decFunc))
+      generateCSRArrays(graphId[curFuncType][curFuncCount()][0]->getIdentifier());
    generateBlock(decFunc->getBlockStatement(),false);
    main.NewLine();
    main.pushstr_newL("}");
@@ -1218,10 +2750,11 @@ void dsl_dyn_cpp_generator::generateDynamicFunc(Function* dynFunc, bool isMainFi
    if(dynFunc->getInitialLockDecl())
        {
          vector<Identifier*> graphVar = graphId[curFuncType][curFuncCount()]; 
-         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)malloc(%s.num_nodes()*sizeof(omp_lock_t));",graphVar[0]->getIdentifier());
+         sprintf(strBuffer,"omp_lock_t* lock = (omp_lock_t*)numaMap(%s.num_nodes()*sizeof(omp_lock_t), numaDefaultPolicy());",graphVar[0]->getIdentifier());
          main.pushstr_newL(strBuffer);
          main.NewLine();
-         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","int","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
+         main.pushstr_newL("#pragma omp parallel for schedule(static)");
+         sprintf(strBuffer,"for(%s %s = %s; %s<%s.%s(); %s++)","index_t","v","0","v",graphVar[0]->getIdentifier(),"num_nodes","v");
          main.pushstr_newL(strBuffer);
          sprintf(strBuffer,"omp_init_lock(&lock[%s]);","v");
          main.space();
@@ -1231,9 +2764,15 @@ void dsl_dyn_cpp_generator::generateDynamicFunc(Function* dynFunc, bool isMainFi
 
        }
    generatePriorDeclarations(dynFunc, isMainFile);
+   generateEpochPropDecls(dynFunc);
+   generateReverseRequest(dynFunc);
+   if(kernelFuncs.count(dynFunc))
+      generateCSRArrays(graphId[curFuncType][curFuncCount()][0]->getIdentifier());
    generateBlock(dynFunc->getBlockStatement(),false);
    main.NewLine();
    main.pushstr_newL("}");
+   if(usesWidthTemplates)
+      generateWidthDispatch(dynFunc);
    incFuncCount(dynFunc->getFuncType());
    return;
 
@@ -1326,9 +2865,35 @@ void dsl_dyn_cpp_generator::generation_begin()
   header.pushString("#include ");
   addIncludeToFile("cuda.h", header, true);
   header.pushString("#include ");
+  addIncludeToFile("../graphIndex.hpp", header, false);
+  header.pushString("#include ");
   addIncludeToFile("../graph.hpp", header, false);
   header.pushString("#include ");
   addIncludeToFile("../libcuda.cuh", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../epochProp.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../bitProp.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../deviceProp.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../propWidth.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../nbrView.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../slackCSR.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../edgeIndex.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../deviceCSR.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../reverseCSR.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../numaAlloc.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../propPool.hpp", header, false);
+  header.pushString("#include ");
+  addIncludeToFile("../../src/runtime/concurrentMap.hpp", header, false);
 
   header.pushstr_newL("#include <cooperative_groups.h>");
   //header.pushstr_newL("graph &g = NULL;");  //temporary fix - to fix the PageRank graph g instance
@@ -1350,6 +2915,29 @@ bool dsl_dyn_cpp_generator::generate()
    generation_begin(); 
    
    list<Function*> funcList=frontEndContext.getFuncList();
+
+   /* props re-attached inside loops of the dynamic-side functions. Static
+      functions keep their device arrays. */
+   for(Function* func:funcList)
+   {
+       if(func->getFuncType() != STATIC_FUNC)
+          collectEpochProps(func->getBlockStatement(), func, 0);
+   }
+   for(Function* func:funcList)
+   {
+       if(func->getFuncType() != STATIC_FUNC)
+          propagateEpochProps(func->getBlockStatement());
+   }
+   for(Function* func:funcList)
+   {
+       if(func->getFuncType() != STATIC_FUNC)
+          collectKernelProps(func->getBlockStatement(), func);
+   }
+   markDeviceEpochProps();
+   for(Function* func:funcList)
+      collectGraphViews(func->getBlockStatement(), func);
+   analysePropRanges();
+
    for(Function* func:funcList)
    {
        generateFunction(func);
@@ -2,14 +2,61 @@
 #define CU_DSL_DYN_CPP_GENERATOR
 
 #include "dsl_cpp_generator.h"
+#include <set>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 
 
 namespace spdyncuda{
+
+/* what a prop's values are known to stay within, ordered from tightest */
+enum RANGEBOUND
+{
+  RANGE_CONST,   /* [lo, hi] known at compile time */
+  RANGE_NODES,   /* bounded by g.num_nodes() */
+  RANGE_EDGES,   /* bounded by g.num_edges() */
+  RANGE_NONE
+};
+
+enum LOOPKIND
+{
+  LOOP_NODES,    /* forall over g.nodes(), iterateInBFS */
+  LOOP_NBRS,     /* forall over a node's neighbours */
+  LOOP_OTHER     /* while, fixedPoint, batches, sets */
+};
+
+/* graph views a function reads, recorded before generation */
+enum GRAPHVIEW
+{
+  VIEW_OUT = 1,  /* neighbors, BFS */
+  VIEW_IN = 2    /* nodes_to, inOutNbrs: needs the reverse CSR */
+};
+
+struct valueRange
+{
+  int bound;
+  long lo;
+  long hi;
+};
+
 class dsl_dyn_cpp_generator:public spcuda::dsl_cpp_generator
 {   
  private:
  Identifier* batchEnvSizeId;
  Identifier* updatesId;
+ set<Identifier*> epochProps;   /* props with O(1)-reset storage: epochProp<T>, bitProp for bool */
+ set<Identifier*> kernelProps;  /* props used inside a forall kernel */
+ set<Identifier*> deviceEpochProps;   /* epoch props kernels use, on managed storage */
+ set<Function*> kernelFuncs;    /* dynamic-side functions that launch a kernel */
+ map<Function*, vector<declaration*> > hoistedPropDecls;
+ map<Identifier*, valueRange> propRanges;
+ vector<pair<Identifier*, Identifier*> > epochArgLinks;   /* (arg, param) of Incremental/Decremental calls */
+ map<Function*, int> graphViews;   /* GRAPHVIEW bits per function */
+ bool usesWidthTemplates;
+ bool insideKernel;                  /* generating the body of a forall kernel */
+ set<Identifier*> changedProps;      /* props whose range moved in this pass */
+ map<Identifier*, int> rangeUpdates;
 
  public:
   
@@ -17,6 +64,8 @@ class dsl_dyn_cpp_generator:public spcuda::dsl_cpp_generator
   {
     batchEnvSizeId = NULL;
     updatesId = NULL;
+    usesWidthTemplates = false;
+    insideKernel = false;
   }
 
  void generateIncremental(Function* incrementalFunc, bool isMainFile );
@@ -46,6 +95,49 @@ class dsl_dyn_cpp_generator:public spcuda::dsl_cpp_generator
  bool openFileforOutput();
  void closeOutputFile();
  void generateFreeInCurrentBatch();
+ void collectEpochProps(statement* stmt, Function* func, int loopDepth);
+ void propagateEpochProps(statement* stmt);
+ void markEpochArgs(Expression* expr);
+ void collectKernelProps(statement* stmt, Function* func);
+ void markDeviceEpochProps();
+ bool isEpochProp(Identifier* id);
+ bool isDeviceEpochProp(Identifier* id);
+ string epochPropType(Identifier* id, Type* type);
+ string kernelPropType(Identifier* id, Type* type);
+ void generateKernelPropArg(Identifier* id);
+ void generateEpochPropDecls(Function* func);
+ bool generateEpochPropAttach(proc_callStmt* procStmt, bool isMainFile);
+ void generateEpochParamList(Function* func, dslCodePad& targetFile);
+ Identifier* getBitFilterProp(forallStmt* forAll);
+ void analyseRanges(statement* stmt, vector<int>& loopKinds);
+ void analysePropRanges();
+ valueRange evalRange(Expression* expr);
+ valueRange joinRange(valueRange a, valueRange b);
+ valueRange getPropRange(Identifier* prop);
+ void widenPropRange(Identifier* prop, valueRange range);
+ valueRange counterRange(Identifier* prop, long step, vector<int>& loopKinds);
+ bool isCounterUpdate(assignment* asst, long& step);
+ void widenOpaqueArgs(Expression* expr);
+ string narrowedType(Identifier* prop, Type* type);
+ void generateWidthDispatch(Function* dynFunc);
+ void addCudaKernel(forallStmt* forAll);
+ void generateCSRArrays(const char* gId);
+ void generateDeviceCSRSync(const char* gId, bool declare);
+ void collectGraphViews(statement* stmt, Function* func);
+ int usedGraphViews(Function* func);
+ void generateReverseRequest(Function* func);
+ bool isDynamicFuncType();
+ bool isNbrLoopEdge(proc_callExpr* proc);
+ string nbrLoopEdgeName(proc_callExpr* proc);
+ dslCodePad& currentPad();
+ void generateDeviceNbrLoop(forallStmt* forAll);
+ void generateEdgeDecl(declaration* declStmt, bool isMainFile);
+ void generateEdgeIndexRefresh(proc_callStmt* procStmt);
+ bool generateNbrLookup(forallStmt* forAll);
+ bool isHostForall(forallStmt* forAll);
+ bool isIndexedHostLoop(forallStmt* forAll);
+ bool isConcurrentContainer(Identifier* id);
+ void generateConcurrentContainerDecl(declaration* declStmt, bool isMainFile);
 };
 
 }
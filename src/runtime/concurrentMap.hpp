@@ -0,0 +1,653 @@
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "../../graphcode/numaAlloc.hpp"
+#include "epochReclaim.hpp"
+
+/* Concurrent multimap of (key, value) pairs for OpenMP code.
+
+   The C++ form of the lock-free map in MAP_openMP.c, for generated code
+   and the runtime. Slots sit in buckets of up to seven, each bucket one
+   control byte per slot followed by its keys and its values. A live slot's
+   control byte is 7 bits of the key's hash; the other states have the top
+   bit set. Probes compare a bucket's control bytes at once (SSE2) and read
+   keys only where the fragment matches. Every state change is a CAS on the
+   control byte, so inserts from any number of threads need no locks.
+
+   insert() adds a pair unless it is already there; append() always adds
+   it, like push_back on a per-key list. The table grows online past 7/8
+   full, or is rehashed once a quarter of its slots are tombstones: one
+   thread maps a table sized for the live pairs and the inserting threads
+   copy it over in chunks, a slot being owned (CTRL_BUSY) by the thread
+   copying it so it lands in the new table exactly once.
+
+   Inserts run concurrently with each other and with lookups. A lookup
+   waits out a slot being written, and in a table being replaced copies
+   the key's probe sequence over itself and reads the next table, so
+   count() and forEachValue() see each pair once even mid-resize (see
+   visit; mapStress.cpp checks this). Erases are not mixed with inserts
+   in one parallel phase. Every call
+   holds an epochGuard, and a table replaced by a resize is retired to
+   epochReclaim.hpp, so a reader still in it never sees it freed. The
+   batch functions hold one guard per thread for the whole batch. settle()
+   finishes any growth and collects what readers no longer hold. */
+
+template <typename K, typename V>
+class concurrentMap
+{
+  static_assert(std::is_integral<K>::value, "concurrentMap keys are node ids or indices");
+
+  private:
+  static const uint8_t CTRL_EMPTY = 0x80;
+  static const uint8_t CTRL_MOVED_EMPTY = 0xFC;   /* copied while empty, still ends probes */
+  static const uint8_t CTRL_MOVED = 0xFD;
+  static const uint8_t CTRL_TOMB = 0xFE;
+  static const uint8_t CTRL_BUSY = 0xFF;           /* being written by an insert or a copy */
+
+  /* as many slots as fit a cache line next to their control bytes */
+  static const int SLOTS = (64 - 8) / (sizeof(K) + sizeof(V)) > 7 ? 7
+                           : (64 - 8) / (sizeof(K) + sizeof(V)) < 1 ? 1
+                           : (64 - 8) / (sizeof(K) + sizeof(V));
+  static const unsigned CHUNK = 128;               /* buckets copied at a time while growing */
+
+  struct bucket
+  {
+    std::atomic<uint8_t> ctrl[8];
+    K keys[SLOTS];
+    V values[SLOTS];
+  };
+
+  struct table
+  {
+    bucket* buckets;
+    size_t mask;                       /* buckets - 1 */
+    std::atomic<size_t> used;          /* slots ever filled */
+    std::atomic<size_t> tombs;         /* erased slots not reused yet */
+    std::atomic<int> growing;
+    std::atomic<table*> next;
+    std::atomic<size_t> cursor;
+    std::atomic<size_t> copied;
+  };
+
+  struct masks
+  {
+    unsigned match, empty, tomb, busy, moved, ends;
+  };
+
+  /* readers help a growth along too, so it changes under const calls */
+  mutable std::atomic<table*> current;
+
+  static unsigned hashKey(K key)
+  {
+    uint64_t h = (uint64_t)key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (unsigned)h;
+  }
+
+  static uint8_t fragment(unsigned h) { return h & 0x7F; }
+
+  static masks scan(const bucket& b, uint8_t frag)
+  {
+    masks m;
+    const unsigned slots = (1u << SLOTS) - 1;
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadl_epi64((const __m128i*)b.ctrl);
+    m.match = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)frag))) & slots;
+    m.empty = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_EMPTY))) & slots;
+    m.tomb = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_TOMB))) & slots;
+    m.busy = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_BUSY))) & slots;
+    unsigned movedEmpty = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_MOVED_EMPTY))) & slots;
+    m.moved = movedEmpty | (_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_MOVED))) & slots);
+    m.ends = m.empty | movedEmpty;
+#else
+    m.match = m.empty = m.tomb = m.busy = m.moved = m.ends = 0;
+    for (int i = 0; i < SLOTS; i++)
+    {
+      uint8_t c = b.ctrl[i].load(std::memory_order_relaxed);
+      m.match |= (unsigned)(c == frag) << i;
+      m.empty |= (unsigned)(c == CTRL_EMPTY) << i;
+      m.tomb |= (unsigned)(c == CTRL_TOMB) << i;
+      m.busy |= (unsigned)(c == CTRL_BUSY) << i;
+      m.moved |= (unsigned)(c == CTRL_MOVED || c == CTRL_MOVED_EMPTY) << i;
+      m.ends |= (unsigned)(c == CTRL_EMPTY || c == CTRL_MOVED_EMPTY) << i;
+    }
+#endif
+    return m;
+  }
+
+  static size_t bucketsFor(size_t pairs)
+  {
+    size_t buckets = 16;
+    while (buckets * SLOTS * 7 / 8 < pairs)
+      buckets <<= 1;
+    return buckets;
+  }
+
+  static table* createTable(size_t buckets)
+  {
+    table* t = new table();
+    t->buckets = (bucket*)numaMap(buckets * sizeof(bucket), numaDefaultPolicy());
+    t->mask = buckets - 1;
+    t->used = 0;
+    t->tombs = 0;
+    t->growing = 0;
+    t->next = NULL;
+    t->cursor = 0;
+    t->copied = 0;
+    #pragma omp parallel for schedule(static) if(!omp_in_parallel() && buckets > CHUNK)
+    for (long b = 0; b < (long)buckets; b++)
+    {
+      for (int i = 0; i < 8; i++)
+        t->buckets[b].ctrl[i].store(CTRL_EMPTY, std::memory_order_relaxed);
+    }
+    return t;
+  }
+
+  static void freeTable(table* t)
+  {
+    numaFree(t->buckets, t->mask + 1);
+    delete t;
+  }
+
+  static void releaseTable(void* t) { freeTable((table*)t); }
+
+  static size_t chunks(table* t) { return (t->mask + CHUNK) / CHUNK; }
+
+  /* the next table holds the live pairs at half load, so one whose slots
+     went to tombstones is rehashed at its own size rather than doubled */
+  void startGrowth(table* t) const
+  {
+    if (t->next.load(std::memory_order_acquire) != NULL || t->growing.exchange(1))
+      return;
+    size_t used = t->used.load(std::memory_order_relaxed), tombs = t->tombs.load(std::memory_order_relaxed);
+    size_t buckets = 16;
+    while (buckets * SLOTS < 2 * (used > tombs ? used - tombs : 0))
+      buckets <<= 1;
+    t->next.store(createTable(buckets), std::memory_order_release);
+  }
+
+  /* erases do not copy: the rehash they start is done by settle() or by
+     the next inserts */
+  void addTombs(table* t, size_t n) const
+  {
+    if (n > 0 && t->tombs.fetch_add(n, std::memory_order_relaxed) + n > (t->mask + 1) * SLOTS / 4)
+      startGrowth(t);
+  }
+
+  /* copies one slot into next; true if it was empty, which still ends
+     probe sequences in t */
+  bool moveSlot(table* t, table* next, size_t b, int i) const
+  {
+    std::atomic<uint8_t>& ctrl = t->buckets[b].ctrl[i];
+    while (true)
+    {
+      uint8_t c = ctrl.load(std::memory_order_acquire);
+      if (c == CTRL_MOVED || c == CTRL_MOVED_EMPTY)
+        return c == CTRL_MOVED_EMPTY;
+      if (c == CTRL_BUSY)
+        continue;
+      if (c >= 0x80)
+      {
+        if (ctrl.compare_exchange_weak(c, c == CTRL_EMPTY ? CTRL_MOVED_EMPTY : CTRL_MOVED))
+          return c == CTRL_EMPTY;
+        continue;
+      }
+      if (!ctrl.compare_exchange_weak(c, CTRL_BUSY))
+        continue;
+      add(next, t->buckets[b].keys[i], t->buckets[b].values[i], false);
+      ctrl.store(CTRL_MOVED, std::memory_order_release);
+      return false;
+    }
+  }
+
+  /* makes the first table still being copied current */
+  void advance() const
+  {
+    table* t;
+    while ((t = current.load(std::memory_order_acquire))->next.load(std::memory_order_acquire) != NULL &&
+           t->copied.load(std::memory_order_acquire) == chunks(t))
+    {
+      table* expected = t;
+      if (current.compare_exchange_strong(expected, t->next.load(std::memory_order_acquire)))
+        epochDomain::shared().retire(t, releaseTable);
+    }
+  }
+
+  void helpGrowth(table* t) const
+  {
+    table* next = t->next.load(std::memory_order_acquire);
+    size_t chunk = t->cursor.fetch_add(1);
+    if (chunk >= chunks(t))
+      return;
+    for (size_t b = chunk * CHUNK; b < (chunk + 1) * CHUNK && b <= t->mask; b++)
+    {
+      for (int i = 0; i < SLOTS; i++)
+        moveSlot(t, next, b, i);
+    }
+    if (t->copied.fetch_add(1) + 1 == chunks(t))
+      advance();
+  }
+
+  /* copies the probe sequence of hash h in t into next: after it every
+     pair of the key is in next, and none can be added to t any more. Kept
+     out of line, lookups only call it while a growth is under way */
+  __attribute__((noinline)) void moveProbes(table* t, table* next, unsigned h) const
+  {
+    size_t b = (h >> 7) & t->mask;
+    for (size_t probes = 0; probes <= t->mask; probes++, b = (b + 1) & t->mask)
+    {
+      bool ends = false;
+      for (int i = 0; i < SLOTS; i++)
+        ends |= moveSlot(t, next, b, i);
+      if (ends)
+        break;
+    }
+  }
+
+  /* true if added; with unique set, false if the pair was already there */
+  bool add(table* t, K key, V value, bool unique) const
+  {
+    unsigned h = hashKey(key);
+    uint8_t frag = fragment(h);
+
+    while (true)
+    {
+      table* next = t->next.load(std::memory_order_acquire);
+      if (next != NULL)
+      {
+        /* once the pair's probe sequence here is copied it can only be
+           added to next; appends need no such care */
+        helpGrowth(t);
+        if (!unique)
+        {
+          t = next;
+          continue;
+        }
+        moveProbes(t, next, h);
+        t = next;
+        continue;
+      }
+
+      size_t b = (h >> 7) & t->mask, freeBucket = 0;
+      int freeSlot = -1;
+      uint8_t freeCtrl = 0;
+      bool moved = false, busy = false;
+
+      for (size_t probes = 0; probes <= t->mask; probes++, b = (b + 1) & t->mask)
+      {
+        bucket& bk = t->buckets[b];
+        masks m = scan(bk, frag);
+        if (unique)
+        {
+          for (unsigned bits = m.match; bits; bits &= bits - 1)
+          {
+            int i = __builtin_ctz(bits);
+            if (bk.ctrl[i].load(std::memory_order_acquire) == frag && bk.keys[i] == key && bk.values[i] == value)
+              return false;
+          }
+          /* a claimed slot may hold this very pair */
+          if (m.busy)
+          {
+            busy = true;
+            break;
+          }
+        }
+        if (m.moved)
+        {
+          moved = true;
+          break;
+        }
+        unsigned free = m.empty | m.tomb;
+        if (freeSlot < 0 && free)
+        {
+          freeBucket = b;
+          freeSlot = __builtin_ctz(free);
+          freeCtrl = (m.empty >> freeSlot) & 1 ? CTRL_EMPTY : CTRL_TOMB;
+        }
+        if (m.empty || (!unique && freeSlot >= 0))
+          break;
+      }
+
+      if (busy)
+        continue;
+      if (moved || freeSlot < 0)
+      {
+        startGrowth(t);
+        while (t->next.load(std::memory_order_acquire) == NULL)
+          ;
+        continue;
+      }
+
+      bucket& bk = t->buckets[freeBucket];
+      if (!bk.ctrl[freeSlot].compare_exchange_strong(freeCtrl, CTRL_BUSY))
+        continue;
+      bk.keys[freeSlot] = key;
+      bk.values[freeSlot] = value;
+      bk.ctrl[freeSlot].store(frag, std::memory_order_release);
+
+      if (freeCtrl == CTRL_TOMB)
+        t->tombs.fetch_sub(1, std::memory_order_relaxed);
+      else if (t->used.fetch_add(1, std::memory_order_relaxed) + 1 > (t->mask + 1) * SLOTS / 8 * 7)
+        startGrowth(t);
+      return true;
+    }
+  }
+
+  enum visitResult
+  {
+    VISIT_DONE,
+    VISIT_STOPPED,                     /* f returned true */
+    VISIT_AGAIN                        /* a growth began under f, see visit */
+  };
+
+  /* calls f(bucket, slot) for the live slots of key; stops when f returns
+     true. A table being replaced has the key's probe sequence copied out
+     first and is passed over, so each pair is seen in one table. If a
+     growth starts during the scan and f has already been called, the
+     pairs f saw may be copied on and seen again in the next table:
+     VISIT_AGAIN, and callers that look at every pair start over. t is
+     left at the table the scan ended in. */
+  template <typename F>
+  visitResult visit(table*& t, K key, F f) const
+  {
+    unsigned h = hashKey(key);
+    uint8_t frag = fragment(h);
+    bool called = false;
+    table* at = t;
+    table* next = at->next.load(std::memory_order_acquire);
+    while (true)
+    {
+      if (next != NULL)
+      {
+        moveProbes(at, next, h);
+        at = next;
+      }
+
+      size_t b = (h >> 7) & at->mask;
+      for (size_t probes = 0; probes <= at->mask; probes++, b = (b + 1) & at->mask)
+      {
+        bucket& bk = at->buckets[b];
+        masks m = scan(bk, frag);
+        /* an insert or a copy is writing a slot that may be key's */
+        while (m.busy)
+        {
+          std::atomic_thread_fence(std::memory_order_acquire);
+          m = scan(bk, frag);
+        }
+        for (unsigned bits = m.match; bits; bits &= bits - 1)
+        {
+          int i = __builtin_ctz(bits);
+          if (bk.ctrl[i].load(std::memory_order_acquire) == frag && bk.keys[i] == key)
+          {
+            called = true;
+            if (f(bk, i))
+            {
+              t = at;
+              return VISIT_STOPPED;
+            }
+          }
+        }
+        if (m.ends)
+          break;
+      }
+
+      /* slots are only moved once the next table is there: without one,
+         no slot was moved before it was read and every pair was seen */
+      std::atomic_thread_fence(std::memory_order_acquire);
+      next = at->next.load(std::memory_order_acquire);
+      if (next == NULL || called)
+      {
+        t = at;
+        return next == NULL ? VISIT_DONE : VISIT_AGAIN;
+      }
+    }
+  }
+
+  public:
+  explicit concurrentMap(size_t pairs = 0)
+  {
+    current = createTable(bucketsFor(pairs));
+  }
+
+  ~concurrentMap()
+  {
+    settle();
+    freeTable(current.load());
+  }
+
+  concurrentMap(const concurrentMap&) = delete;
+  concurrentMap& operator=(const concurrentMap&) = delete;
+
+  /* both callable from any number of threads at once */
+  bool insert(K key, V value)
+  {
+    epochGuard guard;
+    return add(current.load(std::memory_order_acquire), key, value, true);
+  }
+
+  void append(K key, V value)
+  {
+    epochGuard guard;
+    add(current.load(std::memory_order_acquire), key, value, false);
+  }
+
+  template <typename C>
+  void appendAll(K key, const C& values)
+  {
+    epochGuard guard;
+    for (const V& v : values)
+      append(key, v);
+  }
+
+  bool contains(K key, V value) const
+  {
+    epochGuard guard;
+    visitResult result;
+    do
+    {
+      table* t = current.load(std::memory_order_acquire);
+      result = visit(t, key, [&](bucket& bk, int i) { return bk.values[i] == value; });
+    } while (result == VISIT_AGAIN);
+    return result == VISIT_STOPPED;
+  }
+
+  size_t count(K key) const
+  {
+    epochGuard guard;
+    size_t n;
+    table* t;
+    do
+    {
+      n = 0;
+      t = current.load(std::memory_order_acquire);
+    } while (visit(t, key, [&](bucket&, int) { n++; return false; }) == VISIT_AGAIN);
+    return n;
+  }
+
+  /* f sees the values once the scan is known to have seen each pair once */
+  template <typename F>
+  void forEachValue(K key, F f) const
+  {
+    epochGuard guard;
+    std::vector<V> values;
+    table* t;
+    do
+    {
+      values.clear();
+      t = current.load(std::memory_order_acquire);
+    } while (visit(t, key, [&](bucket& bk, int i) { values.push_back(bk.values[i]); return false; }) == VISIT_AGAIN);
+    for (const V& v : values)
+      f(v);
+  }
+
+  bool erase(K key, V value)
+  {
+    epochGuard guard;
+    table* t;
+    bool erased = false;
+    do
+      t = current.load(std::memory_order_acquire);
+    while (visit(t, key, [&](bucket& bk, int i) {
+             uint8_t frag = bk.ctrl[i].load(std::memory_order_acquire);
+             if (bk.values[i] != value)
+               return false;
+             erased = bk.ctrl[i].compare_exchange_strong(frag, CTRL_TOMB);
+             return true;
+           }) == VISIT_AGAIN);
+    addTombs(t, erased);
+    return erased;
+  }
+
+  /* a pass cut short by a growth erased what it saw; the next one erases
+     the rest, in the table they were copied to */
+  size_t eraseKey(K key)
+  {
+    epochGuard guard;
+    size_t erased = 0;
+    visitResult result;
+    do
+    {
+      table* t = current.load(std::memory_order_acquire);
+      size_t pass = 0;
+      result = visit(t, key, [&](bucket& bk, int i) {
+        uint8_t frag = bk.ctrl[i].load(std::memory_order_acquire);
+        pass += bk.ctrl[i].compare_exchange_strong(frag, CTRL_TOMB);
+        return false;
+      });
+      addTombs(t, pass);
+      erased += pass;
+    } while (result == VISIT_AGAIN);
+    return erased;
+  }
+
+  /* between parallel phases: finishes a growth under way and frees the
+     tables it replaced */
+  void settle()
+  {
+    if (current.load()->next.load() != NULL)
+    {
+      #pragma omp parallel if(!omp_in_parallel())
+      {
+        epochGuard guard;
+        table* t;
+        while ((t = current.load(std::memory_order_acquire))->next.load(std::memory_order_acquire) != NULL)
+          helpGrowth(t);
+      }
+    }
+    epochDomain::shared().collect();
+  }
+
+  size_t size()
+  {
+    settle();
+    table* t = current.load();
+    size_t live = 0;
+    #pragma omp parallel for reduction(+ : live) if(!omp_in_parallel())
+    for (long b = 0; b <= (long)t->mask; b++)
+    {
+      for (int i = 0; i < SLOTS; i++)
+        live += t->buckets[b].ctrl[i].load(std::memory_order_relaxed) < 0x80;
+    }
+    return live;
+  }
+
+  size_t capacity()
+  {
+    settle();
+    return (current.load()->mask + 1) * SLOTS;
+  }
+
+  void clear()
+  {
+    settle();
+    table* t = current.load();
+    #pragma omp parallel for schedule(static) if(!omp_in_parallel())
+    for (long b = 0; b <= (long)t->mask; b++)
+    {
+      for (int i = 0; i < 8; i++)
+        t->buckets[b].ctrl[i].store(CTRL_EMPTY, std::memory_order_relaxed);
+    }
+    t->used = 0;
+    t->tombs = 0;
+  }
+
+  /* batches: done[i] set to 1 for the elements inserted / found / erased */
+  void insertBatch(long n, const K* keys, const V* values, char* done = NULL)
+  {
+    settle();
+    #pragma omp parallel
+    {
+      epochGuard guard;
+      #pragma omp for
+      for (long i = 0; i < n; i++)
+      {
+        bool added = insert(keys[i], values[i]);
+        if (done != NULL)
+          done[i] = added;
+      }
+    }
+  }
+
+  void findBatch(long n, const K* keys, const V* values, char* done)
+  {
+    settle();
+    #pragma omp parallel
+    {
+      epochGuard guard;
+      #pragma omp for
+      for (long i = 0; i < n; i++)
+        done[i] = contains(keys[i], values[i]);
+    }
+  }
+
+  void eraseBatch(long n, const K* keys, const V* values, char* done = NULL)
+  {
+    settle();
+    #pragma omp parallel
+    {
+      epochGuard guard;
+      #pragma omp for
+      for (long i = 0; i < n; i++)
+      {
+        bool erased = erase(keys[i], values[i]);
+        if (done != NULL)
+          done[i] = erased;
+      }
+    }
+  }
+
+  /* appends the values of every key k < lists.size() to lists[k] and
+     empties the map; what generated code does after a forall that filled
+     a nested container through append() */
+  template <typename C>
+  void drainInto(C& lists)
+  {
+    settle();
+    #pragma omp parallel
+    {
+      epochGuard guard;
+      table* t = current.load(std::memory_order_acquire);
+      /* settled and nothing else running: one pass sees each pair once */
+      #pragma omp for schedule(dynamic, 256)
+      for (long k = 0; k < (long)lists.size(); k++)
+        visit(t, (K)k, [&](bucket& bk, int i) { lists[k].push_back(bk.values[i]); return false; });
+    }
+    clear();
+  }
+};
+
+#endif
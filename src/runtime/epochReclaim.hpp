@@ -0,0 +1,260 @@
+#ifndef EPOCH_RECLAIM_H
+#define EPOCH_RECLAIM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+/* Epoch-based reclamation for the concurrent runtime structures.
+
+   A structure that unlinks memory other threads may still be reading (a
+   map table replaced by a resize, an adjacency block swapped out) hands
+   it to retire() instead of freeing it. Readers wrap their accesses in an
+   epochGuard, which only announces the global epoch in the thread's own
+   record: no lock and no shared write on the read path.
+
+   The global epoch moves from e to e+1 once every thread inside a guard
+   has announced e. Memory retired in e-2 was unlinked before any of those
+   readers entered, so the thread that moved the epoch frees it. Retired
+   memory goes on one of three lock-free stacks, by epoch modulo 3, tagged
+   with its epoch; the list of e-2 is the one of e+1, so a node pushed by
+   a reader that already entered e+1 is put back rather than freed. Memory
+   retired by one thread is freed by whichever thread next advances, so
+   nothing stays behind with an idle thread.
+
+   Collection is amortised: every 64th retire, and every 1024th guard a
+   thread leaves, tries to advance. collect() advances as far as the
+   readers allow and is what the structures call between parallel phases;
+   with no thread inside a guard it frees everything retired.
+
+   One domain (epochDomain::shared()) serves every structure, so a thread
+   holds one record however many maps it touches. Threads claim a record
+   on first use and give it back when they exit; a thread that finds all
+   MAX_THREADS records taken aborts rather than wait for one. */
+
+class epochDomain
+{
+  public:
+  static const int MAX_THREADS = 1024;
+
+  private:
+  static const uint64_t QUIESCENT = ~(uint64_t)0;
+
+  struct alignas(64) record
+  {
+    std::atomic<uint64_t> announced;   /* epoch seen on entry, or QUIESCENT */
+    std::atomic<int> owned;
+    int nesting;
+    unsigned exits;
+  };
+
+  struct node
+  {
+    void* p;
+    void (*release)(void*);
+    uint64_t epoch;                    /* of the retiring thread */
+    node* next;
+  };
+
+  std::atomic<uint64_t> epoch;
+  std::atomic<node*> limbo[3];
+  std::atomic<int> records;            /* high water of claimed records */
+  std::atomic<unsigned> retires;
+  record table[MAX_THREADS];
+
+  /* gives the record back when the thread exits */
+  struct handle
+  {
+    record* r;
+    handle() : r(NULL) {}
+    ~handle()
+    {
+      if (r != NULL)
+      {
+        r->announced.store(QUIESCENT, std::memory_order_release);
+        r->owned.store(0, std::memory_order_release);
+      }
+    }
+  };
+
+  epochDomain()
+  {
+    epoch = 2;
+    for (int i = 0; i < 3; i++)
+      limbo[i] = NULL;
+    records = 0;
+    retires = 0;
+    for (int i = 0; i < MAX_THREADS; i++)
+    {
+      table[i].announced = QUIESCENT;
+      table[i].owned = 0;
+      table[i].nesting = 0;
+      table[i].exits = 0;
+    }
+  }
+
+  record* mine()
+  {
+    static thread_local handle h;
+    if (h.r != NULL)
+      return h.r;
+    for (int i = 0; i < MAX_THREADS; i++)
+    {
+      int free = 0;
+      if (table[i].owned.load(std::memory_order_relaxed) == 0 && table[i].owned.compare_exchange_strong(free, 1))
+      {
+        int high = records.load();
+        while (high < i + 1 && !records.compare_exchange_weak(high, i + 1))
+          ;
+        h.r = &table[i];
+        return h.r;
+      }
+    }
+    fprintf(stderr, "epochDomain: more than %d threads at once\n", MAX_THREADS);
+    abort();
+  }
+
+  void push(std::atomic<node*>& list, node* first, node* last)
+  {
+    last->next = list.load(std::memory_order_relaxed);
+    while (!list.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed))
+      ;
+  }
+
+  /* frees the nodes of list retired in safe or before, putting the rest back */
+  void release(std::atomic<node*>& list, uint64_t safe)
+  {
+    node* n = list.exchange(NULL, std::memory_order_acq_rel);
+    node *keep = NULL, *keepLast = NULL;
+    while (n != NULL)
+    {
+      node* next = n->next;
+      if (n->epoch <= safe)
+      {
+        n->release(n->p);
+        delete n;
+      }
+      else
+      {
+        n->next = keep;
+        keep = n;
+        if (keepLast == NULL)
+          keepLast = n;
+      }
+      n = next;
+    }
+    if (keep != NULL)
+      push(list, keep, keepLast);
+  }
+
+  public:
+  /* at exit, with every other thread gone */
+  ~epochDomain()
+  {
+    for (int i = 0; i < 3; i++)
+      release(limbo[i], QUIESCENT);
+  }
+
+  static epochDomain& shared()
+  {
+    static epochDomain domain;
+    return domain;
+  }
+
+  epochDomain(const epochDomain&) = delete;
+  epochDomain& operator=(const epochDomain&) = delete;
+
+  void enter()
+  {
+    record* r = mine();
+    if (r->nesting++ > 0)
+      return;
+    uint64_t e = epoch.load(std::memory_order_relaxed);
+    r->announced.store(e, std::memory_order_relaxed);
+    /* the announcement must be visible before any load of the structure */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    /* an advance in between would leave us announced behind: catch up */
+    uint64_t now = epoch.load(std::memory_order_relaxed);
+    if (now != e)
+    {
+      r->announced.store(now, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void exit()
+  {
+    record* r = mine();
+    if (--r->nesting > 0)
+      return;
+    r->announced.store(QUIESCENT, std::memory_order_release);
+    if ((++r->exits & 1023) == 0)
+      tryAdvance();
+  }
+
+  /* moves the epoch on by one if every reader has seen it, freeing what
+     was retired two epochs back; false if a reader lags behind */
+  bool tryAdvance()
+  {
+    uint64_t e = epoch.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int high = records.load(std::memory_order_acquire);
+    for (int i = 0; i < high; i++)
+    {
+      uint64_t a = table[i].announced.load(std::memory_order_acquire);
+      if (a != QUIESCENT && a != e)
+        return false;
+    }
+    if (!epoch.compare_exchange_strong(e, e + 1))
+      return false;
+    release(limbo[(e + 1) % 3], e - 2);
+    return true;
+  }
+
+  /* frees p with dispose(p) once no reader can hold it */
+  void retire(void* p, void (*dispose)(void*))
+  {
+    enter();
+    node* n = new node;
+    n->p = p;
+    n->release = dispose;
+    n->epoch = mine()->announced.load(std::memory_order_relaxed);
+    push(limbo[n->epoch % 3], n, n);
+    exit();
+    if ((retires.fetch_add(1, std::memory_order_relaxed) & 63) == 63)
+      tryAdvance();
+  }
+
+  template <typename T>
+  void retire(T* p)
+  {
+    retire((void*)p, [](void* q) { delete (T*)q; });
+  }
+
+  /* advances as far as the readers allow; from a thread outside any guard
+     with no readers about, this frees everything retired */
+  void collect()
+  {
+    for (int i = 0; i < 3 && tryAdvance(); i++)
+      ;
+  }
+
+  uint64_t current() const { return epoch.load(std::memory_order_acquire); }
+};
+
+/* the scope of a read (or of a write that reads shared memory) */
+class epochGuard
+{
+  private:
+  epochDomain& domain;
+
+  public:
+  explicit epochGuard(epochDomain& d = epochDomain::shared()) : domain(d) { domain.enter(); }
+  ~epochGuard() { domain.exit(); }
+
+  epochGuard(const epochGuard&) = delete;
+  epochGuard& operator=(const epochGuard&) = delete;
+};
+
+#endif
@@ -0,0 +1,248 @@
+/* Readers against concurrent resizes: the self-test of epochReclaim.hpp
+   and concurrentMap.hpp, as MAP_openMP.c --stress is of the C map.
+
+   g++ -O3 -fopenmp -std=c++14 mapStress.cpp -o mapStress
+   ./mapStress [--pairs n] [--threads t]
+
+   Half the threads write while the other half read, and every read is of
+   something a writer has already published, so it must succeed however
+   the writes interleave with it:
+
+   retire   writers swap an object out and retire() it, readers check the
+            object they loaded under a guard was not freed under them;
+            collect() afterwards must have freed every one
+   growth   writers insert n pairs into a map grown from its smallest
+            table, readers look up the pairs each writer has published
+   rehash   a third of the pairs erased, then n more inserted while
+            readers look up the survivors and the new ones, so the
+            tombstones are rehashed away under them
+
+   The erased pairs and pairs never inserted must not be found either.
+   At least 8 threads are used, so a one-core machine still interleaves
+   them. Exits 1 on any failure. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include <atomic>
+#include <vector>
+#include "epochReclaim.hpp"
+#include "concurrentMap.hpp"
+
+using namespace std;
+
+static const long CANARY = 0x5eed;
+
+struct retiree
+{
+  long canary;
+  long serial;
+};
+
+static atomic<long> retireesFreed(0);
+
+static void freeRetiree(void* p)
+{
+  ((retiree*)p)->canary = 0;
+  delete (retiree*)p;
+  retireesFreed++;
+}
+
+static unsigned nextRandom(unsigned& x)
+{
+  x = x * 1103515245 + 12345;
+  return x >> 3;
+}
+
+/* readers check pairs (k, 3k) of the keys writers have published: writer w
+   inserts the keys k = w, w + writers, ... in order and publishes how many */
+struct publication
+{
+  int writers;
+  long base;
+  vector<atomic<long>> done;
+
+  publication(int writersSent, long baseSent) : writers(writersSent), base(baseSent), done(writersSent)
+  {
+    for (int w = 0; w < writers; w++)
+      done[w] = 0;
+  }
+
+  long key(int w, long j) const { return base + j * writers + w; }
+};
+
+static bool stressRetire(int threads, long swaps)
+{
+  int writers = threads / 2;
+  atomic<retiree*> slot(new retiree{CANARY, 0});
+  atomic<int> stopped(0);
+  long reads = 0, bad = 0;
+
+  #pragma omp parallel num_threads(threads) reduction(+ : reads, bad)
+  {
+    int t = omp_get_thread_num();
+    if (t < writers)
+    {
+      for (long i = 1; i <= swaps; i++)
+      {
+        retiree* old = slot.exchange(new retiree{CANARY, i});
+        epochDomain::shared().retire(old, freeRetiree);
+      }
+      stopped++;
+    }
+    else
+    {
+      while (stopped.load() < writers)
+      {
+        epochGuard guard;
+        retiree* r = slot.load();
+        for (int k = 0; k < 16; k++)
+          bad += r->canary != CANARY;
+        reads++;
+      }
+    }
+  }
+
+  epochDomain::shared().collect();
+  long freed = retireesFreed.load();
+  freeRetiree(slot.load());
+  bool ok = bad == 0 && freed == writers * swaps;
+  printf("retire: %ld reads, %ld of freed memory, %ld of %ld retired freed after collect\n", reads, bad, freed, writers * swaps);
+  return ok;
+}
+
+/* writers insert the keys of pub, count of them, while readers look up
+   published ones and check the keys of `absent` (first, step) stay out */
+static bool readDuringInserts(const char* phase, concurrentMap<long, long>& map, int threads, long count, publication& pub, long survivors, long absentFirst, long absentStep)
+{
+  int writers = pub.writers;
+  atomic<int> stopped(0);
+  long lookups = 0, misses = 0, phantoms = 0;
+
+  #pragma omp parallel num_threads(threads) reduction(+ : lookups, misses, phantoms)
+  {
+    int t = omp_get_thread_num();
+    if (t < writers)
+    {
+      for (long j = 0; pub.key(t, j) < pub.base + count; j++)
+      {
+        long k = pub.key(t, j);
+        map.insert(k, 3 * k);
+        pub.done[t].store(j + 1, memory_order_release);
+      }
+      stopped++;
+    }
+    else
+    {
+      unsigned x = 7919u * t;
+      while (stopped.load() < writers)
+      {
+        for (int i = 0; i < 64; i++)
+        {
+          int w = nextRandom(x) % writers;
+          long published = pub.done[w].load(memory_order_acquire);
+          long k;
+          if (survivors > 0 && (published == 0 || nextRandom(x) % 2))
+          {
+            k = nextRandom(x) % survivors;
+            if (absentStep > 0 && k % absentStep == absentFirst)
+              k = k + 1 < survivors ? k + 1 : k - 1;
+          }
+          else if (published > 0)
+            k = pub.key(w, nextRandom(x) % published);
+          else
+            continue;
+          misses += !map.contains(k, 3 * k) || map.count(k) != 1;
+          lookups++;
+        }
+        long never = pub.base + count + nextRandom(x) % count;
+        phantoms += map.contains(never, 3 * never) || map.contains(nextRandom(x) % count, -1);
+        if (absentStep > 0)
+        {
+          long gone = (nextRandom(x) % (survivors / absentStep)) * absentStep + absentFirst;
+          phantoms += map.count(gone) != 0;
+        }
+      }
+    }
+  }
+
+  printf("%s: %ld lookups during %zu slots of growth, %ld misses, %ld phantom\n", phase, lookups, map.capacity(), misses, phantoms);
+  return misses == 0 && phantoms == 0;
+}
+
+int main(int argc, char* argv[])
+{
+  long n = 400000;
+  int threads = omp_get_max_threads() < 8 ? 8 : omp_get_max_threads();
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--pairs") == 0 && i + 1 < argc)
+      n = atol(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--pairs n] [--threads t]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (n < 3 || threads < 2)
+  {
+    fprintf(stderr, "%s: --pairs must be at least 3 and --threads at least 2\n", argv[0]);
+    return 1;
+  }
+  printf("stress: %ld pairs, %d threads\n", n, threads);
+  int failures = 0;
+
+  failures += !stressRetire(threads, n / 2);
+
+  concurrentMap<long, long> map;
+  publication first(threads / 2, 0);
+  failures += !readDuringInserts("growth", map, threads, n, first, 0, 0, 0);
+  if (map.size() != (size_t)n)
+    failures++;
+
+  /* every third pair erased in a phase of its own, erases not being mixed
+     with inserts */
+  vector<long> keys, values;
+  for (long k = 0; k < n; k += 3)
+  {
+    keys.push_back(k);
+    values.push_back(3 * k);
+  }
+  vector<char> erased(keys.size());
+  map.eraseBatch((long)keys.size(), keys.data(), values.data(), erased.data());
+  long erasedCount = 0;
+  for (char e : erased)
+    erasedCount += e;
+  if (erasedCount != (long)keys.size())
+    failures++;
+
+  publication second(threads / 2, n);
+  failures += !readDuringInserts("rehash", map, threads, n, second, n, 0, 3);
+
+  /* settled: exactly the survivors and the second n pairs, nothing retired left */
+  long total = 2 * n - erasedCount;
+  keys.clear();
+  values.clear();
+  for (long k = 0; k < 2 * n; k++)
+  {
+    if (k < n && k % 3 == 0)
+      continue;
+    keys.push_back(k);
+    values.push_back(3 * k);
+  }
+  vector<char> found(keys.size());
+  map.findBatch((long)keys.size(), keys.data(), values.data(), found.data());
+  long foundCount = 0;
+  for (char f : found)
+    foundCount += f;
+  size_t stored = map.size();
+  if (foundCount != total || stored != (size_t)total)
+    failures++;
+  printf("settled: %ld of %ld found, %zu stored, %zu slots\n", foundCount, total, stored, map.capacity());
+
+  printf("stress: %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}